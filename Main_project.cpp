@@ -1,11 +1,14 @@
+#include <Arduino.h>      // Podstawowe funkcje i typy Arduino (jawnie, bo plik .cpp nie jest wstępnie przetwarzany jak .ino)
 #include <Wire.h>         // Biblioteka do komunikacji I2C (dla BME280 i RTC)
 #include <SPI.h>          // Biblioteka do komunikacji SPI (dla karty SD i wyświetlacza)
 #include <SD.h>           // Biblioteka do obsługi karty SD
+#include <EEPROM.h>       // Wbudowana pamięć EEPROM (kolejka pomiarów, gdy karta SD jest niedostępna)
 #include <Adafruit_Sensor.h> // Podstawowa biblioteka dla czujników Adafruit (wymagana przez BME280)
 #include <Adafruit_BME280.h> // Biblioteka do obsługi czujnika temperatury, wilgotności i ciśnienia BME280
 #include <RTClib.h>       // Biblioteka do obsługi zegara czasu rzeczywistego (RTC)
 #include <Adafruit_GFX.h> // Podstawowa biblioteka graficzna Adafruit (wymagana przez wyświetlacz ST7735)
 #include <Adafruit_ST7735.h> // Biblioteka do obsługi wyświetlacza TFT ST7735
+#include <avr/sleep.h>    // Usypianie procesora między zdarzeniami (tryb oszczędzania energii)
 
 #define DARKGREY 0x7BEF     // Definicja koloru ciemnoszarego w formacie 16-bitowym RGB (128,128,128)
 //Ciśnienie
@@ -15,47 +18,1033 @@ const int button1Pin = 2;     // Pin cyfrowy podłączony do przycisku 1 (zmieni
 const int button2Pin = 3;     // Pin cyfrowy podłączony do przycisku 2 (zmienia ekran w prawo/dalej)
 const int chipSelect = 4;     // Pin Chip Select dla modułu karty SD (ważne dla komunikacji SPI)
 const int refreshButtonPin = 7; // Pin cyfrowy podłączony do przycisku odświeżania danych
-bool lastRefreshButtonState = HIGH; // Przechowuje poprzedni stan przycisku odświeżania, używane do wykrywania zbocza (naciśnięcia)
+const int backlightPin = 6;   // Pin sterujący podświetleniem wyświetlacza (wyprowadzenie LED/BL modułu ST7735)
+const int rtcInterruptPin = 19; // Pin podłączony do wyjścia INT zegara PCF8563 (przerwanie INT2 budzi procesor z uśpienia)
+
+// --- Kanały pomiarowe ---
+// Kanał to jedna wielkość z jednego czujnika. Tabela CHANNELS (pamięć programu) podaje dla każdego kanału nazwę,
+// kolumnę pliku CSV, etykietę i jednostkę na ekranie, czujnik i wielkość, z których pochodzi wartość, skalę zapisu
+// stałoprzecinkowego, zakres poprawnych wartości (w jednostkach stałoprzecinkowych), dokładność etykiet osi wykresu
+// i kolor linii wykresu. Kolejność tabeli to kolejność kolumn w plikach CSV, wartości w rekordach (indeks, dziennik
+// binarny, wykres) i linii na ekranach, więc nowy kanał to nowy wiersz tabeli, a nowy czujnik BME280 - jego adres
+// w BME280_ADDRESSES i wiersze jego wielkości. Po zmianie tabeli pliki dni.idx, dane.bin i wykres.bin są tworzone
+// od nowa (sprawdzają rozmiar rekordu), a pliki CSV z inną liczbą kolumn trzeba zarchiwizować - ich wiersze byłyby
+// pomijane jako uszkodzone.
+const uint8_t QTY_TEMPERATURE = 0; // Wielkość mierzona przez BME280: temperatura (°C)
+const uint8_t QTY_HUMIDITY = 1;    // Wilgotność względna (%)
+const uint8_t QTY_PRESSURE = 2;    // Ciśnienie (hPa)
+const uint8_t QTY_COUNT = 3;       // Liczba wielkości z jednego pomiaru BME280
+
+// Adresy I2C czujników BME280 (numer czujnika w tabeli kanałów to miejsce na tej liście); drugi czujnik
+// z wyprowadzeniem SDO podłączonym do VCC: {0x76, 0x77}
+const uint8_t BME280_ADDRESSES[] = {0x76};
+const uint8_t SENSOR_COUNT = sizeof(BME280_ADDRESSES); // Liczba czujników BME280
+
+// Opis kanału pomiarowego
+struct ChannelInfo {
+  char name[12];            // Nazwa w nagłówku wykresu
+  char column[14];          // Nazwa kolumny w nagłówku pliku CSV (i w poleceniu "kanal")
+  char label[6];            // Etykieta linii na ekranie i w poleceniu "kanal"
+  char unit[4];             // Jednostka
+  uint8_t sensor;           // Numer czujnika (miejsce w BME280_ADDRESSES)
+  uint8_t quantity;         // Wielkość mierzona przez czujnik (QTY_*)
+  int16_t scale;            // Skala zapisu stałoprzecinkowego (100 - setne części jednostki, 10 - dziesiąte)
+  int16_t minValue;         // Najmniejsza poprawna wartość (jednostki stałoprzecinkowe)
+  int16_t maxValue;         // Największa poprawna wartość
+  uint8_t decimals;         // Liczba miejsc po przecinku etykiet osi wykresu (5 znaków z lewej strony wykresu)
+  uint16_t color;           // Kolor linii średniej na wykresie
+};
+
+const ChannelInfo CHANNELS[] PROGMEM = {
+  {"Temperatura", "Temperature", "Temp", "C", 0, QTY_TEMPERATURE, 100, -4999, 9999, 1, ST77XX_ORANGE},
+  {"Wilgotnosc", "Humidity", "Wilg", "%", 0, QTY_HUMIDITY, 100, 0, 10000, 0, ST77XX_CYAN},
+  {"Cisnienie", "Pressure", "Cisn", "hPa", 0, QTY_PRESSURE, 10, 5001, 11999, 0, ST77XX_GREEN},
+  // Drugi czujnik (np. na zewnątrz), wymaga adresu 0x77 w BME280_ADDRESSES:
+  // {"Temp. zewn.", "Temperature2", "Tzew", "C", 1, QTY_TEMPERATURE, 100, -4999, 9999, 1, ST77XX_RED},
+  // {"Wilg. zewn.", "Humidity2", "Wzew", "%", 1, QTY_HUMIDITY, 100, 0, 10000, 0, ST77XX_BLUE},
+};
+const uint8_t CHANNEL_COUNT = sizeof(CHANNELS) / sizeof(CHANNELS[0]); // Liczba kanałów pomiarowych
+
+// Kanały pierwszego czujnika, z których liczone są wielkości pochodne (wysokość, punkt rosy, tendencja baryczna)
+const uint8_t CH_TEMPERATURE = 0; // Indeks kanału temperatury w tablicach kanałów
+const uint8_t CH_HUMIDITY = 1;    // Indeks kanału wilgotności
+const uint8_t CH_PRESSURE = 2;    // Indeks kanału ciśnienia
 
 // Czujniki i moduły - Deklaracja obiektów dla używanych urządzeń
-Adafruit_BME280 bme;        // Obiekt dla czujnika BME280
+Adafruit_BME280 bme[SENSOR_COUNT]; // Obiekty czujników BME280 (kolejność jak w BME280_ADDRESSES)
 RTC_PCF8563 rtc;            // Obiekt dla zegara czasu rzeczywistego RTC PCF8563
 Adafruit_ST7735 tft = Adafruit_ST7735(10, 9, 8); // Obiekt dla wyświetlacza ST7735: piny (CS, DC, RST)
 
-int screenIndex = 0;        // Aktualnie wyświetlany indeks ekranu (0: bieżące, 1: dziś, 2: wczoraj, 3: tydzień)
-const int screenCount = 4;  // Całkowita liczba dostępnych ekranów
+// --- Tabela ekranów ---
+// Każdy wiersz to jeden ekran w kolejności przełączania przyciskami 1 i 2: napisy i sposób rysowania (rodzaj
+// ekranu, a dla ekranu średnich okno dni). Ekrany średnich mają wspólny układ - pod średnimi okna dzisiejszego
+// są statystyki dnia z odczytów czujnika, a pod średnimi okna kilku dni średnia ze średnich dziennych - więc nowy
+// ekran, np. średnie z 30 dni, to jeden wiersz tabeli. Tabela leży w pamięci Flash; ostatni wiersz to ukryty ekran
+// diagnostyczny (poza kolejką przycisków).
+const uint8_t SCREEN_CURRENT = 0;  // Rodzaj ekranu: bieżący odczyt czujników
+const uint8_t SCREEN_AVERAGE = 1;  // Średnie kanałów z okna dni (wspólny układ wszystkich okien)
+const uint8_t SCREEN_GRAPH = 2;    // Wykres historii (przycisk odświeżania zmienia wielkość i zakres wykresu)
+const uint8_t SCREEN_DIAG = 3;     // Czasy sond (ekran ukryty, otwierany przytrzymaniem przycisku odświeżania)
+
+// Opis ekranu
+struct ScreenInfo {
+  char label[5];            // Skrót na pasku przycisków (do 4 znaków - szerokość przycisku przy 6 ekranach)
+  char name[15];            // Nazwa na monitorze szeregowym
+  char period[9];           // Ekran średnich: okres w dopełniaczu do nagłówka i komunikatów ("dzisiaj", "tygodnia")
+  uint8_t kind;             // Rodzaj ekranu (SCREEN_*)
+  uint8_t daysBack;         // Ekran średnich: ostatni dzień okna (0 - dzisiaj, 1 - wczoraj)
+  uint8_t dayCount;         // Ekran średnich: liczba dni okna
+};
+
+constexpr ScreenInfo SCREENS[] PROGMEM = {
+  {"Bie", "Bieżące dane", "", SCREEN_CURRENT, 0, 0},
+  {"Dzis", "Dzisiaj", "dzisiaj", SCREEN_AVERAGE, 0, 1},
+  {"Wcz", "Wczoraj", "wczoraj", SCREEN_AVERAGE, 1, 1},
+  {"Tyg", "Tydzień", "tygodnia", SCREEN_AVERAGE, 0, 7},
+  {"30d", "30 dni", "30 dni", SCREEN_AVERAGE, 0, 30},
+  {"Wykr", "Wykres", "", SCREEN_GRAPH, 0, 0},
+  {"", "Diagnostyka", "", SCREEN_DIAG, 0, 0},
+};
+const int screenCount = sizeof(SCREENS) / sizeof(SCREENS[0]) - 1; // Liczba ekranów przełączanych przyciskami
+const int diagScreenIndex = screenCount; // Ukryty ekran diagnostyczny - ostatni wiersz tabeli
+static_assert(SCREENS[diagScreenIndex].kind == SCREEN_DIAG, "Ostatni wiersz tabeli SCREENS to ekran diagnostyczny");
+static_assert(screenCount <= 6, "Pasek przyciskow miesci do 6 ekranow (skroty do 4 znakow)");
+
+int screenIndex = 0;        // Aktualnie wyświetlany ekran (wiersz tabeli SCREENS)
 
-int lastLoggedHour = -1;    // Przechowuje ostatnią godzinę, o której zapisano dane na SD, zapobiega wielokrotnemu zapisowi w tej samej godzinie
+uint32_t nextLogTime = 0;   // Termin następnego zapisu na SD (sekundy od 2000-01-01) - zapis następuje, gdy zegar go osiągnie
 
-char csvFileLine[60];       // Bufor do przechowywania linii odczytanej z pliku CSV
-File dataFile;              // Obiekt reprezentujący otwarty plik na karcie SD
+#define CSV_LINE_MAX 62      // Najdłuższa poprawna linia pliku CSV (bez "\r\n") - dłuższe linie są odrzucane w całości
+#define CSV_BLOCK 128        // Rozmiar bloku, którym czytane są pliki CSV (linie są wycinane z bloku w pamięci)
+char csvFileLine[CSV_LINE_MAX + 2]; // Bufor linii odczytanej z pliku CSV (miejsce na "\r\n" albo '\0')
+File dataFile;              // Obiekt reprezentujący otwarty plik na karcie SD (plik bieżącego miesiąca)
 
 // Struktura do przechowywania danych z czujnika
 struct SensorData {
-  float temperature;        // Temperatura w stopniach Celsjusza
-  float humidity;           // Wilgotność względna w procentach
-  float pressure;           // Ciśnienie atmosferyczne w hektopaskalach
+  float value[CHANNEL_COUNT]; // Wartości kanałów w jednostkach z tabeli CHANNELS (°C, %, hPa)
   bool isValid;             // Flaga oznaczająca, czy dane są poprawne/zostały pomyślnie obliczone-
+  float altitude;           // Wysokość w metrach wyliczona z ciśnienia (tylko dla odczytu z czujnika)
+  uint32_t time;            // Czas odczytu w sekundach od 2000-01-01 00:00:00 (tylko dla odczytu z czujnika)
+};
+
+// Jeden wiersz pomiarów odczytany z pliku CSV
+struct CSVRow {
+  uint16_t day;             // Numer dnia (dni od 2000-01-01)
+  uint8_t hour;             // Godzina pomiaru
+  uint8_t minute;           // Minuta pomiaru
+  uint8_t second;           // Sekunda pomiaru
+  int16_t value[CHANNEL_COUNT]; // Wartości kanałów w jednostkach stałoprzecinkowych (skala z tabeli CHANNELS)
+};
+
+// Czytnik pliku CSV: plik jest czytany blokami po CSV_BLOCK bajtów, a linie są wycinane z bloku w pamięci
+// (zamiast odczytu znak po znaku). Linie w złym formacie i linie za długie są liczone, a nie odczytywane błędnie.
+struct CSVReader {
+  File *file = NULL;        // Czytany plik
+  uint8_t block[CSV_BLOCK]; // Ostatnio wczytany blok pliku
+  uint8_t pos = 0;          // Miejsce następnego znaku w bloku
+  uint8_t length = 0;       // Liczba bajtów w bloku
+  uint16_t badLines = 0;    // Liczba pominiętych linii w niepoprawnym formacie (bez nagłówka kolumn)
+  uint16_t longLines = 0;   // Liczba pominiętych linii dłuższych niż CSV_LINE_MAX
+};
+
+// Liczba dni roku nieprzestępnego przed pierwszym dniem każdego miesiąca (do zamiany daty z pliku CSV na numer dnia)
+const uint16_t DAYS_BEFORE_MONTH[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+// --- Pliki miesięczne dziennika CSV ---
+// Pomiary trafiają do osobnego pliku dla każdego miesiąca: /RRRR/MM.csv (np. /2026/10.csv), każdy z nagłówkiem
+// kolumn. Zapis przechodzi do pliku nowego miesiąca sam, z pierwszym pomiarem tego miesiąca. Zapytanie o zakres
+// dni otwiera tylko pliki miesięcy, które ten zakres obejmuje, a stare miesiące można zarchiwizować lub usunąć
+// z karty bez przepisywania jednego dużego pliku. Miesiące są numerowane od 2000-01 (numer 0).
+#define LEGACY_LOG_FILE "dane.csv"  // Dawny pojedynczy plik z całą historią (przy starcie dzielony na pliki miesięczne)
+#define LOG_NO_MONTH 0xFFFF         // Numer miesiąca oznaczający brak pliku
+#define LOG_PATH_LEN 13             // Długość ścieżki pliku miesiąca razem z '\0' ("/RRRR/MM.csv")
+
+// Czytnik wierszy z kolejnych plików miesięcznych w zadanym zakresie miesięcy (pliki czytane jak jeden ciąg wierszy)
+struct LogReader {
+  File file;                // Aktualnie czytany plik miesiąca
+  CSVReader csv;            // Czytnik linii tego pliku (liczniki pominiętych linii obejmują wszystkie pliki)
+  uint16_t month;           // Miesiąc aktualnie (lub ostatnio) czytanego pliku albo LOG_NO_MONTH
+  uint16_t lastMonth;       // Ostatni miesiąc zakresu
+  uint32_t endOffset;       // Rozmiar ostatnio przeczytanego do końca pliku (miejsce, do którego sięga odczyt)
+};
+
+uint16_t dataFileMonth = LOG_NO_MONTH; // Miesiąc pliku otwartego w dataFile
+
+// --- Indeks dziennych agregatów ---
+// Plik dni.idx przechowuje po jednym rekordzie na każdy dzień (suma, liczba, minimum i maksimum pomiarów),
+// dzięki czemu ekrany ze średnimi nie muszą za każdym razem czytać plików CSV.
+#define INDEX_FILE "dni.idx"        // Nazwa pliku indeksu na karcie SD
+#define INDEX_VERSION 2             // Wersja formatu pliku indeksu (zmiana formatu wymusza przebudowę)
+#define INDEX_NO_DAY 0xFFFF         // Wartość firstDay oznaczająca pusty indeks (brak jeszcze żadnego dnia)
+// Tryb otwarcia pliku do odczytu i zapisu w dowolnym miejscu.
+// FILE_WRITE zawiera O_APPEND, przez co każdy zapis trafia na koniec pliku - do aktualizacji rekordów potrzebny jest tryb bez O_APPEND.
+#define FILE_UPDATE (O_READ | O_WRITE | O_CREAT)
+
+// Nagłówek pliku indeksu
+struct __attribute__((packed)) DayIndexHeader {
+  char magic[4];            // Znacznik pliku "SIDX"
+  uint8_t version;          // Wersja formatu (INDEX_VERSION)
+  uint8_t recordSize;       // Rozmiar jednego rekordu dnia w bajtach (kontrola zgodności)
+  uint16_t firstDay;        // Numer pierwszego dnia w indeksie (dni od 2000-01-01) lub INDEX_NO_DAY
+  uint16_t logMonth;        // Miesiąc pliku CSV, do którego indeks jest aktualny
+  uint32_t logOffset;       // Miejsce w tym pliku, do którego indeks jest aktualny
+};
+
+// Rekord jednego dnia w pliku indeksu (wartości w jednostkach stałoprzecinkowych kanałów)
+struct __attribute__((packed)) DayIndexRecord {
+  uint16_t day;                        // Numer dnia (dni od 2000-01-01)
+  uint16_t count;                      // Liczba pomiarów z tego dnia
+  int32_t sum[CHANNEL_COUNT];          // Suma pomiarów z dnia
+  int16_t minValue[CHANNEL_COUNT];     // Najmniejsza wartość z dnia
+  int16_t maxValue[CHANNEL_COUNT];     // Największa wartość z dnia
+  uint8_t checksum;                    // Suma kontrolna rekordu (wykrywanie uszkodzonych danych)
+};
+
+bool dayIndexReady = false; // Czy indeks dni.idx jest aktualny i może zastąpić przeszukiwanie pliku CSV
+
+// --- Silnik agregacji ---
+// Okno agregacji: zakres dni, dla którego silnik zbiera statystyki w jednym przejściu po danych
+// (np. dzisiaj, wczoraj, ostatnie 7 dni, ostatnie 30 dni, bieżący miesiąc kalendarzowy)
+struct AggWindow {
+  uint16_t firstDay;                   // Pierwszy dzień okna (numer dnia, włącznie)
+  uint16_t lastDay;                    // Ostatni dzień okna (numer dnia, włącznie)
+  uint32_t count;                      // Liczba pomiarów w oknie
+  int32_t sum[CHANNEL_COUNT];          // Suma pomiarów (jednostki stałoprzecinkowe kanałów)
+  int16_t minValue[CHANNEL_COUNT];     // Najmniejsza wartość w oknie
+  int16_t maxValue[CHANNEL_COUNT];     // Największa wartość w oknie
+  uint8_t daysWithData;                // Liczba dni, w których były pomiary
+  float dailyMeanSum[CHANNEL_COUNT];   // Suma średnich dziennych (do średniej ze średnich dziennych)
+};
+
+// Profil dobowy: średnie wartości dla każdej godziny doby z wybranego zakresu dni
+// Wymaga pojedynczych wierszy (nie wystarczą rekordy dzienne), więc zawsze jest liczony z pliku CSV.
+struct HourProfile {
+  uint16_t firstDay;                   // Pierwszy dzień zakresu (numer dnia, włącznie)
+  uint16_t lastDay;                    // Ostatni dzień zakresu (numer dnia, włącznie)
+  uint16_t count[24];                  // Liczba pomiarów dla każdej godziny
+  int32_t sum[24][CHANNEL_COUNT];      // Suma pomiarów dla każdej godziny (jednostki stałoprzecinkowe)
+};
+
+// Wiersze paczki zapisu, których nie ma jeszcze na karcie - dokładane w RAM do danych czytanych z karty
+// Paczka obejmuje najwyżej kilkanaście minut, więc wiersze pochodzą z co najwyżej dwóch dni.
+struct AggPending {
+  DayIndexRecord days[2];              // Rekordy dzienne z wierszy paczki
+  bool added[2];                       // Czy rekord został już dołożony do okien
+  uint8_t dayCount;                    // Liczba dni w paczce
+};
+
+AggPending *aggPending = NULL; // Paczka dołączana przez aggAddDay() do dni czytanych z karty (NULL - brak)
+
+// --- Bufor pierścieniowy ostatnich pomiarów godzinowych ---
+// Ostatnie 168 godzin (7 dni) trzymane w pamięci RAM w postaci stałoprzecinkowej (10 bajtów na godzinę):
+// średnia z pomiarów danej godziny i ich liczba, dzięki czemu ekrany "Dzis", "Wcz" i "Tyg" nie muszą w ogóle
+// sięgać do karty SD, niezależnie od tego, jak często zapisywane są pomiary.
+#define RING_SIZE 168          // Pojemność bufora: 7 dni po 24 godziny
+#define RING_LINE_ESTIMATE 48  // Przybliżona długość linii pliku CSV w bajtach (do szukania początku końcówki pliku)
+
+// Jedna godzina pomiarów w buforze
+struct HourSample {
+  uint16_t day;                        // Numer dnia pomiarów
+  uint8_t hour;                        // Godzina pomiarów (0-23)
+  uint8_t count;                       // Liczba pomiarów z tej godziny
+  int16_t value[CHANNEL_COUNT];        // Średnie wartości kanałów (jednostki stałoprzecinkowe kanałów)
+};
+
+HourSample hourRing[RING_SIZE]; // Bufor pierścieniowy pomiarów (najstarszy jest nadpisywany jako pierwszy)
+uint8_t ringHead = 0;           // Indeks miejsca na następny pomiar
+uint8_t ringCount = 0;          // Liczba pomiarów w buforze
+bool ringComplete = false;      // Czy bufor zawiera wszystkie pomiary z karty (nic nie zostało z niego usunięte)
+uint16_t ringEvictedDay = 0;    // Dzień ostatniego pomiaru usuniętego z bufora - późniejsze dni są w buforze w całości
+int32_t ringHourSum[CHANNEL_COUNT]; // Suma pomiarów najnowszej godziny w buforze (do dokładnej średniej godzinowej)
+
+// --- Statystyki bieżące ---
+// Statystyki dnia liczone przyrostowo z każdego odczytu czujnika (stały koszt na pomiar, bez karty SD):
+// minimum i maksimum z czasem wystąpienia oraz średnia i wariancja metodą Welforda (bez sumy kwadratów,
+// która w pojedynczej precyzji traciłaby dokładność). Statystyki są zerowane o północy.
+#define PRESSURE_TENDENCY_H 3  // Okres tendencji barycznej w godzinach (jak w depeszach synoptycznych)
+
+// Statystyki jednego kanału pomiarowego
+struct ChannelStats {
+  uint16_t count;           // Liczba pomiarów
+  float mean;               // Średnia bieżąca
+  float m2;                 // Suma kwadratów odchyleń od średniej (wariancja = m2 / (count - 1))
+  float minValue;           // Najmniejsza wartość
+  float maxValue;           // Największa wartość
+  uint32_t minTime;         // Czas najmniejszej wartości (sekundy od 2000-01-01)
+  uint32_t maxTime;         // Czas największej wartości (sekundy od 2000-01-01)
+};
+
+ChannelStats dayStats[CHANNEL_COUNT]; // Statystyki bieżącego dnia (kolejność kanałów jak w CSVRow)
+uint16_t statsDay = 0;          // Dzień, którego dotyczą statystyki (numer dnia)
+uint32_t statsStart = 0;        // Czas pierwszego pomiaru w statystykach (późniejszy niż północ po restarcie)
+
+// --- Wykres historii ---
+// Ekran "Wykr" rysuje przebieg jednego kanału (np. temperatury) z ostatnich 24 godzin, 7 dni lub 30 dni.
+// Jedna kolumna pikseli to jeden przedział czasu z minimum, maksimum i średnią pomiarów (GRAPH_COLUMNS przedziałów
+// na zakres), więc rysowanie czyta najwyżej GRAPH_COLUMNS rekordów zamiast tysięcy wierszy dziennika. Przedziały
+// są liczone przyrostowo z kolejnych zapisywanych pomiarów: w RAM jest tylko bieżący (otwarty) przedział każdego
+// zakresu, a zamknięte trafiają do pliku wykres.bin - dla każdego zakresu bufor pierścieniowy GRAPH_COLUMNS
+// rekordów (rekord przedziału n leży w miejscu n % GRAPH_COLUMNS). Nagłówek pliku pamięta czas, od którego
+// pomiary nie są jeszcze w zamkniętych przedziałach (osobno dla każdego zakresu) - przy starcie te pomiary są
+// odtwarzane z dziennika dane.bin (albo z plików CSV). Kolumny są rysowane pionowymi odcinkami (minimum-maksimum
+// i linia średniej), a gdy rysowanie przekroczy GRAPH_BUDGET_US, dalsze kolumny dorysowuje kolejny przebieg
+// zadania rysowania.
+#define GRAPH_FILE "wykres.bin"     // Nazwa pliku przedziałów wykresu na karcie SD
+#define GRAPH_VERSION 1             // Wersja formatu pliku (zmiana formatu wymusza przebudowę)
+#define GRAPH_COLUMNS 120           // Liczba przedziałów (kolumn pikseli) na zakres
+#define GRAPH_RANGES 3              // Liczba zakresów: 24 godziny, 7 dni, 30 dni
+#define GRAPH_NO_BUCKET 0xFFFFFFFF  // Numer przedziału pustego rekordu
+#define GRAPH_X 34                  // Lewa krawędź obszaru wykresu (z lewej strony etykiety osi wartości)
+#define GRAPH_TOP 24                // Górna krawędź obszaru wykresu
+#define GRAPH_HEIGHT 72             // Wysokość obszaru wykresu w pikselach (pod nim etykiety osi czasu)
+#define GRAPH_AREA_TOP 20           // Obszar czyszczony przy rysowaniu wykresu: od linii pod nagłówkiem...
+#define GRAPH_AREA_HEIGHT 88        // ...do paska przycisków
+#define GRAPH_BUDGET_US 40000       // Najdłuższy czas rysowania kolumn w jednym przebiegu (reszta w następnym)
+#define GRAPH_GRID 0x2945           // Kolor linii pomocniczej (środek osi wartości)
+
+// Długość przedziału w sekundach: 24 godziny, 7 dni i 30 dni podzielone na GRAPH_COLUMNS kolumn
+const uint32_t GRAPH_BUCKET_S[GRAPH_RANGES] = {720, 5040, 21600};
+// Nazwy zakresów do nagłówka ekranu i etykiety początku osi czasu (pamięć programu); nazwa, kolor linii i dokładność
+// etykiet osi wartości pochodzą z tabeli kanałów
+const char graphRangeNames[][7] PROGMEM = {"24 h", "7 dni", "30 dni"};
+const char graphRangeStarts[][5] PROGMEM = {"-24h", "-7d", "-30d"};
+
+// Nagłówek pliku przedziałów wykresu
+struct __attribute__((packed)) GraphHeader {
+  char magic[4];            // Znacznik pliku "SGRF"
+  uint8_t version;          // Wersja formatu (GRAPH_VERSION)
+  uint8_t recordSize;       // Rozmiar rekordu przedziału w bajtach (kontrola zgodności)
+  uint8_t columns;          // Liczba rekordów na zakres (GRAPH_COLUMNS)
+  uint32_t syncTime[GRAPH_RANGES]; // Początek otwartego przedziału każdego zakresu - wcześniejsze pomiary są już
+                                   // w zamkniętych przedziałach w pliku (0 - plik pusty)
+};
+
+// Przedział wykresu (wartości w jednostkach stałoprzecinkowych kanałów)
+struct __attribute__((packed)) GraphBucket {
+  uint32_t number;                     // Numer przedziału (czas / długość przedziału) lub GRAPH_NO_BUCKET
+  uint16_t count;                      // Liczba pomiarów w przedziale
+  int32_t sum[CHANNEL_COUNT];          // Suma pomiarów (do średniej)
+  int16_t minValue[CHANNEL_COUNT];     // Najmniejsza wartość
+  int16_t maxValue[CHANNEL_COUNT];     // Największa wartość
+};
+
+GraphBucket graphOpen[GRAPH_RANGES]; // Bieżące przedziały zakresów (zapisywane do pliku po zamknięciu)
+bool graphReady = false;        // Czy plik wykres.bin jest aktualny
+uint8_t graphView = 0;          // Wyświetlany wykres: kanał * GRAPH_RANGES + zakres (zmiana przyciskiem odświeżania)
+uint8_t graphColumn = GRAPH_COLUMNS; // Następna kolumna do narysowania (GRAPH_COLUMNS - wykres narysowany w całości)
+uint32_t graphEnd = 0;          // Numer przedziału ostatniej kolumny rysowanego wykresu
+int16_t graphLow = 0;           // Wartość na dole osi wartości rysowanego wykresu
+int16_t graphHigh = 0;          // Wartość na górze osi wartości
+int16_t graphLastY = -1;        // Położenie średniej w poprzedniej kolumnie (-1 - brak, linia się urywa)
+bool graphShown = false;        // Czy obszar wykresu jest narysowany (przy zmianie ekranu trzeba go wyczyścić)
+
+// --- Binarny dziennik pomiarów ---
+// Plik dane.bin prowadzony obok plików CSV: pomiary w postaci stałoprzecinkowej, skompresowane różnicowo (zwykle
+// 1 bajt czasu i 1-2 bajty na kanał zamiast ok. 45 bajtów tekstu). Plik jest podzielony na bloki wielkości sektora
+// karty; pierwszy sektor zajmuje nagłówek. Blok zaczyna się od nagłówka BinLogBlock z numerem i czasem pierwszego
+// rekordu oraz jego wartościami (podstawa bloku), a dalej każda kolumna (czas i każdy kanał) ma w bloku własny
+// obszar BINLOG_REGION bajtów z różnicami kolejnych rekordów zapisanymi jako liczby zmiennej długości (varint,
+// 7 bitów na bajt) po przekodowaniu zig-zag (małe różnice ujemne i dodatnie dają małe liczby). Kolumna czasu
+// zapisuje różnicę odstępu od poprzedniego odstępu, więc przy regularnym zapisie same zera. Blok zamyka się,
+// gdy różnica którejś kolumny nie mieści się w jej obszarze. Każda kolumna ma w nagłówku bloku sumę CRC-16
+// (niezmiennej części nagłówka i bajtów kolumny), sprawdzaną po odczytaniu bloku do końca.
+// Rekordy leżą w kolejności czasu: dzień jest znajdowany wyszukiwaniem binarnym po czasach pierwszych rekordów
+// bloków, a odczyt dekoduje blok po bloku kursorem BinLogCursor (stały, mały bufor w RAM). Zapytanie o jeden kanał
+// dekoduje tylko kolumnę czasu i tego kanału. Eksport do eksport.csv odtwarza dotychczasowy układ pliku CSV.
+#define BINARY_LOG 1                // 1 - prowadź binarny dziennik obok pliku CSV, 0 - tylko plik CSV
+#define BINLOG_FILE "dane.bin"      // Nazwa pliku dziennika binarnego na karcie SD
+#define BINLOG_VERSION 4            // Wersja formatu dziennika (zmiana formatu wymusza konwersję od nowa)
+#define BINLOG_COLUMNS (1 + CHANNEL_COUNT) // Kolumny bloku: czas (0) i kanały (1 + numer kanału)
+#define BINLOG_REGION ((SD_SECTOR - sizeof(BinLogBlock)) / BINLOG_COLUMNS) // Obszar kolumny w bloku (121 B przy 3 kanałach)
+#define BINLOG_ALL_CHANNELS 0xFF    // Kursor dekoduje wszystkie kanały (inaczej - tylko kanał o podanym numerze)
+#define BINLOG_CHUNK 8              // Bufor kursora na kolumnę (bajty czytane z karty naraz)
+#define EXPORT_FILE "eksport.csv"   // Plik CSV tworzony z dziennika binarnego dla zewnętrznych narzędzi
+#define LOG_INTERVAL_S 60           // Nominalny odstęp między pomiarami w sekundach (zapis co minutę)
+
+// Nagłówek pliku dziennika binarnego
+struct __attribute__((packed)) BinLogHeader {
+  char magic[4];           // Znacznik pliku "SBIN"
+  uint8_t version;         // Wersja formatu (BINLOG_VERSION)
+  uint8_t recordSize;      // Rozmiar rekordu BinLogRecord w bajtach (kontrola zgodności)
+  uint16_t sampleInterval; // Nominalny odstęp między pomiarami w sekundach (pierwsze przybliżenie przy szukaniu dnia)
+  uint16_t logMonth;       // Miesiąc pliku CSV, do którego dziennik jest aktualny
+  uint32_t logOffset;      // Miejsce w tym pliku, do którego dziennik jest aktualny
+  uint8_t channels;        // Liczba kanałów w blokach (CHANNEL_COUNT)
+  uint32_t recordCount;    // Liczba rekordów w dzienniku
+};
+
+// Rekord pojedynczego pomiaru (wynik dekodowania; w tej postaci wysyłany przy pobieraniu)
+struct __attribute__((packed)) BinLogRecord {
+  uint32_t time;                // Czas pomiaru w sekundach od 2000-01-01 00:00:00
+  int16_t value[CHANNEL_COUNT]; // Wartości kanałów (jednostki stałoprzecinkowe kanałów)
+};
+
+// Nagłówek bloku dziennika (początek sektora); pola do base są niezmienne i wchodzą do sum CRC kolumn
+struct __attribute__((packed)) BinLogBlock {
+  uint32_t first;                 // Numer pierwszego rekordu bloku w dzienniku
+  uint32_t baseTime;              // Czas pierwszego rekordu
+  int16_t base[CHANNEL_COUNT];    // Wartości kanałów pierwszego rekordu
+  uint16_t count;                 // Liczba rekordów w bloku
+  uint8_t used[BINLOG_COLUMNS];   // Zajęte bajty obszaru każdej kolumny
+  uint16_t crc[BINLOG_COLUMNS];   // CRC-16 niezmiennej części nagłówka i zajętych bajtów kolumny
+};
+
+// Kursor dekodujący dziennik rekord po rekordzie (blok po bloku, bez wczytywania całego bloku do RAM)
+struct BinLogCursor {
+  BinLogBlock head;                           // Nagłówek bieżącego bloku
+  uint32_t block;                             // Numer bieżącego bloku (0 - pierwszy blok za nagłówkiem pliku)
+  uint16_t index;                             // Liczba rekordów bloku odczytanych do tej pory
+  uint8_t channel;                            // Dekodowany kanał albo BINLOG_ALL_CHANNELS
+  uint32_t interval;                          // Odstęp między dwoma ostatnimi rekordami (przewidywany odstęp następnego)
+  uint8_t read[BINLOG_COLUMNS];               // Bajty kolumny wczytane z karty
+  uint8_t fill[BINLOG_COLUMNS];               // Bajty w buforze kolumny
+  uint8_t next[BINLOG_COLUMNS];               // Następny bajt bufora do zdekodowania
+  uint8_t buf[BINLOG_COLUMNS][BINLOG_CHUNK];  // Bufory kolumn
+  uint16_t crc[BINLOG_COLUMNS];               // Suma CRC wczytanych bajtów kolumny
+  BinLogRecord row;                           // Ostatnio odczytany rekord
+};
+
+bool binLogReady = false;       // Czy dziennik dane.bin jest aktualny i może zastąpić przeszukiwanie pliku CSV
+uint32_t binLogLastTime = 0;    // Czas ostatniego rekordu w dzienniku (nowe rekordy muszą być późniejsze)
+BinLogBlock binLogTail;         // Nagłówek ostatniego (otwartego) bloku - dopisywanie bez czytania karty
+int16_t binLogTailValues[CHANNEL_COUNT]; // Wartości ostatniego rekordu (podstawa różnic następnego)
+uint32_t binLogTailInterval = 0; // Odstęp między dwoma ostatnimi rekordami
+
+// --- Zapis na kartę SD w paczkach sektorowych ---
+// Wiersze nie trafiają na kartę pojedynczo: są zbierane w buforze w RAM i zapisywane razem, gdy paczka dojdzie
+// do granicy 512-bajtowego sektora pliku miesiąca (karta zapisuje całe sektory, więc zapis pojedynczego wiersza
+// to odczyt, modyfikacja i zapis całego sektora oraz aktualizacja wpisu katalogu) albo gdy minie LOG_FLUSH_S
+// od pierwszego wiersza paczki. Paczka zawiera tylko całe wiersze.
+// Przed zapisem do pliku CSV paczka trafia do pliku zapis.jnl (dziennik zapisu z numerem kolejnym). Jeśli zasilanie
+// zaniknie w trakcie zapisu do pliku CSV, przy starcie paczka jest zapisywana ponownie w to samo miejsce pliku,
+// więc koniec pliku nigdy nie zostaje z połową wiersza. Utracić można tylko paczkę, która nie trafiła jeszcze do
+// zapis.jnl (najwyżej LOG_FLUSH_S sekund pomiarów).
+#define SD_SECTOR 512               // Rozmiar sektora karty SD w bajtach
+#define LOG_LINE_MAX 64             // Maksymalna długość jednego wiersza CSV (z "\r\n")
+#define LOG_FLUSH_S 900             // Najdłuższy czas oczekiwania wiersza w buforze na zapis (sekundy; przy zapisie co minutę
+                                    // sektor zapełnia się po ok. 11 minutach, więc zwykle paczkę kończy granica sektora)
+#define JOURNAL_FILE "zapis.jnl"    // Nazwa pliku dziennika zapisu na karcie SD
+
+// Nagłówek pliku dziennika zapisu (za nagłówkiem leży length bajtów paczki)
+struct __attribute__((packed)) LogJournalHeader {
+  char magic[4];           // Znacznik pliku "SJNL"
+  uint32_t sequence;       // Numer kolejny paczki (rośnie z każdym zapisem)
+  uint16_t month;          // Miesiąc pliku CSV, do którego należy paczka
+  uint32_t offset;         // Miejsce w tym pliku, od którego paczka ma leżeć
+  uint16_t length;         // Długość paczki w bajtach
+  uint16_t checksum;       // Suma kontrolna nagłówka i paczki (wykrywa przerwany zapis dziennika)
+};
+
+// Wyjście Print zapisujące znaki do bufora w RAM (wiersz formatowany przez printCSVRow() przed dołożeniem do paczki)
+struct LineBuffer : public Print {
+  uint8_t text[LOG_LINE_MAX]; // Znaki wiersza (bez '\0')
+  uint8_t length = 0;         // Liczba znaków w buforze
+  size_t write(uint8_t c) override {
+    if (length >= sizeof(text)) return 0; // Wiersz za długi - nadmiarowe znaki są odrzucane
+    text[length++] = c;
+    return 1;
+  }
+};
+
+uint8_t logBuffer[SD_SECTOR + LOG_LINE_MAX]; // Paczka wierszy czekających na zapis (do granicy sektora + 1 wiersz)
+uint16_t logBufferLength = 0;   // Liczba bajtów w paczce
+uint16_t logBufferLimit = 0;    // Długość, przy której paczka kończy się na granicy sektora pliku miesiąca
+uint16_t logBufferMonth = LOG_NO_MONTH; // Miesiąc wierszy paczki (paczka nie przechodzi przez granicę miesiąca)
+uint32_t logBufferTime = 0;     // Czas pierwszego wiersza paczki (sekundy od 2000-01-01) - liczenie terminu zapisu
+uint32_t logBufferLastTime = 0; // Czas ostatniego wiersza paczki
+uint32_t logSequence = 0;       // Numer ostatniej paczki zapisanej w dzienniku zapisu
+
+char serialCommand[40];         // Bufor na polecenie odbierane z monitora szeregowego
+uint8_t serialCommandLength = 0; // Liczba znaków polecenia odebranych do tej pory
+
+bool sdReady = false;           // Czy karta SD została poprawnie zainicjalizowana
+
+// --- Kolejka pomiarów w pamięci EEPROM ---
+// Gdy karty SD nie ma albo zapis paczki się nie udał, pomiary trafiają do kolejki w wewnętrznej pamięci EEPROM
+// (4 KB, zawartość przetrwa zanik zasilania). Kolejka to pierścień pozycji QueueSlot: każdy pomiar zajmuje następną
+// pozycję, więc zapisy rozkładają się równo na całą pamięć (komórka wytrzymuje ok. 100 000 zapisów, a przy zapisie
+// co minutę każda pozycja jest zapisywana raz na kilka godzin), a biblioteka zapisuje tylko zmienione bajty.
+// Pozycja ma numer kolejny i sumę CRC-16: po starcie najnowszy rekord to poprawna pozycja z największym numerem,
+// a pozycja uszkodzona przerwanym zapisem jest pomijana. Pełna kolejka nadpisuje najstarszy rekord.
+// Niedostępna karta jest uruchamiana ponownie co SD_PROBE_S sekund; potem zadanie zapisu przepisuje kolejkę do
+// plików CSV (przez paczki) po QUEUE_DRAIN_BATCH rekordów na przebieg, a nowe pomiary czekają w kolejce za nimi.
+// Rekordy nie są kasowane po przepisaniu - przy starcie czekają tylko rekordy późniejsze niż ostatni wiersz na karcie.
+#define QUEUE_EEPROM_START 0        // Pierwszy adres kolejki w pamięci EEPROM
+#define QUEUE_SLOTS ((E2END + 1 - QUEUE_EEPROM_START) / sizeof(QueueSlot)) // Liczba pozycji (292 przy 3 kanałach)
+#define QUEUE_DRAIN_BATCH 32        // Najwięcej rekordów przepisywanych na kartę w jednym przebiegu zadania zapisu
+#define QUEUE_GAP_S (2 * LOG_INTERVAL_S) // Odstęp rekordów kolejki, powyżej którego między nimi mogą brakować pomiarów
+#define SD_PROBE_S 300              // Odstęp między próbami uruchomienia niedostępnej karty (próba bez karty trwa
+                                    // tyle, co limit czasu inicjalizacji biblioteki SD - do ok. 2 s)
+
+// Pozycja kolejki: jeden pomiar
+struct __attribute__((packed)) QueueSlot {
+  uint16_t sequence;            // Numer kolejny rekordu (rośnie z każdym zapisem, z przepełnieniem)
+  uint32_t time;                // Czas pomiaru w sekundach od 2000-01-01 00:00:00
+  int16_t value[CHANNEL_COUNT]; // Wartości kanałów (jednostki stałoprzecinkowe kanałów)
+  uint16_t crc;                 // CRC-16 pozostałych pól
+};
+
+uint16_t queueHead = 0;         // Pozycja, na którą trafi następny rekord
+uint16_t queueCount = 0;        // Liczba rekordów przed queueHead czekających na zapis na kartę
+uint16_t queueSequence = 0;     // Numer ostatnio zapisanego rekordu
+uint16_t queueOverwritten = 0;  // Liczba rekordów nadpisanych w pełnej kolejce przed zapisem na kartę
+bool queueDraining = false;     // Czy trwa przepisywanie kolejki (błąd zapisu paczki zostawia wtedy rekordy w kolejce)
+uint32_t cardLastTime = 0;      // Czas ostatniego wiersza zapisanego na kartę (wcześniejsze rekordy kolejki już na niej są)
+uint32_t sdProbeTime = 0;       // Czas ostatniej próby uruchomienia karty
+uint16_t graphQueueNext = 0;    // Następny rekord kolejki do wykresu rysowanego bez pliku wykres.bin
+
+// --- Pobieranie dziennika przez port szeregowy ---
+// Dane można pobrać bez wyjmowania karty SD. Polecenia tekstowe (zakończone końcem linii):
+//   lista              - pliki miesięcy z rozmiarami ("plik /2026/03.csv 162045"), liczba rekordów dziennika
+//                        binarnego ("dziennik 43824"), kanały z kolumną CSV i skalą ("kanal Pressure 10", w kolejności
+//                        wartości w rekordzie) i wiersz "koniec LICZBA_PLIKÓW"
+//   pobierz OD DO [N]  - rekordy dziennika dane.bin z dni OD..DO (RRRR-MM-DD, włącznie) w ramkach binarnych;
+//                        N - liczba rekordów zakresu już odebranych (wznowienie przerwanego pobierania)
+//   przerwij           - zatrzymanie pobierania
+// Ramka to nagłówek ExportFrameHeader, count rekordów BinLogRecord (czas i wartości kanałów, 10 bajtów przy 3 kanałach;
+// wiersze złożone z kolumn pliku dane.bin) i CRC-16/CCITT
+// nagłówka i rekordów (młodszy bajt pierwszy). Pobieranie to ramka 'S' (index - liczba rekordów zakresu), ramki 'D'
+// (index - numer pierwszego rekordu ramki w zakresie) i ramka 'E' (index - liczba rekordów zakresu); błąd to opis
+// tekstowy i ramka 'B'. Między ramkami mogą pojawić się zwykłe komunikaty tekstowe - odbiornik rozpoznaje ramki
+// po znaczniku i sumie CRC. Ramki wysyła zadanie planisty porcjami po EXPORT_SLICE_MS, więc pomiary, zapis
+// i przyciski działają w trakcie pobierania, a przepustowość ogranicza tylko prędkość portu.
+#define SERIAL_BAUD 500000          // Prędkość portu szeregowego (przy zegarze 16 MHz bez błędu podziału, w przeciwieństwie do 115200)
+#define EXPORT_FRAME_RECORDS 24     // Liczba rekordów w ramce (240 bajtów danych przy 3 kanałach, 10 bajtów nagłówka i CRC)
+#define EXPORT_SLICE_MS 50          // Najdłuższy czas wysyłania ramek w jednym przebiegu zadania
+#define EXPORT_SYNC0 0xA5           // Pierwszy bajt znacznika początku ramki
+#define EXPORT_SYNC1 0x5A           // Drugi bajt znacznika początku ramki
+
+// Nagłówek ramki pobierania
+struct __attribute__((packed)) ExportFrameHeader {
+  uint8_t sync[2];         // Znacznik początku ramki (EXPORT_SYNC0, EXPORT_SYNC1)
+  char type;               // Rodzaj ramki: 'S' - początek, 'D' - dane, 'E' - koniec, 'B' - błąd
+  uint8_t count;           // Liczba rekordów w ramce
+  uint32_t index;          // Numer rekordu w zakresie lub liczba rekordów zakresu (wg rodzaju ramki)
+};
+
+File exportFile;                // Plik dane.bin otwarty na czas pobierania
+bool exportActive = false;      // Czy trwa pobieranie
+uint32_t exportFirst = 0;       // Numer (w pliku) pierwszego rekordu zakresu
+uint32_t exportNext = 0;        // Numer (w pliku) następnego rekordu do wysłania
+uint32_t exportEnd = 0;         // Numer (w pliku) rekordu za ostatnim rekordem zakresu
+BinLogCursor exportCursor;      // Kursor dekodujący rekordy do wysłania (stoi przed rekordem exportNext)
+
+// --- Ekran w trybie zachowanym ---
+// Każda linia tekstu na ekranie to pole o stałym położeniu, które pamięta ostatnio narysowany tekst.
+// Pole jest przerysowywane tylko wtedy, gdy zmienił się jego tekst lub kolor: tekst z nieprzezroczystym tłem
+// nadpisuje poprzedni bez czyszczenia ekranu (brak migotania), a tylko wystająca końcówka dłuższego
+// starego tekstu jest zamalowywana tłem. Pasek przycisków jest rysowany tylko po zmianie ekranu.
+#define FIELD_COUNT 9          // Liczba pól ekranu: nagłówek i 8 linii danych
+#define FIELD_TEXT_LEN 27      // Maksymalna długość tekstu pola + '\0' (26 znaków po 6 pikseli mieści się w 160 pikselach)
+#define FIELD_TITLE 0          // Pole nagłówka ekranu (wyśrodkowane, y = 10)
+#define FIELD_LINE 1           // Pierwsza linia danych (y = 30, kolejne co 8 pikseli)
+#define FIELD_LINE_X 10        // Wcięcie linii danych od lewej krawędzi
+#define FIELD_CENTERED -1      // Pozycja x oznaczająca tekst wyśrodkowany
+#define BACKGROUND ST77XX_BLACK // Kolor tła ekranu
+
+// Stan pola ekranu - to, co aktualnie widać na wyświetlaczu
+struct ScreenField {
+  char text[FIELD_TEXT_LEN]; // Ostatnio narysowany tekst
+  uint16_t color;            // Kolor ostatnio narysowanego tekstu
+  int16_t x;                 // Pozycja x narysowanego tekstu
+  int16_t width;             // Szerokość narysowanego tekstu w pikselach (0 - pole puste)
+};
+
+ScreenField screenFields[FIELD_COUNT]; // Pola ekranu (na starcie wszystkie puste, jak wyczyszczony ekran)
+int buttonsDrawnIndex = -1;     // Ekran podświetlony na narysowanym pasku przycisków (-1 - pasek nienarysowany)
+uint32_t framePixels = 0;       // Liczba pikseli wysłanych do wyświetlacza w bieżącej (po rysowaniu - ostatniej) ramce
+uint32_t framePixelsMax = 0;    // Najwięcej pikseli w jednej ramce od startu lub polecenia "stats zeruj"
+
+// --- Planista zadań i obsługa przycisków ---
+// Pętla loop() nie czeka w delay(): w każdym przebiegu uruchamia tylko te zadania, których okres minął,
+// więc żadne zadanie nie blokuje pozostałych (np. przytrzymany przycisk nie wstrzymuje zapisu pomiarów).
+// Przyciski 1 i 2 zgłaszają zbocze przez przerwania zewnętrzne, a przycisk odświeżania (pin 7 nie ma
+// przerwania zewnętrznego) jest odpytywany. Drgania styków są odfiltrowywane programowo bez blokowania,
+// a potwierdzone naciśnięcia trafiają do kolejki zdarzeń.
+#define BUTTON_COUNT 3            // Liczba przycisków
+#define BUTTON_DEBOUNCE_MS 30     // Czas stabilnego stanu przycisku, po którym zmiana stanu jest uznawana
+#define EVENT_QUEUE_SIZE 8        // Pojemność kolejki zdarzeń przycisków
+#define SENSOR_TASK_MS 10000      // Okres odczytu czujnika (odświeżanie ekranu bieżących danych)
+#define LOG_TASK_MS 1000          // Okres sprawdzania, czy minął termin pomiaru do zapisu lub termin zapisu paczki
+#define BUTTON_LONG_MS 2000       // Czas przytrzymania przycisku, po którym zgłaszane jest zdarzenie przytrzymania
+
+const uint8_t EVENT_PREV = 0;     // Zdarzenie: poprzedni ekran (przycisk 1)
+const uint8_t EVENT_NEXT = 1;     // Zdarzenie: następny ekran (przycisk 2)
+const uint8_t EVENT_REFRESH = 2;  // Zdarzenie: odświeżenie danych (przycisk odświeżania)
+const uint8_t EVENT_DIAG = 3;     // Zdarzenie: ekran diagnostyczny (przytrzymanie przycisku odświeżania)
+const uint8_t EVENT_NONE = 0xFF;  // Brak zdarzenia (przycisk bez zdarzenia przytrzymania)
+
+// Stan przycisku
+struct Button {
+  uint8_t pin;                     // Pin przycisku (INPUT_PULLUP - wciśnięty przycisk to stan LOW)
+  uint8_t event;                   // Zdarzenie zgłaszane po naciśnięciu
+  uint8_t longEvent;               // Zdarzenie zgłaszane po przytrzymaniu przez BUTTON_LONG_MS (lub EVENT_NONE)
+  bool polled;                     // Czy pin jest odpytywany (brak przerwania zewnętrznego na tym pinie)
+  volatile bool edge;              // Wykryto zbocze opadające - naciśnięcie czeka na potwierdzenie
+  volatile unsigned long edgeTime; // Czas wykrycia zbocza (millis); przerwanie zapisuje go tylko przy edge == false
+  bool pressed;                    // Naciśnięcie zgłoszone - czekamy na stabilne puszczenie przycisku
+  unsigned long lowTime;           // Ostatni odczyt stanu LOW wciśniętego przycisku (millis)
+  bool held;                       // Zdarzenie przytrzymania zgłoszone - kolejne dopiero po puszczeniu przycisku
+};
+
+Button buttons[BUTTON_COUNT] = {
+  {button1Pin, EVENT_PREV, EVENT_NONE, false, false, 0, false, 0, false},
+  {button2Pin, EVENT_NEXT, EVENT_NONE, false, false, 0, false, 0, false},
+  {refreshButtonPin, EVENT_REFRESH, EVENT_DIAG, true, false, 0, false, 0, false},
+};
+
+uint8_t eventQueue[EVENT_QUEUE_SIZE]; // Kolejka zdarzeń przycisków (bufor pierścieniowy)
+uint8_t eventHead = 0;          // Indeks najstarszego zdarzenia w kolejce
+uint8_t eventCount = 0;         // Liczba zdarzeń w kolejce
+
+// Zadanie okresowe planisty
+struct Task {
+  void (*run)();                // Funkcja zadania
+  unsigned long period;         // Okres uruchamiania w ms (0 - w każdym przebiegu pętli)
+  unsigned long lastRun;        // Czas ostatniego uruchomienia (millis)
+  unsigned long maxMicros;      // Najdłuższy czas wykonania zadania w mikrosekundach
+};
+
+unsigned long loopMaxMicros = 0; // Najdłuższy przebieg pętli loop() - najgorsze opóźnienie reakcji na zdarzenie
+
+SensorData lastReading;         // Ostatni odczyt z czujników (aktualizowany przez zadanie pomiaru; pierwszy w setup())
+bool displayDirty = false;      // Czy ekran wymaga odświeżenia przez zadanie rysowania
+
+// --- Sondy czasu wykonania ---
+// Sonda to stały wpis tabeli zbierający czasy jednej operacji (micros() przed i po): liczbę pomiarów, minimum,
+// maksimum, sumę do średniej i histogram w przedziałach rosnących 4-krotnie od PROBE_FIRST_US. Zapis pomiaru to
+// kilka porównań i dodawań, więc sondy działają stale, także w zwykłej pracy stacji. Czas obejmuje operacje
+// zagnieżdżone (np. rysowanie ekranu średnich zawiera odczyt pliku CSV, a zapis pomiaru - zapis paczki).
+// Wyniki podaje polecenie "stats" i ukryty ekran diagnostyczny (przytrzymanie przycisku odświeżania).
+#define PROBE_BUCKETS 8        // Liczba przedziałów histogramu (ostatni bez górnej granicy)
+#define PROBE_FIRST_US 64      // Górna granica pierwszego przedziału w us (kolejne: 256, 1024, ... 262144 us)
+
+const uint8_t PROBE_LOOP = 0;    // Przebieg pętli loop()
+const uint8_t PROBE_CLOCK = 1;   // Odczyt zegara RTC (I2C; synchronizacja zegara programowego)
+const uint8_t PROBE_SENSOR = 2;  // Pomiar i odczyt rejestrów BME280 (I2C)
+const uint8_t PROBE_SAVE = 3;    // Zapis pomiaru (wiersz do paczki; co kilka minut z zapisem paczki)
+const uint8_t PROBE_FLUSH = 4;   // Zapis paczki: dziennik zapisu, plik miesiąca i flush()
+const uint8_t PROBE_CSV = 5;     // Przejście po plikach CSV (agregacja, wypełnienie bufora ostatnich pomiarów)
+const uint8_t PROBE_SCREEN = 6;  // Odświeżenie ekranu
+
+// Liczniki jednej sondy
+struct Probe {
+  uint32_t count;                     // Liczba pomiarów
+  uint32_t minMicros;                 // Najkrótszy czas w us
+  uint32_t maxMicros;                 // Najdłuższy czas w us
+  uint64_t totalMicros;               // Suma czasów w us (do średniej)
+  uint16_t histogram[PROBE_BUCKETS];  // Liczby pomiarów w przedziałach czasu (zatrzymują się na 65535)
+};
+
+// Nazwy sond do raportu i ekranu diagnostycznego (pamięć programu, kolejność numerów PROBE_*)
+const char probeNames[][8] PROGMEM = {"petla", "zegar", "czujnik", "zapis", "paczka", "csv", "ekran"};
+const uint8_t PROBE_COUNT = sizeof(probeNames) / sizeof(probeNames[0]); // Liczba sond
+
+Probe probes[PROBE_COUNT]; // Liczniki sond (zerowane przy starcie jak każda zmienna globalna)
+
+// --- Pamięć RAM ---
+// Wolna pamięć to obszar między końcem sterty (albo zmiennych statycznych, gdy sterta nie jest używana) a stosem.
+// Przy starcie obszar ten jest wypełniany wzorem STACK_PAINT; liczba bajtów wzoru, których stos nigdy nie nadpisał,
+// to najmniejszy zapas pamięci od startu (znacznik najwyższego poziomu stosu). Bufory bibliotek (np. 512 B bufora
+// bloku karty SD) leżą w zmiennych statycznych i są wliczone w zajętą pamięć, a raport z czasu kompilacji
+// (host/pamiec.sh) pokazuje, które moduły ją zajmują.
+#define STACK_PAINT 0xA5       // Wzór wolnej pamięci
+#define STACK_GUARD 32         // Margines pod bieżącym wierzchołkiem stosu, który nie jest malowany (bajty)
+
+extern char __heap_start;      // Koniec zmiennych statycznych (.data i .bss) - symbol linkera avr-libc
+extern char *__brkval;         // Koniec sterty (0 - malloc() nie był wywołany)
+
+// --- Tryb oszczędzania energii ---
+// Po BACKLIGHT_TIMEOUT_S bez naciśnięcia przycisku i bez polecenia z portu szeregowego podświetlenie gaśnie,
+// a wyświetlacz przechodzi w uśpienie (zawartość ekranu zostaje w jego pamięci). Przy LOW_POWER procesor jest
+// wtedy usypiany (power-down) do najbliższego terminu: pomiaru do zapisu albo zapisu paczki. Budzi go licznik
+// czasu zegara PCF8563 (wyjście INT na pinie rtcInterruptPin) lub przycisk 1 albo 2. Piny 2 i 3 to przerwania
+// INT4 i INT5, które w uśpieniu wykrywają tylko stan niski, więc na czas snu są przełączane na LOW. Przycisk
+// odświeżania (pin 7) nie ma przerwania i nie budzi procesora. Pierwsze naciśnięcie przy zgaszonym ekranie tylko
+// go włącza. W trakcie snu timer millis() stoi - planista liczy okresy zadań od uptimeMillis(). Bajty odebrane przez
+// port szeregowy w czasie snu przepadają, więc stacja nie zasypia w trakcie pobierania dziennika.
+#define LOW_POWER 1                // 1 - usypiaj procesor między terminami przy zgaszonym ekranie, 0 - bez usypiania
+#define BACKLIGHT_TIMEOUT_S 60     // Czas bezczynności, po którym gaśnie podświetlenie (sekundy)
+#define SLEEP_MIN_S 2              // Najkrótszy sen (sekundy) - przy bliższym terminie procesor czeka bez usypiania
+#define PCF8563_ADDRESS 0x51       // Adres I2C zegara PCF8563
+#define PCF8563_CONTROL_2 0x01     // Rejestr Control_status_2: flagi i zezwolenia przerwań
+#define PCF8563_TIMER_CONTROL 0x0E // Rejestr sterowania licznikiem czasu
+#define PCF8563_TIMER 0x0F         // Rejestr wartości początkowej licznika
+#define PCF8563_TIE 0x01           // Control_status_2: przerwanie licznika na wyjściu INT
+#define PCF8563_TE 0x80            // Timer_control: licznik włączony
+#define PCF8563_TIMER_1HZ 0x02     // Timer_control: licznik taktowany 1 Hz (odliczanie w sekundach, najwyżej 255)
+
+bool backlightOn = true;           // Czy podświetlenie i wyświetlacz są włączone
+unsigned long lastActivity = 0;    // Ostatnie naciśnięcie przycisku lub polecenie z portu (uptimeMillis())
+uint32_t sleptMillis = 0;          // Łączny czas snu procesora w ms (w tym czasie millis() stoi)
+uint32_t sleepCount = 0;           // Liczba uśpień procesora
+volatile uint32_t timerWakeCount = 0; // Liczba wybudzeń przez licznik zegara
+unsigned long dutyBaseMillis = 0;  // millis() przy wyzerowaniu pomiaru aktywności (polecenie "stats zeruj")
+uint32_t dutyBaseSlept = 0;        // sleptMillis przy wyzerowaniu pomiaru aktywności
+
+// --- Zegar programowy ---
+// Czas stacji (sekundy od 2000-01-01) jest liczony z uptimeMillis() od ostatniej synchronizacji z zegarem PCF8563,
+// więc odczyt czasu nie wymaga transakcji I2C. Synchronizacja następuje co CLOCK_SYNC_S, po każdym śnie procesora
+// i na polecenie "zegar". Zegar programowy odstaje od RTC o ułamek sekundy (faza sekundy RTC nie jest znana) plus
+// dryf zegara procesora od ostatniej synchronizacji. Jeśli przy synchronizacji oba zegary wskazują tę samą sekundę,
+// podstawa się nie zmienia, więc czas nie cofa się o ułamek sekundy przy każdej synchronizacji.
+#define CLOCK_SYNC_S 600              // Okres synchronizacji zegara programowego z RTC (sekundy)
+
+uint32_t clockBase = 0;               // Czas RTC przy ostatniej zmianie podstawy (sekundy od 2000-01-01)
+unsigned long clockBaseMillis = 0;    // uptimeMillis() przy ostatniej zmianie podstawy
+unsigned long clockSyncMillis = 0;    // uptimeMillis() przy ostatniej synchronizacji
+bool clockSynced = false;             // Czy zegar był już synchronizowany z RTC
+int32_t clockCorrection = 0;          // Korekta przy ostatniej synchronizacji (RTC minus zegar programowy, sekundy)
+uint32_t clockSyncCount = 0;          // Liczba synchronizacji z RTC
+
+// --- Odczyt czujnika BME280 ---
+// Cały pomiar (ciśnienie, temperatura, wilgotność) to 8 bajtów rejestrów 0xF7-0xFE odczytywanych w jednej
+// transakcji I2C i kompensowanych raz, całkowitoliczbowymi wzorami z noty katalogowej Bosch.
+// Funkcje readTemperature()/readPressure()/readHumidity()/readAltitude() biblioteki Adafruit robią osobną
+// transakcję dla każdej wielkości i za każdym razem ponownie czytają temperaturę.
+// Ustawienia poniżej pozwalają wybrać kompromis między czasem pomiaru, szumem i poborem prądu:
+// tryb wymuszony z nadpróbkowaniem x1 i bez filtra to zalecenie Bosch dla stacji pogodowej (pomiar ok. 8 ms).
+// Ustawienia dotyczą wszystkich czujników z listy BME280_ADDRESSES.
+#define BME_MODE Adafruit_BME280::MODE_FORCED              // MODE_FORCED - pomiar na żądanie, MODE_NORMAL - ciągły
+#define BME_OVERSAMPLING_T Adafruit_BME280::SAMPLING_X1    // Nadpróbkowanie temperatury
+#define BME_OVERSAMPLING_P Adafruit_BME280::SAMPLING_X1    // Nadpróbkowanie ciśnienia
+#define BME_OVERSAMPLING_H Adafruit_BME280::SAMPLING_X1    // Nadpróbkowanie wilgotności
+#define BME_FILTER Adafruit_BME280::FILTER_OFF             // Filtr IIR (wygładza szybkie zmiany ciśnienia)
+#define BME_STANDBY Adafruit_BME280::STANDBY_MS_1000       // Czas między pomiarami w trybie ciągłym
+
+// Współczynniki kalibracyjne czujnika (zapisane w nim fabrycznie, odczytywane raz przy starcie)
+struct BME280Calibration {
+  uint16_t T1;
+  int16_t T2, T3;
+  uint16_t P1;
+  int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+  uint8_t H1;
+  int16_t H2;
+  uint8_t H3;
+  int16_t H4, H5;
+  int8_t H6;
 };
 
-// --- Funkcja pomocnicza do centrowania tekstu na wyświetlaczu ---
-// text: tekst do wyświetlenia
-// y: pozycja pionowa (Y) tekstu na ekranie
+BME280Calibration bmeCalibration[SENSOR_COUNT]; // Współczynniki kalibracyjne czujników BME280
+
+// --- Deklaracje funkcji ---
+// Plik .cpp nie przechodzi przez automatyczne generowanie prototypów, które środowisko Arduino wykonuje dla
+// plików .ino, dlatego wszystkie funkcje są zadeklarowane tutaj (kolejność jak w dalszej części pliku).
+int16_t fieldY(uint8_t field);
+void fillFieldBackground(int16_t x, int16_t y, int16_t width);
+void drawField(uint8_t field, const char *text, int16_t x, uint16_t color);
+void drawFieldP(uint8_t field, const __FlashStringHelper *text, int16_t x, uint16_t color);
+void drawValueField(uint8_t field, const __FlashStringHelper *label, float value, const __FlashStringHelper *unit,
+                    uint16_t color);
+void drawExtremeField(uint8_t field, const __FlashStringHelper *label, float value, const __FlashStringHelper *unit,
+                      uint32_t time, uint16_t color);
+void drawChannelField(uint8_t field, uint8_t ch, float value, uint16_t color);
+void printChannelValue(uint8_t ch, float value);
+void drawAverageFields(uint8_t field, const SensorData &avg, uint16_t color);
+void printAverage(const SensorData &avg);
+void clearFieldsFrom(uint8_t field);
+void setup();
+void loop();
+void button1ISR();
+void button2ISR();
+void buttonEdge(Button &b);
+void pushEvent(uint8_t event);
+bool popEvent(uint8_t &event);
+void inputTask();
+void handleButtonEvent(uint8_t event);
+void sampleSensor(uint32_t time);
+void sensorTask();
+void logTask();
+void renderTask();
+void runTasks();
+void printTaskTimes();
+void probeRecord(uint8_t id, unsigned long elapsed);
+void probeReset();
+void printProbeStats();
+char *heapEnd();
+__attribute__((noinline)) uint16_t freeMemory();
+void paintStack();
+uint16_t stackHeadroom();
+void rtcISR();
+bool rtcWriteRegister(uint8_t reg, uint8_t value);
+void rtcStartTimer(uint8_t seconds);
+void rtcStopTimer();
+unsigned long uptimeMillis();
+float dutyCyclePercent();
+void setBacklight(bool on);
+void sleepFor(uint8_t seconds);
+void powerTask();
+uint32_t readRtcSeconds();
+void syncClock(uint32_t rtcSeconds);
+uint32_t clockSeconds();
+uint16_t clockDay();
+void printClock();
+bool bmeReadRegisters(uint8_t sensor, uint8_t reg, uint8_t *buf, uint8_t len);
+bool bmeReadCalibration(uint8_t sensor);
+bool bmeMeasure(uint8_t sensor, float quantities[QTY_COUNT]);
+SensorData noReading(uint32_t time);
+SensorData readSensor(uint32_t time);
+void saveDatatoSD(SensorData &currentReading);
+void printCSVRow(Print &out, const DateTime &now, const float values[CHANNEL_COUNT]);
+void printCSVHeader(Print &out);
+void drawScreenButtons(int activeIndex);
+void displayBME280();
+void updateDisplayForScreenIndex(int index);
+uint8_t screenKind(int index);
+void displayAverageScreen(int index);
+void displayDayStats(uint8_t field);
+void displayDiagnostics();
+int16_t graphY(int16_t value);
+bool graphScale(File &f, uint8_t range, uint8_t channel);
+void graphClearArea();
+void graphDrawFrame(uint8_t range, uint8_t channel);
+void graphDrawColumn(uint8_t column, const GraphBucket &b, uint8_t channel);
+void displayGraph();
+uint16_t dayNumber(const DateTime &date);
+int16_t channelScale(uint8_t ch);
+bool channelInRange(uint8_t ch, int32_t value);
+bool isReadingPlausible(const SensorData &reading);
+uint16_t dateToDay(uint16_t year, uint8_t month, uint8_t day);
+bool parseDigits(const char *&p, uint8_t count, uint16_t &value);
+bool parseFixed(const char *&p, int16_t scale, int16_t &value);
+bool parseDate(const char *&p, uint16_t &day);
+bool parseCSVLine(const char *line, CSVRow &row);
+void csvReaderStart(CSVReader &in, File &file, uint32_t start);
+bool csvFill(CSVReader &in);
+int16_t csvReadLine(CSVReader &in);
+bool readCSVRow(CSVReader &in, CSVRow &row);
+void printSkippedLines(const CSVReader &in);
+bool isRowPlausible(const CSVRow &row);
+SensorData calculateAverageFromCSV(int daysBack);
+uint16_t monthNumber(const DateTime &date);
+uint16_t dayToMonth(uint16_t day);
+char *partitionPath(char *path, uint16_t month);
+uint16_t findPartition(uint16_t from, uint16_t to, int8_t step);
+bool logReaderOpen(LogReader &r, uint16_t firstMonth, uint16_t lastMonth, uint32_t offset);
+bool logReaderNext(LogReader &r, CSVRow &row);
+bool logCursorValid(uint16_t month, uint32_t offset);
+bool openDataFile(uint16_t month);
+void migrateLegacyLog();
+uint8_t dayRecordChecksum(const DayIndexRecord &rec);
+void clearDayRecord(DayIndexRecord &rec, uint16_t day);
+void toFixedValues(const SensorData &reading, int16_t values[CHANNEL_COUNT]);
+void addToDayRecord(DayIndexRecord &rec, const int16_t values[CHANNEL_COUNT], uint8_t weight);
+void mergeDayRecord(DayIndexRecord &rec, const DayIndexRecord &other);
+bool readIndexHeader(File &idx, DayIndexHeader &hdr);
+bool writeIndexHeader(File &idx, const DayIndexHeader &hdr);
+bool readDayRecord(File &idx, const DayIndexHeader &hdr, uint16_t day, DayIndexRecord &rec);
+bool writeDayRecord(File &idx, DayIndexHeader &hdr, const DayIndexRecord &rec);
+bool indexLogFrom(File &idx, DayIndexHeader &hdr);
+bool rebuildDayIndex();
+void checkDayIndex();
+void aggResetWindow(AggWindow &w);
+void aggWindowDays(AggWindow &w, uint16_t today, uint8_t daysBack, uint8_t dayCount);
+void aggWindowMonth(AggWindow &w, const DateTime &now);
+void hourProfileInit(HourProfile &p, uint16_t today, uint8_t dayCount);
+void hourProfileAdd(HourProfile *profile, uint16_t day, uint8_t hour, const int16_t values[CHANNEL_COUNT],
+                    uint8_t weight);
+void aggAddDay(AggWindow *windows, uint8_t windowCount, const DayIndexRecord &rec);
+void loadAggPending(AggPending &pending, HourProfile *profile);
+void aggAddPending(AggWindow *windows, uint8_t windowCount);
+bool aggregateFromIndex(AggWindow *windows, uint8_t windowCount);
+void aggregateFromCSV(AggWindow *windows, uint8_t windowCount, HourProfile *profile);
+void runAggregation(AggWindow *windows, uint8_t windowCount, HourProfile *profile);
+SensorData aggWindowMean(const AggWindow &w);
+SensorData aggWindowDailyMean(const AggWindow &w);
+SensorData hourProfileMean(const HourProfile &p, uint8_t hour);
+void ringPush(uint16_t day, uint8_t hour, const int16_t values[CHANNEL_COUNT]);
+const HourSample &ringAt(uint8_t i);
+void ringPushRows(CSVReader &in);
+void loadRingFromCSV();
+bool aggregateFromRing(AggWindow *windows, uint8_t windowCount, HourProfile *profile);
+void statsReset(ChannelStats &s);
+void statsAdd(ChannelStats &s, float value, uint32_t time);
+float statsStdDev(const ChannelStats &s);
+void updateStats(const SensorData &reading);
+float dewPoint(float temp, float hum);
+float heatIndex(float temp, float hum);
+float pressureTendency(uint32_t now);
+void graphResetBucket(GraphBucket &b, uint32_t number);
+bool readGraphHeader(File &f, GraphHeader &hdr);
+bool writeGraphHeader(File &f, const GraphHeader &hdr);
+void seekGraphBucket(File &f, uint8_t range, uint32_t number);
+bool readGraphBucket(File &f, uint8_t range, uint32_t number, GraphBucket &b);
+bool writeGraphBucket(File &f, uint8_t range, const GraphBucket &b);
+uint8_t graphPush(File &f, uint32_t time, const int16_t values[CHANNEL_COUNT]);
+void graphBucketAdd(GraphBucket &b, const int16_t values[CHANNEL_COUNT]);
+void queueBucket(uint8_t range, uint32_t number, GraphBucket &b);
+void graphSyncHeader(GraphHeader &hdr);
+void graphAddSample(uint32_t time, const int16_t values[CHANNEL_COUNT]);
+bool graphReplay(File &f, uint32_t from);
+bool rebuildGraph();
+void checkGraph();
+bool readBinLogHeader(File &bin, BinLogHeader &hdr);
+bool writeBinLogHeader(File &bin, const BinLogHeader &hdr);
+uint8_t encodeVarint(uint32_t value, uint8_t *out);
+uint32_t zigZag(int32_t value);
+int32_t unZigZag(uint32_t value);
+uint32_t binLogBlockCount(File &bin);
+uint32_t binLogBlockOffset(uint32_t block);
+uint16_t binLogRegionOffset(uint8_t column);
+bool binLogPad(File &bin, uint32_t end);
+bool binLogLoadBlock(File &bin, BinLogCursor &c, uint32_t block);
+bool binLogReadVarint(File &bin, BinLogCursor &c, uint8_t column, uint32_t &value);
+bool binLogBlockChecked(const BinLogCursor &c);
+bool binLogNext(File &bin, BinLogCursor &c);
+bool binLogSeek(File &bin, BinLogCursor &c, uint32_t slot, uint8_t channel);
+bool binLogLoadTail(File &bin, const BinLogHeader &hdr);
+bool appendBinLogRecord(File &bin, BinLogHeader &hdr, uint32_t time, const int16_t values[CHANNEL_COUNT]);
+uint32_t binLogFindDay(File &bin, const BinLogHeader &hdr, uint16_t day);
+bool binLogFrom(File &bin, BinLogHeader &hdr);
+bool rebuildBinaryLog();
+void checkBinaryLog();
+bool aggregateFromBinaryLog(AggWindow *windows, uint8_t windowCount, HourProfile *profile);
+bool exportBinaryLogToCSV();
+uint16_t journalChecksum(const LogJournalHeader &hdr, const uint8_t *data);
+void appendLogLine(const uint8_t *line, uint8_t length, uint32_t time);
+bool flushLogBuffer();
+bool nextLogBufferRow(uint16_t &pos, uint16_t length, CSVRow &row);
+void logBufferFailed(uint16_t length);
+void recoverLogJournal();
+void attachCard();
+void probeCard(uint32_t now);
+uint32_t lastCSVTime();
+uint16_t queueSlotAddress(uint16_t slot);
+uint16_t queueSlotCrc(const QueueSlot &s);
+bool queueReadSlot(uint16_t slot, QueueSlot &s);
+uint16_t queuePending(uint16_t i);
+void queuePush(uint32_t time, const int16_t values[CHANNEL_COUNT]);
+void queueLoad();
+void queueMergeHistory();
+void queueDrain();
+void printQueue();
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, uint16_t length);
+void sendExportFrame(char type, uint32_t index, const uint8_t *data, uint8_t count);
+void listPartitions();
+void startExport(const char *args);
+void stopExport();
+void exportTask();
+uint8_t findChannel(const char *name);
+void printChannelDay(uint16_t day, uint16_t count, int32_t sum, int16_t minValue, int16_t maxValue, int16_t scale);
+void printChannelDays(char *args);
+void handleSerialInput();
+
+// --- Funkcje pomocnicze wyświetlacza (pola ekranu) ---
+
+// Funkcja zwracająca pozycję Y pola ekranu
+int16_t fieldY(uint8_t field) {
+  return field == FIELD_TITLE ? 10 : 30 + (field - FIELD_LINE) * 8;
+}
+
+// Funkcja zamalowująca tłem poziomy odcinek linii tekstu (wysokość czcionki: 8 pikseli)
+void fillFieldBackground(int16_t x, int16_t y, int16_t width) {
+  if (width <= 0) return;
+  tft.fillRect(x, y, width, 8, BACKGROUND);
+  framePixels += width * 8;
+}
+
+// Funkcja ustawiająca tekst pola ekranu; rysuje tylko wtedy, gdy tekst lub kolor się zmienił
+// field: numer pola (FIELD_TITLE lub FIELD_LINE + numer linii)
+// text: tekst pola ("" - pole puste)
+// x: pozycja x tekstu lub FIELD_CENTERED dla tekstu wyśrodkowanego
 // color: kolor tekstu
-void drawTextCentered(const char* text, int16_t y, uint16_t color) {
-  int16_t x1, y1; // Zmienne pomocnicze dla funkcji getTextBounds
-  uint16_t w, h;  // Szerokość i wysokość tekstu
-  // Pobierz rozmiar tekstu bez wyświetlania go, aby obliczyć jego wymiary
-  tft.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
-  int16_t x = (tft.width() - w) / 2; // Oblicz pozycję X dla wyśrodkowania tekstu
-  tft.setCursor(x, y);            // Ustaw kursor na wyliczonej pozycji
-  tft.setTextColor(color);        // Ustaw kolor tekstu
-  tft.print(text);                // Wyświetl tekst
+void drawField(uint8_t field, const char *text, int16_t x, uint16_t color) {
+  if (field >= FIELD_COUNT) return; // Linia poniżej ostatniego pola (np. przy wielu kanałach) nie mieści się na ekranie
+  ScreenField &f = screenFields[field];
+  if (strncmp(f.text, text, FIELD_TEXT_LEN - 1) == 0 && (f.color == color || f.width == 0)) return; // Bez zmian
+
+  strncpy(f.text, text, FIELD_TEXT_LEN - 1); // Zapamiętaj tekst (dłuższy i tak nie zmieściłby się na ekranie)
+  f.text[FIELD_TEXT_LEN - 1] = '\0';
+  int16_t width = strlen(f.text) * 6; // Czcionka 6x8 pikseli (rozmiar 1)
+  if (x == FIELD_CENTERED) x = (tft.width() - width) / 2;
+  if (x < 0) x = 0;
+  if (x + width > tft.width()) width = tft.width() - x; // Część poza ekranem nie jest wysyłana
+  int16_t y = fieldY(field);
+
+  // Zamaluj tłem tylko te części starego tekstu, których nie przykryje nowy
+  if (f.width > 0) {
+    fillFieldBackground(f.x, y, min(x, (int16_t)(f.x + f.width)) - f.x);            // Z lewej strony nowego tekstu
+    int16_t from = max((int16_t)(x + width), f.x);
+    fillFieldBackground(from, y, f.x + f.width - from);                               // Z prawej strony nowego tekstu
+  }
+  if (width > 0) {
+    tft.setTextSize(1);
+    tft.setTextColor(color, BACKGROUND); // Tekst z nieprzezroczystym tłem nadpisuje poprzedni
+    tft.setCursor(x, y);
+    tft.print(f.text);
+    framePixels += width * 8;
+  }
+  f.x = x;
+  f.width = width;
+  f.color = color;
+}
+
+// Funkcja ustawiająca tekst pola ekranu z pamięci programu (F("...")); poza tym jak drawField()
+void drawFieldP(uint8_t field, const __FlashStringHelper *text, int16_t x, uint16_t color) {
+  char buffer[FIELD_TEXT_LEN];
+  strncpy_P(buffer, (PGM_P)text, FIELD_TEXT_LEN - 1);
+  buffer[FIELD_TEXT_LEN - 1] = '\0';
+  drawField(field, buffer, x, color);
+}
+
+// Funkcja ustawiająca linię danych w formacie "Etykieta wartość jednostka", np. "Temp: 21.50 C"
+// label, unit: napisy w pamięci programu (F("..."))
+void drawValueField(uint8_t field, const __FlashStringHelper *label, float value, const __FlashStringHelper *unit,
+                    uint16_t color) {
+  char text[FIELD_TEXT_LEN + 8]; // Zapas na długą wartość - nadmiar zostanie obcięty w drawField()
+  char number[12];
+  dtostrf(value, 1, 2, number); // Wartość z 2 miejscami po przecinku
+  snprintf_P(text, sizeof(text), PSTR("%S%s%S"), label, number, unit);
+  drawField(field, text, FIELD_LINE_X, color);
+}
+
+// Funkcja ustawiająca linię ze skrajną wartością i godziną jej wystąpienia, np. "Min: 12.30 C o 05:14"
+// time: czas wystąpienia wartości (sekundy od 2000-01-01)
+void drawExtremeField(uint8_t field, const __FlashStringHelper *label, float value, const __FlashStringHelper *unit,
+                      uint32_t time, uint16_t color) {
+  char text[FIELD_TEXT_LEN + 8];
+  char number[12];
+  dtostrf(value, 1, 2, number);
+  snprintf_P(text, sizeof(text), PSTR("%S%s%S o %02u:%02u"), label, number, unit, (unsigned)(time % 86400UL / 3600),
+             (unsigned)(time % 3600 / 60));
+  drawField(field, text, FIELD_LINE_X, color);
+}
+
+// Funkcja ustawiająca linię z wartością kanału, np. "Temp: 21.50 C" (etykieta i jednostka z tabeli kanałów)
+void drawChannelField(uint8_t field, uint8_t ch, float value, uint16_t color) {
+  char text[FIELD_TEXT_LEN + 8];
+  char number[12];
+  dtostrf(value, 1, 2, number);
+  snprintf_P(text, sizeof(text), PSTR("%S: %s %S"), CHANNELS[ch].label, number, CHANNELS[ch].unit);
+  drawField(field, text, FIELD_LINE_X, color);
+}
+
+// Funkcja wypisująca na monitor szeregowy wartość kanału w tym samym formacie co drawChannelField()
+void printChannelValue(uint8_t ch, float value) {
+  Serial.print((const __FlashStringHelper *)CHANNELS[ch].label); Serial.print(F(": "));
+  Serial.print(value, 2); Serial.print(' ');
+  Serial.println((const __FlashStringHelper *)CHANNELS[ch].unit);
+}
+
+// Funkcja ustawiająca linie ze średnimi wszystkich kanałów (po jednej na kanał) od podanego pola
+void drawAverageFields(uint8_t field, const SensorData &avg, uint16_t color) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) drawChannelField(field + ch, ch, avg.value[ch], color);
+}
+
+// Funkcja wypisująca na monitor szeregowy średnie wszystkich kanałów
+void printAverage(const SensorData &avg) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) printChannelValue(ch, avg.value[ch]);
+}
+
+// Funkcja czyszcząca pola od podanego do ostatniego (linie nieużywane na bieżącym ekranie)
+void clearFieldsFrom(uint8_t field) {
+  for (; field < FIELD_COUNT; field++) drawField(field, "", FIELD_LINE_X, ST77XX_WHITE);
 }
 
 // --- Funkcja setup() - Wykonywana raz po uruchomieniu lub zresetowaniu Arduino ---
 void setup() {
-  Serial.begin(9600);           // Inicjalizacja komunikacji szeregowej z prędkością 9600 bodów/sekundę
+  paintStack();                 // Znacznik poziomu stosu: wolna pamięć wypełniona wzorem przed inicjalizacją bibliotek
+  Serial.begin(SERIAL_BAUD);    // Inicjalizacja komunikacji szeregowej (pobieranie dziennika wymaga dużej prędkości)
   while (!Serial);              // Czekaj, aż monitor szeregowy będzie gotowy (przydatne przy debugowaniu)
 
   // Konfiguracja pinów przycisków jako wejścia z podciągnięciem do VCC (INPUT_PULLUP)
@@ -63,37 +1052,55 @@ void setup() {
   pinMode(button1Pin, INPUT_PULLUP);
   pinMode(button2Pin, INPUT_PULLUP);
   pinMode(refreshButtonPin, INPUT_PULLUP);
+  pinMode(rtcInterruptPin, INPUT_PULLUP); // Wyjście INT zegara to otwarty dren
+  pinMode(backlightPin, OUTPUT);
+  digitalWrite(backlightPin, HIGH);       // Podświetlenie włączone do pierwszego okresu bezczynności
+  // Przyciski 1 i 2 zgłaszają naciśnięcie przerwaniem na zboczu opadającym
+  attachInterrupt(digitalPinToInterrupt(button1Pin), button1ISR, FALLING);
+  attachInterrupt(digitalPinToInterrupt(button2Pin), button2ISR, FALLING);
 
-  // Inicjalizacja czujnika BME280
-  if (!bme.begin(0x76)) { // Próba inicjalizacji czujnika pod adresem I2C 0x76 (najczęstszy adres)
-    Serial.println("Nie znaleziono BME280!"); // Komunikat o błędzie na monitorze szeregowym
-    while (1); // Zatrzymaj program w nieskończonej pętli, jeśli czujnik nie zostanie znaleziony
+  // Inicjalizacja czujników BME280 (adresy I2C z listy BME280_ADDRESSES, zwykle 0x76 i 0x77)
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    if (!bme[i].begin(BME280_ADDRESSES[i]) || !bmeReadCalibration(i)) {
+      Serial.print(F("Nie znaleziono BME280 pod adresem 0x")); // Komunikat o błędzie na monitorze szeregowym
+      Serial.println(BME280_ADDRESSES[i], HEX);
+      while (1); // Zatrzymaj program w nieskończonej pętli, jeśli czujnik nie zostanie znaleziony
+    }
+    // Tryb pracy, nadpróbkowanie i filtr IIR wg ustawień BME_*
+    bme[i].setSampling(BME_MODE, BME_OVERSAMPLING_T, BME_OVERSAMPLING_P, BME_OVERSAMPLING_H, BME_FILTER, BME_STANDBY);
   }
 
   // Inicjalizacja modułu RTC
   if (!rtc.begin()) { // Próba inicjalizacji RTC
-    Serial.println("RTC PCF8563 nie znaleziono."); // Komunikat o błędzie
+    Serial.println(F("RTC PCF8563 nie znaleziono.")); // Komunikat o błędzie
     while (1); // Zatrzymaj program, jeśli RTC nie zostanie znaleziony
   }
+  rtcStopTimer(); // Licznik czasu mógł zostać włączony przed resetem procesora
 
   // Inicjalizacja karty SD
-  if (!SD.begin(chipSelect)) { // Próba inicjalizacji karty SD przy użyciu podanego pinu chipSelect
-    Serial.println("Błąd inicjalizacji karty SD"); // Komunikat o błędzie
-    // Nie zatrzymujemy programu całkowicie, aby reszta funkcjonalności mogła działać bez SD
-  }
-
-  // Otwarcie pliku dane.csv do zapisu (jeśli nie istnieje, zostanie utworzony; jeśli istnieje, zostanie otwarty)
-  dataFile = SD.open("dane.csv", FILE_WRITE);
-  if (dataFile) { // Sprawdzenie, czy plik został pomyślnie otwarty
-    if (dataFile.size() == 0) { // Jeśli plik jest pusty (nowy), dodaj nagłówek
-      dataFile.println(F("Date, Time, Temperature, Humidity, Pressure")); // Nagłówek kolumn
-    }
-    // Plik pozostaje otwarty do dalszych operacji zapisu.
-    // Zapewnia to, że strumień zapisu jest gotowy, a plik nie jest za każdym razem otwierany i zamykany,
-    // co mogłoby spowolnić działanie i zwiększyć zużycie pamięci.
+  sdReady = SD.begin(chipSelect); // Próba inicjalizacji karty SD przy użyciu podanego pinu chipSelect
+  if (!sdReady) {
+    Serial.println(F("Błąd inicjalizacji karty SD")); // Komunikat o błędzie
+    // Nie zatrzymujemy programu całkowicie, aby reszta funkcjonalności mogła działać bez SD - pomiary trafią
+    // do kolejki EEPROM, a karta będzie uruchamiana ponownie co SD_PROBE_S sekund
+    sdProbeTime = clockSeconds();
   } else {
-    Serial.println("Nie można otworzyć pliku dane.csv"); // Komunikat o błędzie, jeśli plik nie może być otwarty
+    attachCard(); // Dokończenie przerwanej paczki, podział dawnego pliku, plik bieżącego miesiąca
   }
+  queueLoad(); // Pomiary z kolejki EEPROM, których nie ma jeszcze na karcie
+
+  // Sprawdzenie indeksu dziennych agregatów - jeśli go brakuje lub jest uszkodzony, zostanie odbudowany z plików CSV
+  checkDayIndex();
+#if BINARY_LOG
+  // Sprawdzenie dziennika binarnego - brakujący zostanie utworzony przez konwersję plików CSV
+  checkBinaryLog();
+#endif
+  // Wypełnienie bufora ostatnich pomiarów z końcówki najnowszego pliku CSV (bez czytania całej historii)
+  loadRingFromCSV();
+  // Przedziały wykresu historii - pomiary spoza zamkniętych przedziałów są odtwarzane z dziennika
+  checkGraph();
+  // Pomiary czekające w kolejce EEPROM w buforze ostatnich pomiarów i na wykresie (ekrany nie czekają na kartę)
+  queueMergeHistory();
 
   // Inicjalizacja wyświetlacza TFT ST7735
   tft.initR(INITR_BLACKTAB); // Inicjalizacja wyświetlacza z domyślnymi ustawieniami (BLACKTAB jest jednym z typów)
@@ -104,473 +1111,3334 @@ void setup() {
   // tft.setTextSize(2); // Usunięte stąd, aby rozmiar był ustawiany w funkcjach displayXXX dla większej kontroli
   // Rozmiar tekstu jest ustawiany w każdej funkcji wyświetlającej konkretny ekran, aby zapewnić elastyczność.
 
-  Serial.println("Inicjalizacja zakończona.\n"); // Komunikat o zakończeniu inicjalizacji na monitorze szeregowym
+  Serial.print(F("Wolna pamięć RAM: ")); Serial.print(freeMemory()); // Zapas na stos po inicjalizacji bibliotek
+  Serial.print(F(" B, najmniej w trakcie startu: ")); Serial.print(stackHeadroom()); Serial.println(F(" B"));
+  Serial.println(F("Inicjalizacja zakończona.\n")); // Komunikat o zakończeniu inicjalizacji na monitorze szeregowym
+
+  // Pierwszy termin zapisu: następny pełny termin, jak w logTask() (wiersz z czasem spoza terminu dublowałby
+  // pomiar z bieżącej minuty, zapisany przed resetem albo w następnym terminie)
+  uint32_t now = clockSeconds();
+  nextLogTime = (now / LOG_INTERVAL_S + 1) * LOG_INTERVAL_S;
+
+  sampleSensor(now); // Pierwszy odczyt czujnika dla ekranu bieżących danych
 
   // Wyświetl początkowe dane po uruchomieniu
-  drawScreenButtons(screenIndex); // Narysuj przyciski nawigacyjne na dole ekranu
-  displayBME280(); // Wywołaj funkcję wyświetlającą bieżące dane z BME280 na ekranie
+  updateDisplayForScreenIndex(screenIndex); // Narysuj przyciski nawigacyjne i bieżące dane z BME280
+  lastActivity = uptimeMillis(); // Podświetlenie zgaśnie po BACKLIGHT_TIMEOUT_S od końca uruchamiania
 }
 
 // --- Funkcja loop() - Główna pętla programu, wykonywana wielokrotnie ---
 void loop() {
-  DateTime now = rtc.now(); // Pobierz aktualny czas i datę z modułu RTC
+  unsigned long start = micros();
+  runTasks(); // Uruchom zadania, których termin minął (przyciski, pomiar, zapis, rysowanie, port szeregowy)
+  unsigned long elapsed = micros() - start;
+  if (elapsed > loopMaxMicros) loopMaxMicros = elapsed; // Najdłuższy przebieg pętli
+  probeRecord(PROBE_LOOP, elapsed);
+}
 
-  // Obsługa przycisków zmiany ekranu
-  // Przycisk 1 (button1Pin) - zmiana ekranu w lewo/wstecz
-  if (digitalRead(button1Pin) == LOW) { // Sprawdź, czy przycisk został wciśnięty (pin LOW ze względu na pull-up)
-    screenIndex--;                      // Zmniejsz indeks ekranu
-    if (screenIndex < 0) screenIndex = screenCount - 1; // Jeśli indeks spadnie poniżej 0, przejdź na ostatni ekran
-    clearScreen();                      // Wyczyść cały ekran
-    drawScreenButtons(screenIndex);     // Narysuj przyciski na dole ekranu, podświetlając aktywny
-    // Odśwież zawartość ekranu po zmianie
-    if (screenIndex == 0) {
-      displayBME280(); // Jeśli to ekran bieżących danych, wyświetl je
-    } else {
-      updateDisplayForScreenIndex(screenIndex); // W przeciwnym razie zaktualizuj inne ekrany (średnie)
+// --- Zadania planisty ---
+
+// Procedury obsługi przerwań przycisków: tylko zapamiętanie zbocza, potwierdzenie w zadaniu wejścia
+void button1ISR() {
+  buttonEdge(buttons[0]);
+}
+
+void button2ISR() {
+  buttonEdge(buttons[1]);
+}
+
+// Funkcja zapamiętująca zbocze opadające przycisku (wywoływana z przerwania lub przy odpytywaniu)
+void buttonEdge(Button &b) {
+  if (b.edge) return; // Zbocze już czeka na potwierdzenie - kolejne to drgania styków
+  b.edgeTime = millis();
+  b.edge = true;
+}
+
+// Funkcja dodająca zdarzenie do kolejki (przy pełnej kolejce zdarzenie jest pomijane)
+void pushEvent(uint8_t event) {
+  if (eventCount >= EVENT_QUEUE_SIZE) return;
+  eventQueue[(eventHead + eventCount) % EVENT_QUEUE_SIZE] = event;
+  eventCount++;
+}
+
+// Funkcja pobierająca najstarsze zdarzenie z kolejki; zwraca false, gdy kolejka jest pusta
+bool popEvent(uint8_t &event) {
+  if (eventCount == 0) return false;
+  event = eventQueue[eventHead];
+  eventHead = (eventHead + 1) % EVENT_QUEUE_SIZE;
+  eventCount--;
+  return true;
+}
+
+// Zadanie wejścia: potwierdzenie naciśnięć po czasie drgań styków i obsługa zdarzeń z kolejki
+// Naciśnięcie jest zgłaszane, jeśli BUTTON_DEBOUNCE_MS po zboczu przycisk nadal jest wciśnięty;
+// kolejne naciśnięcie jest możliwe dopiero po stabilnym puszczeniu przycisku.
+void inputTask() {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    Button &b = buttons[i];
+    bool low = digitalRead(b.pin) == LOW;
+    if (b.pressed) { // Czekaj na stabilne puszczenie przycisku
+      if (low) {
+        b.lowTime = now;
+        if (b.longEvent != EVENT_NONE && !b.held && now - b.edgeTime >= BUTTON_LONG_MS) { // Przycisk przytrzymany
+          b.held = true;
+          pushEvent(b.longEvent);
+        }
+      } else if (now - b.lowTime >= BUTTON_DEBOUNCE_MS) {
+        b.pressed = false;
+        b.held = false;
+        b.edge = false; // Zbocza z drgań przy puszczaniu nie są naciśnięciem
+      }
+      continue;
+    }
+    if (b.polled && low) buttonEdge(b);
+    if (b.edge && now - b.edgeTime >= BUTTON_DEBOUNCE_MS) {
+      if (low) { // Przycisk nadal wciśnięty - naciśnięcie potwierdzone
+        b.pressed = true;
+        b.lowTime = now;
+        pushEvent(b.event);
+      } else {
+        b.edge = false; // Krótkie zakłócenie - przycisk nie jest wciśnięty
+      }
     }
-    Serial.print("Przycisk 1 - Ekran: "); // Wyświetl na monitorze szeregowym informację o zmianie ekranu
-    Serial.println(screenIndex);
-    delay(300); // Opóźnienie (debouncing) aby zapobiec wielokrotnym wykryciom jednego wciśnięcia przycisku
   }
 
-  // Przycisk 2 (button2Pin) - zmiana ekranu w prawo/dalej
-  if (digitalRead(button2Pin) == LOW) { // Sprawdź, czy przycisk został wciśnięty
+  uint8_t event;
+  while (popEvent(event)) handleButtonEvent(event);
+}
+
+// Funkcja obsługująca zdarzenie przycisku
+void handleButtonEvent(uint8_t event) {
+  lastActivity = uptimeMillis();
+  if (!backlightOn) { // Pierwsze naciśnięcie przy zgaszonym ekranie tylko go włącza
+    setBacklight(true);
+    Serial.println(F("Włączono podświetlenie"));
+    return;
+  }
+  if (event == EVENT_PREV) { // Przycisk 1 - zmiana ekranu w lewo/wstecz
+    screenIndex--;                      // Zmniejsz indeks ekranu
+    if (screenIndex < 0) screenIndex = screenCount - 1; // Jeśli indeks spadnie poniżej 0, przejdź na ostatni ekran
+    updateDisplayForScreenIndex(screenIndex); // Przerysuj pasek przycisków i zmienione pola ekranu
+    Serial.print(F("Przycisk 1 - Ekran: ")); // Wyświetl na monitorze szeregowym informację o zmianie ekranu
+    Serial.println(screenIndex);
+  } else if (event == EVENT_NEXT) { // Przycisk 2 - zmiana ekranu w prawo/dalej
     screenIndex++;                      // Zwiększ indeks ekranu
     if (screenIndex >= screenCount) screenIndex = 0; // Jeśli indeks przekroczy max, wróć na pierwszy ekran (0)
-    clearScreen();                      // Wyczyść ekran
-    drawScreenButtons(screenIndex);     // Narysuj przyciski
-    // Odśwież zawartość ekranu po zmianie
-    if (screenIndex == 0) {
-      displayBME280(); // Jeśli to ekran bieżących danych, wyświetl je
-    } else {
-      updateDisplayForScreenIndex(screenIndex); // W przeciwnym razie zaktualizuj inne ekrany
-    }
-    Serial.print("Przycisk 2 - Ekran: "); // Wyświetl na monitorze szeregowym informację o zmianie ekranu
+    updateDisplayForScreenIndex(screenIndex); // Przerysuj pasek przycisków i zmienione pola ekranu
+    Serial.print(F("Przycisk 2 - Ekran: ")); // Wyświetl na monitorze szeregowym informację o zmianie ekranu
     Serial.println(screenIndex);
-    delay(300); // Opóźnienie (debouncing)
-  }
-  
-  // Zapis danych co godzinę o pełnej godzinie
-  // Warunek sprawdza, czy aktualna godzina różni się od ostatnio zapisanej ORAZ czy minuty wynoszą 0.
-  if (now.hour() != lastLoggedHour && now.minute() == 0) {
-    lastLoggedHour = now.hour(); // Zaktualizuj ostatnio zapisaną godzinę, aby zapobiec ponownemu zapisowi w tej samej godzinie
-
-    SensorData currentReading; // Utwórz zmienną strukturalną do przechowywania bieżących odczytów
-    currentReading.temperature = bme.readTemperature(); // Odczyt temperatury
-    currentReading.humidity = bme.readHumidity();       // Odczyt wilgotności
-    currentReading.pressure = bme.readPressure() / 100.0F; // Odczyt ciśnienia i konwersja na hPa
-    currentReading.isValid = true; // Oznacz dane jako poprawne
-
-    saveDatatoSD(currentReading); // Zapisz zebrane dane na kartę SD
-  }
-
-  // Obsługa przycisku odświeżania danych
-  bool currentRefreshButtonState = digitalRead(refreshButtonPin); // Odczytaj aktualny stan przycisku
-
-  // Wykrycie zbocza opadającego (czyli kliknięcia, bo INPUT_PULLUP oznacza HIGH -> LOW przy wciśnięciu)
-  if (lastRefreshButtonState == HIGH && currentRefreshButtonState == LOW) {
-    Serial.println("\n--- Odświeżanie danych ---"); // Komunikat na monitorze szeregowym
-    // Odświeżanie danych tylko dla ekranu bieżących danych (screenIndex == 0)
-    if (screenIndex == 0) {
-      displayBME280(); // Wywołaj pełne wyświetlanie, aby uniknąć migotania i odświeżyć dane z czujnika
-      Serial.println("Ekran: Bieżące dane");
-      // Dane bieżące są już drukowane w displayBME280() na monitorze szeregowym
-    } else {
-      updateDisplayForScreenIndex(screenIndex); // Odśwież inne ekrany (średnie) po kliknięciu przycisku odświeżania
-      Serial.print("Ekran: ");
-      switch (screenIndex) { // Wyświetl nazwę aktualnego ekranu na monitorze szeregowym
-        case 1: Serial.println("Dzisiaj"); break;
-        case 2: Serial.println("Wczoraj"); break;
-        case 3: Serial.println("Tydzień"); break;
-      }
+  } else if (event == EVENT_REFRESH) { // Przycisk odświeżania danych
+    Serial.println(F("\n--- Odświeżanie danych ---")); // Komunikat na monitorze szeregowym
+    uint8_t kind = screenKind(screenIndex);
+    if (kind == SCREEN_CURRENT) sampleSensor(clockSeconds()); // Świeży odczyt czujnika dla ekranu bieżących danych
+    if (kind == SCREEN_GRAPH) { // Na ekranie wykresu - następny zakres lub następna wielkość
+      graphView = (graphView + 1) % (CHANNEL_COUNT * GRAPH_RANGES);
+      graphColumn = GRAPH_COLUMNS; // Nowy wykres także wtedy, gdy poprzedni nie był jeszcze narysowany w całości
     }
-    Serial.println("------------------------"); // Separator na monitorze szeregowym
-    delay(300);     // Opóźnienie (debouncing)
+    updateDisplayForScreenIndex(screenIndex); // Odśwież aktualny ekran - przerysowane zostaną tylko zmienione pola
+    Serial.print(F("Ekran: ")); // Nazwa aktualnego ekranu na monitorze szeregowym
+    Serial.println((const __FlashStringHelper *)SCREENS[screenIndex].name);
+    Serial.println(F("------------------------")); // Separator na monitorze szeregowym
+  } else if (event == EVENT_DIAG) { // Przytrzymany przycisk odświeżania - wejście na ekran diagnostyczny lub powrót
+    screenIndex = screenIndex == diagScreenIndex ? 0 : diagScreenIndex;
+    updateDisplayForScreenIndex(screenIndex);
+    Serial.print(F("Przytrzymanie przycisku odświeżania - Ekran: "));
+    Serial.println(screenIndex);
   }
-  lastRefreshButtonState = currentRefreshButtonState; // Zapisz aktualny stan przycisku do porównania w następnej iteracji
 }
 
-// --- Funkcje pomocnicze ---
-
-// Funkcja do zapisu danych z czujnika na kartę SD
-// currentReading: struktura SensorData zawierająca dane do zapisu
-void saveDatatoSD(SensorData &currentReading) {
-  // Sprawdź, czy plik jest aktualnie otwarty. Jeśli nie, spróbuj go otworzyć ponownie.
-  // Jest to zabezpieczenie na wypadek, gdyby plik został przypadkowo zamknięty lub otwarcie w setup() się nie powiodło.
-  if (!dataFile) {
-    dataFile = SD.open("dane.csv", FILE_WRITE); // Spróbuj ponownie otworzyć plik w trybie zapisu
-    if (!dataFile) { // Jeśli ponowne otwarcie również się nie powiedzie
-      Serial.println("Błąd otwarcia pliku dane.csv do zapisu"); // Zgłoś błąd
-      return; // Zakończ funkcję, nie można zapisać danych
-    }
-  }
-
-  DateTime now = rtc.now(); // Pobierz aktualny czas i datę z RTC
-
-  // Formatowanie i zapis danych do pliku CSV
-  // Przykład formatu: RRRR-MM-DD, HH:MM:SS, Temperatura, Wilgotność, Ciśnienie
-  dataFile.print(now.year(), DEC); // Rok
-  dataFile.print(F("-"));
-  if (now.month() < 10) dataFile.print('0'); // Dodaj wiodące zero dla miesiąców < 10
-  dataFile.print(now.month(), DEC);          // Miesiąc
-  dataFile.print(F("-"));
-  if (now.day() < 10) dataFile.print('0');   // Dodaj wiodące zero dla dni < 10
-  dataFile.print(now.day(), DEC);            // Dzień
-  dataFile.print(F(", "));                   // Separator
-  if (now.hour() < 10) dataFile.print('0');  // Dodaj wiodące zero dla godzin < 10
-  dataFile.print(now.hour(), DEC);           // Godzina
-  dataFile.print(F(":"));
-  if (now.minute() < 10) dataFile.print('0'); // Dodaj wiodące zero dla minut < 10
-  dataFile.print(now.minute(), DEC);         // Minuty
-  dataFile.print(F(":"));
-  if (now.second() < 10) dataFile.print('0'); // Dodaj wiodące zero dla sekund < 10
-  dataFile.print(now.second(), DEC);         // Sekundy
-  dataFile.print(F(", "));                   // Separator
-  dataFile.print(currentReading.temperature, 2); // Temperatura z 2 miejscami po przecinku
-  dataFile.print(F(", "));                   // Separator
-  dataFile.print(currentReading.humidity, 2);    // Wilgotność z 2 miejscami po przecinku
-  dataFile.print(F(", "));                   // Separator
-  dataFile.println(currentReading.pressure, 2);  // Ciśnienie z 2 miejscami po przecinku i znak nowej linii
-
-  dataFile.flush(); // Wymuś zapis danych z bufora na kartę SD (ważne, aby dane nie zostały utracone przy odłączeniu zasilania)
-
-  Serial.println("Zapisano dane na SD."); // Komunikat potwierdzający zapis
+// Funkcja odczytująca bieżące wartości z czujnika BME280 do lastReading
+// time: czas pomiaru (sekundy od 2000-01-01) - ten sam trafia do zapisu, statystyk i bufora ostatnich pomiarów
+void sampleSensor(uint32_t time) {
+  lastReading = readSensor(time);
+  updateStats(lastReading); // Statystyki dnia (minimum, maksimum, odchylenie standardowe)
 }
 
-// Funkcja do rysowania przycisków nawigacyjnych na dole ekranu
-// activeIndex: indeks aktualnie aktywnego ekranu, który zostanie podświetlony
-void drawScreenButtons(int activeIndex) {
-  int buttonWidth = tft.width() / screenCount; // Oblicz szerokość każdego przycisku, dzieląc szerokość ekranu przez liczbę ekranów
-  int buttonHeight = 20;                     // Wysokość przycisku w pikselach
-  int y = tft.height() - buttonHeight;       // Pozycja Y (pionowa) dla przycisków (na dole ekranu)
-
-  for (int i = 0; i < screenCount; i++) { // Pętla dla każdego przycisku
-    uint16_t color = (i == activeIndex) ? ST77XX_YELLOW : DARKGREY; // Jeśli to aktywny przycisk, ustaw żółty kolor, w przeciwnym razie ciemnoszary
-    tft.fillRect(i * buttonWidth, y, buttonWidth, buttonHeight, color); // Narysuj prostokąt przycisku
-    tft.setCursor(i * buttonWidth + 2, y + 6); // Ustaw kursor dla tekstu wewnątrz przycisku (małe wcięcie)
-    tft.setTextColor(ST77XX_BLACK);           // Ustaw kolor tekstu na czarny
-    tft.setTextSize(1);                       // Ustaw rozmiar tekstu na 1 (mała czcionka, stała dla przycisków)
+// Zadanie pomiaru: okresowy odczyt czujnika; ekran bieżących danych (i diagnostyczny) zostanie odświeżony
+// Przy zgaszonym ekranie zadanie nic nie robi - nikt nie patrzy na ekran.
+void sensorTask() {
+  if (!backlightOn) return; // Przy zgaszonym ekranie czujnik jest odczytywany tylko do zapisu (zadanie zapisu)
+  sampleSensor(clockSeconds());
+  uint8_t kind = screenKind(screenIndex);
+  if (kind == SCREEN_CURRENT || kind == SCREEN_DIAG) displayDirty = true; // Diagnostyka także co SENSOR_TASK_MS
+}
 
-    switch (i) { // Wyświetl skrót nazwy ekranu na przycisku
-      case 0: tft.print("Bie"); break;  // Bieżące
-      case 1: tft.print("Dzis"); break; // Dzisiaj
-      case 2: tft.print("Wcz"); break;  // Wczoraj
-      case 3: tft.print("Tyg"); break;  // Tydzień
-    }
+// Zadanie zapisu: zapis pomiaru co LOG_INTERVAL_S sekund, gdy zegar osiągnie termin nextLogTime
+// Zapis nie zależy od tego, czy pętla trafi dokładnie w termin - spóźniony termin jest realizowany od razu.
+void logTask() {
+  uint32_t now = clockSeconds();
+  if (nextLogTime > now + LOG_INTERVAL_S) { // Zegar cofnięto - wyznacz termin od nowa
+    nextLogTime = (now / LOG_INTERVAL_S + 1) * LOG_INTERVAL_S;
   }
-}
+  if (logBufferLength > 0 && (now >= logBufferTime + LOG_FLUSH_S || now < logBufferTime)) {
+    flushLogBuffer(); // Wiersze czekają w paczce zbyt długo (lub cofnięto zegar) - zapisz paczkę przed czasem
+  }
+  if (!sdReady) probeCard(now);        // Co SD_PROBE_S sekund próba ponownego uruchomienia karty
+  else if (queueCount > 0) queueDrain(); // Karta wróciła - kolejna porcja kolejki EEPROM na kartę
+  if (now < nextLogTime) return;
+  nextLogTime = (now / LOG_INTERVAL_S + 1) * LOG_INTERVAL_S; // Następny termin pomiaru
 
-// Funkcja do czyszczenia całego ekranu wyświetlacza
-void clearScreen() {
-  tft.fillScreen(ST77XX_BLACK); // Wypełnij cały ekran kolorem czarnym
-  tft.setCursor(0, 0);          // Ustaw kursor w lewym górnym rogu
-  tft.setTextColor(ST77XX_WHITE); // Ustaw domyślny kolor tekstu na biały
-  tft.setTextSize(1);           // Ustaw domyślny rozmiar tekstu na 1 (będzie nadpisany w funkcjach wyświetlających dane)
+  sampleSensor(now);          // Świeży odczyt czujnika z czasem, w którym minął termin
+  saveDatatoSD(lastReading);  // Zapisz zebrane dane na kartę SD (z czasem odczytu)
+  if (screenKind(screenIndex) == SCREEN_CURRENT) displayDirty = true;
 }
 
-// Funkcja do wyświetlania bieżących danych z czujnika BME280
-void displayBME280() {
-  clearScreen();              // Wyczyść ekran
-  drawScreenButtons(screenIndex); // Narysuj przyciski nawigacyjne na dole
+// Zadanie rysowania: odświeżenie ekranu, jeśli inne zadanie zgłosiło zmianę danych
+void renderTask() {
+  if (!displayDirty || !backlightOn) return; // Zgaszony ekran zostanie odświeżony po włączeniu
+  displayDirty = false;
+  updateDisplayForScreenIndex(screenIndex);
+}
 
-  // Nagłówek ekranu (mniejsza czcionka, centrowany)
-  tft.setTextSize(1);               // Ustaw rozmiar tekstu dla nagłówka
-  tft.setTextColor(ST77XX_WHITE, ST77XX_BLACK); // Ustaw kolor tekstu (biały) i tła (czarny) dla nagłówka
-  drawTextCentered("Biezace dane:", 10, ST77XX_WHITE); // Wyśrodkuj i wyświetl nagłówek
+// Tabela zadań planisty (kolejność = kolejność uruchamiania w jednym przebiegu pętli)
+Task tasks[] = {
+  {inputTask, 0, 0, 0},
+  {sensorTask, SENSOR_TASK_MS, 0, 0},
+  {logTask, LOG_TASK_MS, 0, 0},
+  {renderTask, 0, 0, 0},
+  {handleSerialInput, 0, 0, 0},
+  {exportTask, 0, 0, 0},
+  {powerTask, 0, 0, 0},
+};
+const uint8_t TASK_COUNT = sizeof(tasks) / sizeof(tasks[0]); // Liczba zadań w tabeli
 
-  // Odczyt danych z czujnika BME280
-  float temp = bme.readTemperature();
-  float pressure = bme.readPressure() / 100.0F; // Konwersja Pa na hPa
-  float altitude = bme.readAltitude(SEALEVELPRESSURE_HPA); // Obliczenie wysokości na podstawie ciśnienia i ciśnienia na poziomie morza
-  float humidity = bme.readHumidity();
+// Nazwy zadań do raportu czasów (pamięć programu, kolejność jak w tabeli tasks[])
+const char taskNames[][11] PROGMEM = {"wejscie", "pomiar", "zapis", "ekran", "port", "pobieranie", "zasilanie"};
+static_assert(sizeof(taskNames) / sizeof(taskNames[0]) == TASK_COUNT, "Nazwy zadan niezgodne z tabela tasks[]");
 
-  // Wyświetlanie danych na monitorze szeregowym (do debugowania)
-  Serial.println("--- Bieżące dane z BME280 ---");
-  Serial.print("Temp: "); Serial.print(temp); Serial.println(" C");
-  Serial.print("Cisn: "); Serial.print(pressure); Serial.println(" hPa");
-  Serial.print("Wysokosc: "); Serial.print(altitude); Serial.println(" m");
-  Serial.print("Wilgotnosc: "); Serial.print(humidity); Serial.println(" %");
+// Funkcja uruchamiająca zadania, których okres minął, i mierząca czas ich wykonania
+void runTasks() {
+  for (uint8_t i = 0; i < TASK_COUNT; i++) {
+    Task &t = tasks[i];
+    unsigned long now = uptimeMillis(); // Okresy zadań obejmują czas snu procesora
+    if (t.period > 0 && now - t.lastRun < t.period) continue; // Jeszcze nie czas
+    t.lastRun = now;
+    unsigned long start = micros();
+    t.run();
+    unsigned long elapsed = micros() - start;
+    if (elapsed > t.maxMicros) t.maxMicros = elapsed;
+  }
+}
 
-  // Sprawdzenie, czy odczytane dane nie są niepoprawne (NaN - Not a Number)
-  if (isnan(temp) || isnan(pressure) || isnan(altitude) || isnan(humidity)) {
-    drawTextCentered("Blad czujnika!", 40, ST77XX_RED); // Wyświetl komunikat o błędzie na ekranie
-    Serial.println("Błąd: Dane z czujnika są niepoprawne (NaN)."); // Zgłoś błąd na monitorze szeregowym
-    return; // Zakończ funkcję, aby nie wyświetlać błędnych danych
+// Funkcja wypisująca najdłuższe czasy wykonania zadań i przebiegu pętli, a następnie zerująca pomiary
+void printTaskTimes() {
+  Serial.println(F("--- Czasy zadań (maks. us) ---"));
+  for (uint8_t i = 0; i < TASK_COUNT; i++) {
+    Serial.print((const __FlashStringHelper *)taskNames[i]);
+    Serial.print(F(": "));
+    Serial.println(tasks[i].maxMicros);
+    tasks[i].maxMicros = 0;
   }
+  Serial.print(F("Petla loop(): "));
+  Serial.println(loopMaxMicros);
+  loopMaxMicros = 0;
+}
 
-  // Ustawianie kursora i rozmiaru tekstu dla wyświetlanych danych
-  int indentX = 10; // Wcięcie od lewej krawędzi dla estetyki
-  int startY = 30;  // Początkowa pozycja Y dla pierwszej linii danych
+// --- Sondy czasu wykonania ---
 
-  tft.setTextSize(1); // Ustaw rozmiar tekstu na większy dla danych (można zmienić na 2 dla większego tekstu)
-  tft.setTextColor(ST77XX_WHITE); // Ustaw kolor tekstu na biały
+// Funkcja dodająca pomiar czasu do sondy
+// id: numer sondy (PROBE_*), elapsed: czas operacji w us (różnica odczytów micros())
+void probeRecord(uint8_t id, unsigned long elapsed) {
+  Probe &p = probes[id];
+  if (p.count == 0 || elapsed < p.minMicros) p.minMicros = elapsed;
+  if (elapsed > p.maxMicros) p.maxMicros = elapsed;
+  p.count++;
+  p.totalMicros += elapsed;
+  uint8_t bucket = 0; // Przedział: pierwszy, którego górna granica PROBE_FIRST_US * 4^bucket przekracza czas
+  unsigned long limit = PROBE_FIRST_US;
+  while (bucket < PROBE_BUCKETS - 1 && elapsed >= limit) {
+    bucket++;
+    limit <<= 2;
+  }
+  if (p.histogram[bucket] < 0xFFFF) p.histogram[bucket]++;
+}
 
-  // Wyświetlanie danych na wyświetlaczu TFT
-  tft.setCursor(indentX, startY);
-  tft.print("Temp: "); tft.print(temp, 2); tft.println(" C"); // Temperatura z 2 miejscami po przecinku
+// Funkcja zerująca liczniki wszystkich sond i pomiar aktywności procesora (polecenie "stats zeruj")
+void probeReset() {
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    Probe &p = probes[i];
+    p.count = 0;
+    p.minMicros = 0;
+    p.maxMicros = 0;
+    p.totalMicros = 0;
+    memset(p.histogram, 0, sizeof(p.histogram));
+  }
+  dutyBaseMillis = millis();
+  dutyBaseSlept = sleptMillis;
+  framePixelsMax = 0;
+  paintStack(); // Znacznik poziomu stosu także od nowa
+}
 
-  tft.setCursor(indentX, tft.getCursorY()); // Ustaw kursor na następnej linii
-  tft.print("Cisn: "); tft.print(pressure, 2); tft.println(" hPa"); // Ciśnienie
+// Funkcja wypisująca liczniki sond (polecenie "stats"): liczba, minimum, średnia, maksimum i histogram,
+// a także udział czasu aktywnej pracy procesora i liczbę uśpień
+void printProbeStats() {
+  Serial.println(F("--- Sondy czasu (us) ---"));
+  Serial.print(F("Przedzialy histogramu: <"));
+  unsigned long limit = PROBE_FIRST_US;
+  for (uint8_t b = 0; b < PROBE_BUCKETS - 1; b++, limit <<= 2) {
+    Serial.print(limit);
+    Serial.print(b < PROBE_BUCKETS - 2 ? F(" <") : F(" >="));
+  }
+  Serial.println(limit >> 2);
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    const Probe &p = probes[i];
+    Serial.print((const __FlashStringHelper *)probeNames[i]);
+    Serial.print(F(": n ")); Serial.print(p.count);
+    Serial.print(F(", min ")); Serial.print(p.minMicros);
+    Serial.print(F(", sr ")); Serial.print(p.count > 0 ? (uint32_t)(p.totalMicros / p.count) : 0);
+    Serial.print(F(", maks ")); Serial.print(p.maxMicros);
+    Serial.print(F(", hist"));
+    for (uint8_t b = 0; b < PROBE_BUCKETS; b++) {
+      Serial.print(' ');
+      Serial.print(p.histogram[b]);
+    }
+    Serial.println();
+  }
+  Serial.print(F("Aktywnosc procesora: ")); Serial.print(dutyCyclePercent()); Serial.print(F(" %, uspienia: "));
+  Serial.print(sleepCount); Serial.print(F(" (przez zegar: ")); Serial.print(timerWakeCount);
+  Serial.print(F("), sen lacznie: ")); Serial.print(sleptMillis / 1000); Serial.println(F(" s"));
+  // Dla porównania: pełne czyszczenie ekranu to 20480 pikseli
+  Serial.print(F("Pikseli w ramce ekranu: ostatniej ")); Serial.print(framePixels);
+  Serial.print(F(", najwiecej ")); Serial.println(framePixelsMax);
+  Serial.print(F("Pamiec RAM: wolna ")); Serial.print(freeMemory());
+  Serial.print(F(" B, najmniej od startu lub zerowania ")); Serial.print(stackHeadroom()); Serial.println(F(" B"));
+}
 
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Wysokosc: "); tft.print(altitude, 2); tft.println(" m"); // Wysokość
+// --- Pamięć RAM ---
 
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Wilg: "); tft.print(humidity, 2); tft.println(" %"); // Wilgotność (skrócono "Wilg" dla spójności)
+// Funkcja zwracająca adres końca zajętej pamięci (sterty albo zmiennych statycznych)
+char *heapEnd() {
+  return __brkval ? __brkval : &__heap_start;
 }
 
-// Funkcja do aktualizacji zawartości wyświetlacza w zależności od aktywnego indeksu ekranu
-// index: indeks ekranu do wyświetlenia
-void updateDisplayForScreenIndex(int index) {
-  clearScreen();              // Wyczyść ekran
-  drawScreenButtons(index);   // Narysuj przyciski nawigacyjne
+// Funkcja zwracająca bieżącą wolną pamięć RAM między stertą a stosem (bajty)
+// Funkcja nie może być wstawiona w miejsce wywołania: jej zmienna lokalna musi leżeć poniżej ramki wywołującego,
+// inaczej paintStack() zamalowałby zmienne i adres powrotu funkcji, która go wywołała.
+__attribute__((noinline)) uint16_t freeMemory() {
+  char top; // Zmienna lokalna leży na wierzchołku stosu
+  return &top - heapEnd();
+}
 
-  // Komentarze usunięte z oryginału, ponieważ ustawienia tekstu są specyficzne dla każdej funkcji displayXXX
-  // tft.setTextSize(1);
-  // tft.setTextColor(ST77XX_WHITE);
+// Funkcja wypełniająca wolną pamięć wzorem STACK_PAINT (przy starcie i przy zerowaniu sond poleceniem "stats zeruj")
+// Przerwanie w trakcie malowania może nadpisać część wzoru - zapas zostanie wtedy tylko zaniżony.
+void paintStack() {
+  uint16_t length = freeMemory();
+  if (length > STACK_GUARD) memset(heapEnd(), STACK_PAINT, length - STACK_GUARD);
+}
 
-  switch (index) { // Wywołaj odpowiednią funkcję wyświetlającą dla danego indeksu ekranu
-    case 0:
-      displayBME280();      // Ekran bieżących danych
-      break;
-    case 1:
-      displayTodayAvg();    // Ekran średnich danych z dzisiaj
-      break;
-    case 2:
-      displayYesterdayAvg(); // Ekran średnich danych z wczoraj
-      break;
-    case 3:
-      displayWeekAvg();     // Ekran średnich danych z ostatniego tygodnia
-      break;
-  }
+// Funkcja zwracająca najmniejszy zapas pamięci od malowania: liczbę bajtów wzoru nad stertą nienadpisanych przez stos
+uint16_t stackHeadroom() {
+  const char *p = heapEnd();
+  uint16_t length = freeMemory();
+  uint16_t n = 0;
+  while (n < length && p[n] == (char)STACK_PAINT) n++;
+  return n;
 }
 
-// Funkcja do wyświetlania średnich danych z dzisiaj
-void displayTodayAvg() {
-  clearScreen();              // Wyczyść ekran
-  drawScreenButtons(screenIndex); // Narysuj przyciski nawigacyjne
+// --- Tryb oszczędzania energii ---
 
-  // Nagłówek ekranu
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
-  drawTextCentered("Dzis - srednia", 10, ST77XX_WHITE); // Wyśrodkuj i wyświetl nagłówek
+// Procedura obsługi przerwania z wyjścia INT zegara - wybudzenie procesora po doliczeniu licznika do zera
+void rtcISR() {
+  timerWakeCount++;
+}
 
-  SensorData avg = calculateAverageFromCSV(0); // Oblicz średnie dane z dzisiaj (0 dni wstecz)
+// Funkcja zapisująca rejestr zegara PCF8563 (licznika czasu i przerwań nie obsługuje biblioteka RTClib)
+bool rtcWriteRegister(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(PCF8563_ADDRESS);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
 
-  Serial.println("--- Średnie dane z dzisiaj ---"); // Komunikat na monitorze szeregowym
-  // Ustawianie kursora i rozmiaru tekstu dla danych
-  int indentX = 10;
-  int startY = 30;
+// Funkcja uruchamiająca licznik czasu zegara: po podanej liczbie sekund wyjście INT przechodzi w stan niski
+void rtcStartTimer(uint8_t seconds) {
+  rtcWriteRegister(PCF8563_TIMER_CONTROL, PCF8563_TIMER_1HZ); // Zatrzymaj licznik przed zmianą wartości
+  rtcWriteRegister(PCF8563_TIMER, seconds);
+  rtcWriteRegister(PCF8563_CONTROL_2, PCF8563_TIE);           // Wyzeruj flagi i zezwól na przerwanie licznika
+  rtcWriteRegister(PCF8563_TIMER_CONTROL, PCF8563_TE | PCF8563_TIMER_1HZ);
+}
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
+// Funkcja zatrzymująca licznik czasu i zwalniająca wyjście INT (wyzerowanie flagi licznika)
+void rtcStopTimer() {
+  rtcWriteRegister(PCF8563_TIMER_CONTROL, PCF8563_TIMER_1HZ);
+  rtcWriteRegister(PCF8563_CONTROL_2, 0);
+}
 
-  tft.setCursor(indentX, startY);
-  if (!avg.isValid) { // Sprawdź, czy średnie dane są poprawne (czy były jakieś dane do obliczeń)
-    tft.setTextColor(ST77XX_RED); // Zmień kolor tekstu na czerwony dla komunikatu o błędzie
-    tft.println("Brak danych z dzisiaj!"); // Wyświetl komunikat o braku danych
-    Serial.println("Brak danych z dzisiaj!");
-    return; // Zakończ funkcję
-  }
-  // Wyświetlanie średnich danych na monitorze szeregowym
-  Serial.print("Temp: "); Serial.print(avg.temperature, 2); Serial.println(" C");
-  Serial.print("Cisn: "); Serial.print(avg.pressure, 2); Serial.println(" hPa");
-  Serial.print("Wilg: "); Serial.print(avg.humidity, 2); Serial.println(" %");
+// Funkcja zwracająca czas pracy w ms łącznie z czasem snu (millis() w czasie snu stoi)
+unsigned long uptimeMillis() {
+  return millis() + sleptMillis;
+}
 
-  // Wyświetlanie średnich danych na wyświetlaczu TFT
-  tft.print("Temp: "); tft.print(avg.temperature, 2); tft.println(" C");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Cisn: "); tft.print(avg.pressure, 2); tft.println(" hPa");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Wilg: "); tft.print(avg.humidity, 2); tft.println(" %");
+// Funkcja zwracająca udział czasu aktywnej pracy procesora (w %) od startu lub od polecenia "stats zeruj"
+float dutyCyclePercent() {
+  unsigned long awake = millis() - dutyBaseMillis;
+  uint32_t slept = sleptMillis - dutyBaseSlept;
+  return awake + slept > 0 ? 100.0 * awake / ((float)awake + slept) : 100.0;
 }
 
-// Funkcja do wyświetlania średnich danych z wczoraj
-void displayYesterdayAvg() {
-  clearScreen();
-  drawScreenButtons(screenIndex);
+// Funkcja włączająca lub gasząca podświetlenie; zgaszony wyświetlacz jest usypiany (zachowuje zawartość)
+void setBacklight(bool on) {
+  if (on == backlightOn) return;
+  backlightOn = on;
+  if (on) {
+    tft.enableSleep(false);
+    delay(120); // Wyjście wyświetlacza z uśpienia trwa 120 ms (nota ST7735)
+    tft.enableDisplay(true);
+    if (screenKind(screenIndex) == SCREEN_CURRENT) sampleSensor(clockSeconds()); // Ekran pokaże świeży odczyt
+    displayDirty = true;                  // Dane mogły się zmienić, gdy ekran był zgaszony
+  } else {
+    tft.enableDisplay(false);
+    tft.enableSleep(true);
+  }
+  digitalWrite(backlightPin, on ? HIGH : LOW);
+}
 
-  // Nagłówek ekranu
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
-  drawTextCentered("Wczoraj - srednia", 10, ST77XX_WHITE);
+// Funkcja usypiająca procesor (power-down) na najwyżej podaną liczbę sekund; wcześniej budzi go przycisk 1 lub 2
+// Czas snu jest doliczany do sleptMillis wg zegara RTC (z dokładnością do sekundy), a zegar programowy jest
+// po śnie synchronizowany.
+void sleepFor(uint8_t seconds) {
+  Serial.flush(); // Dokończ nadawanie - w uśpieniu port szeregowy nie działa
+  uint32_t before = clockSeconds();
+  rtcStartTimer(seconds);
+  attachInterrupt(digitalPinToInterrupt(rtcInterruptPin), rtcISR, FALLING);
+  attachInterrupt(digitalPinToInterrupt(button1Pin), button1ISR, LOW);
+  attachInterrupt(digitalPinToInterrupt(button2Pin), button2ISR, LOW);
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  noInterrupts();
+  sleep_enable();
+  interrupts(); // Instrukcja po włączeniu przerwań wykonuje się jeszcze przed ich obsługą - sen bez wyścigu
+  sleep_cpu();
+  sleep_disable();
+  attachInterrupt(digitalPinToInterrupt(button1Pin), button1ISR, FALLING);
+  attachInterrupt(digitalPinToInterrupt(button2Pin), button2ISR, FALLING);
+  detachInterrupt(digitalPinToInterrupt(rtcInterruptPin));
+  rtcStopTimer();
+  uint32_t after = readRtcSeconds();
+  uint32_t slept = after > before ? after - before : 0;
+  if (slept > seconds + 1UL) slept = seconds; // Zegar przestawiony w czasie snu - różnicę pokaże korekta synchronizacji
+  sleptMillis += slept * 1000UL;
+  sleepCount++;
+  syncClock(after); // Czas snu jest znany z dokładnością do sekundy - zegar programowy od razu z RTC
+}
 
-  SensorData avg = calculateAverageFromCSV(1); // Oblicz średnie dane z wczoraj (1 dzień wstecz)
+// Zadanie zasilania: gaszenie podświetlenia po bezczynności i (przy LOW_POWER) sen do najbliższego terminu
+void powerTask() {
+  if (uptimeMillis() - lastActivity < BACKLIGHT_TIMEOUT_S * 1000UL) return;
+  setBacklight(false);
+#if LOW_POWER
+  if (exportActive || Serial.available() > 0 || eventCount > 0) return; // Jest jeszcze coś do zrobienia
+  if (sdReady && queueCount > 0) return; // Kolejka EEPROM jest przepisywana na kartę w kolejnych przebiegach
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    if (buttons[i].edge || buttons[i].pressed) return; // Naciśnięcie czeka na potwierdzenie lub puszczenie
+  }
+  uint32_t now = clockSeconds();
+  uint32_t wake = nextLogTime; // Najbliższy termin: pomiar do zapisu albo zapis paczki czekającej w buforze
+  if (logBufferLength > 0 && logBufferTime + LOG_FLUSH_S < wake) wake = logBufferTime + LOG_FLUSH_S;
+  if (wake < now + SLEEP_MIN_S) return; // Termin za blisko - zadanie zapisu zaraz go zrealizuje
+  sleepFor(wake - now > 255 ? 255 : wake - now);
+#endif
+}
 
-  Serial.println("--- Średnie dane z wczoraj ---");
-  // Ustawianie kursora i rozmiaru tekstu dla danych
-  int indentX = 10;
-  int startY = 30;
+// --- Zegar programowy ---
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
+// Funkcja odczytująca czas z zegara RTC przez I2C (sekundy od 2000-01-01); odczyt mierzy sonda "zegar"
+uint32_t readRtcSeconds() {
+  unsigned long start = micros();
+  uint32_t seconds = rtc.now().secondstime();
+  probeRecord(PROBE_CLOCK, micros() - start);
+  return seconds;
+}
 
-  tft.setCursor(indentX, startY);
-  if (!avg.isValid) {
-    tft.setTextColor(ST77XX_RED);
-    tft.println("Brak danych z wczoraj!");
-    Serial.println("Brak danych z wczoraj!");
-    return;
+// Funkcja synchronizująca zegar programowy z odczytem RTC
+// rtcSeconds: czas RTC (sekundy od 2000-01-01) odczytany przed chwilą
+void syncClock(uint32_t rtcSeconds) {
+  unsigned long now = uptimeMillis();
+  uint32_t predicted = clockBase + (now - clockBaseMillis) / 1000;
+  clockCorrection = clockSynced ? (int32_t)(rtcSeconds - predicted) : 0;
+  if (!clockSynced || rtcSeconds != predicted) { // Przy zgodnej sekundzie podstawa (i faza sekundy) zostaje
+    clockBase = rtcSeconds;
+    clockBaseMillis = now;
   }
-  Serial.print("Temp: "); Serial.print(avg.temperature, 2); Serial.println(" C");
-  Serial.print("Cisn: "); Serial.print(avg.pressure, 2); Serial.println(" hPa");
-  Serial.print("Wilg: "); Serial.print(avg.humidity, 2); Serial.println(" %");
+  clockSyncMillis = now;
+  clockSynced = true;
+  clockSyncCount++;
+}
 
-  tft.print("Temp: "); tft.print(avg.temperature, 2); tft.println(" C");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Cisn: "); tft.print(avg.pressure, 2); tft.println(" hPa");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Wilg: "); tft.print(avg.humidity, 2); tft.println(" %");
+// Funkcja zwracająca bieżący czas stacji (sekundy od 2000-01-01) bez odczytu RTC, poza terminem synchronizacji
+uint32_t clockSeconds() {
+  if (!clockSynced || uptimeMillis() - clockSyncMillis >= CLOCK_SYNC_S * 1000UL) syncClock(readRtcSeconds());
+  return clockBase + (uptimeMillis() - clockBaseMillis) / 1000;
 }
 
-// Funkcja do wyświetlania średnich danych z ostatniego tygodnia
-void displayWeekAvg() {
-  clearScreen();
-  drawScreenButtons(screenIndex);
+// Funkcja zwracająca numer bieżącego dnia (dni od 2000-01-01)
+uint16_t clockDay() {
+  return clockSeconds() / 86400UL;
+}
 
-  // Nagłówek ekranu
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
-  drawTextCentered("Tydzien - srednia", 10, ST77XX_WHITE);
+// Funkcja synchronizująca zegar z RTC i wypisująca czas oraz korektę (polecenie "zegar")
+void printClock() {
+  syncClock(readRtcSeconds());
+  DateTime now(clockSeconds() + SECONDS_FROM_1970_TO_2000);
+  char text[40];
+  snprintf_P(text, sizeof(text), PSTR("Zegar: %04u-%02u-%02u %02u:%02u:%02u"), now.year(), now.month(), now.day(),
+             now.hour(), now.minute(), now.second());
+  Serial.println(text);
+  Serial.print(F("Korekta przy synchronizacji: ")); Serial.print(clockCorrection);
+  Serial.print(F(" s, synchronizacji: ")); Serial.println(clockSyncCount);
+}
 
-  SensorData avg = calculateWeeklyAverage(); // Oblicz średnie dane z tygodnia
+// --- Odczyt czujnika BME280 (jedna transakcja I2C na pomiar) ---
 
-  Serial.println("--- Średnie dane z tygodnia ---");
-  // Ustawianie kursora i rozmiaru tekstu dla danych
-  int indentX = 10;
-  int startY = 30;
+// Funkcja odczytująca len kolejnych rejestrów czujnika, począwszy od reg, w jednej transakcji I2C
+// sensor: numer czujnika (miejsce w BME280_ADDRESSES)
+bool bmeReadRegisters(uint8_t sensor, uint8_t reg, uint8_t *buf, uint8_t len) {
+  Wire.beginTransmission(BME280_ADDRESSES[sensor]);
+  Wire.write(reg);                                  // Adres pierwszego rejestru
+  if (Wire.endTransmission() != 0) return false;    // Czujnik nie potwierdził adresu
+  if (Wire.requestFrom(BME280_ADDRESSES[sensor], len) != len) return false;
+  for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read(); // Rejestry są odczytywane po kolei (autoinkrementacja adresu)
+  return true;
+}
 
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE);
+// Funkcja odczytująca współczynniki kalibracyjne czujnika (rejestry 0x88-0xA1 i 0xE1-0xE7)
+bool bmeReadCalibration(uint8_t sensor) {
+  uint8_t a[26], b[7];
+  if (!bmeReadRegisters(sensor, 0x88, a, sizeof(a)) || !bmeReadRegisters(sensor, 0xE1, b, sizeof(b))) return false;
+  BME280Calibration &c = bmeCalibration[sensor];
+  c.T1 = a[0] | (a[1] << 8); // Wartości 16-bitowe zapisane od młodszego bajtu
+  c.T2 = a[2] | (a[3] << 8);
+  c.T3 = a[4] | (a[5] << 8);
+  c.P1 = a[6] | (a[7] << 8);
+  c.P2 = a[8] | (a[9] << 8);
+  c.P3 = a[10] | (a[11] << 8);
+  c.P4 = a[12] | (a[13] << 8);
+  c.P5 = a[14] | (a[15] << 8);
+  c.P6 = a[16] | (a[17] << 8);
+  c.P7 = a[18] | (a[19] << 8);
+  c.P8 = a[20] | (a[21] << 8);
+  c.P9 = a[22] | (a[23] << 8);
+  c.H1 = a[25];                                   // Rejestr 0xA1
+  c.H2 = b[0] | (b[1] << 8);
+  c.H3 = b[2];
+  c.H4 = ((int8_t)b[3] * 16) | (b[4] & 0x0F);     // 12 bitów: 0xE4 (starsze) i dolna połowa 0xE5
+  c.H5 = ((int8_t)b[5] * 16) | (b[4] >> 4);       // 12 bitów: 0xE6 (starsze) i górna połowa 0xE5
+  c.H6 = (int8_t)b[6];
+  return true;
+}
 
-  tft.setCursor(indentX, startY);
-  if (!avg.isValid) {
-    tft.setTextColor(ST77XX_RED);
-    tft.println("Brak danych z ostatniego tygodnia!");
-    Serial.println("Brak danych z ostatniego tygodnia!");
-    return;
-  }
-  Serial.print("Temp: "); Serial.print(avg.temperature, 2); Serial.println(" C");
-  Serial.print("Cisn: "); Serial.print(avg.pressure, 2); Serial.println(" hPa");
-  Serial.print("Wilg: "); Serial.print(avg.humidity, 2); Serial.println(" %");
+// Funkcja wykonująca pełny pomiar jednego czujnika: jedna transakcja I2C, jedna kompensacja
+// quantities: wyniki w kolejności QTY_* (°C, %, hPa); wielkość wyłączona w czujniku zostaje NaN
+// Zwraca false przy błędzie komunikacji.
+bool bmeMeasure(uint8_t sensor, float quantities[QTY_COUNT]) {
+  for (uint8_t q = 0; q < QTY_COUNT; q++) quantities[q] = NAN;
+  unsigned long start = micros();
+  if (BME_MODE == Adafruit_BME280::MODE_FORCED) bme[sensor].takeForcedMeasurement(); // Uruchom pomiar i poczekaj na wynik
 
+  uint8_t d[8]; // Rejestry 0xF7-0xFE: ciśnienie (3 bajty), temperatura (3 bajty), wilgotność (2 bajty)
+  bool ok = bmeReadRegisters(sensor, 0xF7, d, sizeof(d));
+  probeRecord(PROBE_SENSOR, micros() - start); // Czas transakcji I2C (kompensacja liczona poniżej nie jest wliczana)
+  if (!ok) return false;
+  int32_t adcP = ((uint32_t)d[0] << 12) | ((uint32_t)d[1] << 4) | (d[2] >> 4);
+  int32_t adcT = ((uint32_t)d[3] << 12) | ((uint32_t)d[4] << 4) | (d[5] >> 4);
+  int32_t adcH = ((uint32_t)d[6] << 8) | d[7];
+  if (adcT == 0x80000) return false; // Pomiar temperatury wyłączony - brak podstawy do kompensacji
+  const BME280Calibration &c = bmeCalibration[sensor];
 
-  tft.print("Temp: "); tft.print(avg.temperature, 2); tft.println(" C");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Cisn: "); tft.print(avg.pressure, 2); tft.println(" hPa");
-  tft.setCursor(indentX, tft.getCursorY());
-  tft.print("Wilg: "); tft.print(avg.humidity, 2); tft.println(" %");
+  // Temperatura (wynik w 0,01 stopnia); tFine jest używane przy kompensacji ciśnienia i wilgotności
+  int32_t var1 = ((((adcT >> 3) - ((int32_t)c.T1 << 1))) * ((int32_t)c.T2)) >> 11;
+  int32_t var2 = (((((adcT >> 4) - ((int32_t)c.T1)) * ((adcT >> 4) - ((int32_t)c.T1))) >> 12) * ((int32_t)c.T3)) >> 14;
+  int32_t tFine = var1 + var2;
+  quantities[QTY_TEMPERATURE] = ((tFine * 5 + 128) >> 8) / 100.0F;
+
+  // Ciśnienie (wariant 64-bitowy, wynik w Pa z dokładnością 1/256 Pa, jak w bibliotece Adafruit;
+  // wariant 32-bitowy z noty myli się o kilka Pa, co byłoby widać w zapisie z dokładnością 0,01 hPa)
+  if (adcP != 0x80000) {
+    int64_t v1 = ((int64_t)tFine) - 128000;
+    int64_t v2 = v1 * v1 * (int64_t)c.P6;
+    v2 = v2 + ((v1 * (int64_t)c.P5) << 17);
+    v2 = v2 + (((int64_t)c.P4) << 35);
+    v1 = ((v1 * v1 * (int64_t)c.P3) >> 8) + ((v1 * (int64_t)c.P2) << 12);
+    v1 = (((((int64_t)1) << 47) + v1)) * ((int64_t)c.P1) >> 33;
+    if (v1 != 0) { // Zabezpieczenie przed dzieleniem przez zero (brak kalibracji)
+      int64_t p = 1048576 - adcP;
+      p = (((p << 31) - v2) * 3125) / v1;
+      v1 = (((int64_t)c.P9) * (p >> 13) * (p >> 13)) >> 25;
+      v2 = (((int64_t)c.P8) * p) >> 19;
+      p = ((p + v1 + v2) >> 8) + (((int64_t)c.P7) << 4);
+      quantities[QTY_PRESSURE] = p / 25600.0F; // Konwersja 1/256 Pa na hPa
+    }
+  }
+
+  // Wilgotność (wynik w formacie Q22.10, czyli 1/1024 %)
+  if (adcH != 0x8000) {
+    int32_t v = tFine - ((int32_t)76800);
+    v = (((((adcH << 14) - (((int32_t)c.H4) << 20) - (((int32_t)c.H5) * v)) + ((int32_t)16384)) >> 15) *
+         (((((((v * ((int32_t)c.H6)) >> 10) * (((v * ((int32_t)c.H3)) >> 11) + ((int32_t)32768))) >> 10) +
+            ((int32_t)2097152)) * ((int32_t)c.H2) + 8192) >> 14));
+    v = (v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)c.H1)) >> 4));
+    v = (v < 0 ? 0 : v);
+    v = (v > 419430400 ? 419430400 : v);
+    quantities[QTY_HUMIDITY] = (v >> 12) / 1024.0F;
+  }
+  return true;
+}
+
+// Funkcja zwracająca odczyt bez pomiarów (wartości NaN, isValid = false) z podanym czasem
+SensorData noReading(uint32_t time) {
+  SensorData reading;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) reading.value[ch] = NAN;
+  reading.isValid = false;
+  reading.altitude = NAN;
+  reading.time = time;
+  return reading;
+}
+
+// Funkcja odczytująca wszystkie czujniki i rozdzielająca wyniki na kanały wg tabeli CHANNELS
+// Wysokość jest liczona z ciśnienia pierwszego czujnika. Zwraca SensorData z czasem odczytu; jeśli któryś czujnik
+// nie odpowiada, jego kanały są NaN, a isValid = false (wiersz zapisu ma zawsze wszystkie kolumny).
+SensorData readSensor(uint32_t time) {
+  SensorData reading = noReading(time);
+  reading.isValid = true;
+  for (uint8_t sensor = 0; sensor < SENSOR_COUNT; sensor++) {
+    float quantities[QTY_COUNT];
+    if (!bmeMeasure(sensor, quantities)) reading.isValid = false;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+      if (pgm_read_byte(&CHANNELS[ch].sensor) == sensor) {
+        reading.value[ch] = quantities[pgm_read_byte(&CHANNELS[ch].quantity)];
+      }
+    }
+  }
+  // Wysokość z już odczytanego ciśnienia (wzór barometryczny jak w readAltitude() biblioteki)
+  reading.altitude = 44330.0 * (1.0 - pow(reading.value[CH_PRESSURE] / SEALEVELPRESSURE_HPA, 0.1903));
+  return reading;
+}
+
+// --- Funkcje pomocnicze ---
+
+// Funkcja do zapisu danych z czujnika na kartę SD
+// Wiersz trafia do paczki, która jest zapisywana na kartę w całości (patrz flushLogBuffer())
+// currentReading: struktura SensorData zawierająca dane do zapisu
+void saveDatatoSD(SensorData &currentReading) {
+  unsigned long start = micros();
+  DateTime now(currentReading.time + SECONDS_FROM_1970_TO_2000); // Czas wykonania pomiaru
+
+  // Dodaj pomiar do bufora w pamięci RAM (także wtedy, gdy zapis na kartę się nie powiedzie)
+  bool plausible = isReadingPlausible(currentReading);
+  int16_t values[CHANNEL_COUNT];
+  if (plausible) {
+    toFixedValues(currentReading, values);
+    ringPush(dayNumber(now), now.hour(), values);
+    graphAddSample(currentReading.time, values); // Przedziały wykresu historii
+  }
+
+  // Karta niedostępna albo kolejka EEPROM czeka jeszcze na przepisanie - pomiar trafia na koniec kolejki, więc
+  // wiersze na karcie zachowają kolejność (pomiar bez poprawnych wartości nie ma postaci stałoprzecinkowej)
+  if (!sdReady || queueCount > 0) {
+    if (plausible) queuePush(currentReading.time, values);
+    probeRecord(PROBE_SAVE, micros() - start);
+    return;
+  }
+
+  // Sformatuj wiersz i dołóż go do paczki czekającej na zapis na kartę SD
+  LineBuffer line;
+  printCSVRow(line, now, currentReading.value);
+  appendLogLine(line.text, line.length, currentReading.time);
+  probeRecord(PROBE_SAVE, micros() - start);
+}
+
+// Funkcja wypisująca jeden wiersz pomiarów w formacie pliku CSV (do pliku miesiąca, eksportu lub na port szeregowy)
+// Przykład formatu: RRRR-MM-DD, HH:MM:SS, Temperatura, Wilgotność, Ciśnienie (kanały w kolejności tabeli CHANNELS)
+void printCSVRow(Print &out, const DateTime &now, const float values[CHANNEL_COUNT]) {
+  out.print(now.year(), DEC); // Rok
+  out.print(F("-"));
+  if (now.month() < 10) out.print('0'); // Dodaj wiodące zero dla miesiąców < 10
+  out.print(now.month(), DEC);          // Miesiąc
+  out.print(F("-"));
+  if (now.day() < 10) out.print('0');   // Dodaj wiodące zero dla dni < 10
+  out.print(now.day(), DEC);            // Dzień
+  out.print(F(", "));                   // Separator
+  if (now.hour() < 10) out.print('0');  // Dodaj wiodące zero dla godzin < 10
+  out.print(now.hour(), DEC);           // Godzina
+  out.print(F(":"));
+  if (now.minute() < 10) out.print('0'); // Dodaj wiodące zero dla minut < 10
+  out.print(now.minute(), DEC);         // Minuty
+  out.print(F(":"));
+  if (now.second() < 10) out.print('0'); // Dodaj wiodące zero dla sekund < 10
+  out.print(now.second(), DEC);         // Sekundy
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    out.print(F(", "));                 // Separator
+    out.print(values[ch], 2);           // Wartość kanału z 2 miejscami po przecinku
+  }
+  out.println();                        // Znak nowej linii
+}
+
+// Funkcja wypisująca nagłówek kolumn pliku CSV: "Date, Time" i nazwy kolumn kanałów z tabeli CHANNELS
+void printCSVHeader(Print &out) {
+  out.print(F("Date, Time"));
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    out.print(F(", "));
+    out.print((const __FlashStringHelper *)CHANNELS[ch].column);
+  }
+  out.println();
+}
+
+// Funkcja do rysowania przycisków nawigacyjnych na dole ekranu
+// activeIndex: indeks aktualnie aktywnego ekranu, który zostanie podświetlony
+void drawScreenButtons(int activeIndex) {
+  int buttonWidth = tft.width() / screenCount; // Oblicz szerokość każdego przycisku, dzieląc szerokość ekranu przez liczbę ekranów
+  int buttonHeight = 20;                     // Wysokość przycisku w pikselach
+  int y = tft.height() - buttonHeight;       // Pozycja Y (pionowa) dla przycisków (na dole ekranu)
+
+  for (int i = 0; i < screenCount; i++) { // Pętla dla każdego przycisku
+    uint16_t color = (i == activeIndex) ? ST77XX_YELLOW : DARKGREY; // Jeśli to aktywny przycisk, ustaw żółty kolor, w przeciwnym razie ciemnoszary
+    tft.fillRect(i * buttonWidth, y, buttonWidth, buttonHeight, color); // Narysuj prostokąt przycisku
+    framePixels += buttonWidth * buttonHeight;
+    tft.setCursor(i * buttonWidth + 2, y + 6); // Ustaw kursor dla tekstu wewnątrz przycisku (małe wcięcie)
+    tft.setTextColor(ST77XX_BLACK);           // Ustaw kolor tekstu na czarny
+    tft.setTextSize(1);                       // Ustaw rozmiar tekstu na 1 (mała czcionka, stała dla przycisków)
+    tft.print((const __FlashStringHelper *)SCREENS[i].label); // Skrót nazwy ekranu na przycisku
+  }
+  buttonsDrawnIndex = activeIndex; // Zapamiętaj stan paska, aby nie rysować go ponownie bez zmiany ekranu
+}
+
+// Funkcja do wyświetlania bieżących danych z czujnika BME280
+void displayBME280() {
+  // Nagłówek ekranu (mniejsza czcionka, centrowany)
+  drawFieldP(FIELD_TITLE, F("Biezace dane:"), FIELD_CENTERED, ST77XX_WHITE); // Wyśrodkuj i wyświetl nagłówek
+
+  // Dane z ostatniego odczytu czujników (zadanie pomiaru, przycisk odświeżania)
+  float temp = lastReading.value[CH_TEMPERATURE];
+  float humidity = lastReading.value[CH_HUMIDITY];
+  float altitude = lastReading.altitude;   // Wysokość wyliczona z ciśnienia i ciśnienia na poziomie morza
+
+  // Wyświetlanie danych na monitorze szeregowym (do debugowania)
+  Serial.println(F("--- Bieżące dane z BME280 ---"));
+  bool valid = !isnan(altitude);
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    printChannelValue(ch, lastReading.value[ch]);
+    if (isnan(lastReading.value[ch])) valid = false;
+  }
+  Serial.print(F("Wysokosc: ")); Serial.print(altitude); Serial.println(F(" m"));
+
+  // Sprawdzenie, czy odczytane dane nie są niepoprawne (NaN - Not a Number)
+  if (!valid) {
+    drawField(FIELD_LINE, "", FIELD_LINE_X, ST77XX_WHITE);
+    drawFieldP(FIELD_LINE + 1, F("Blad czujnika!"), FIELD_CENTERED, ST77XX_RED); // Wyświetl komunikat o błędzie na ekranie
+    clearFieldsFrom(FIELD_LINE + 2);
+    Serial.println(F("Błąd: Dane z czujnika są niepoprawne (NaN).")); // Zgłoś błąd na monitorze szeregowym
+    return; // Zakończ funkcję, aby nie wyświetlać błędnych danych
+  }
+
+  // Wyświetlanie danych na wyświetlaczu TFT - każdy kanał w swojej linii (polu), pod nimi wysokość
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) drawChannelField(FIELD_LINE + ch, ch, lastReading.value[ch], ST77XX_WHITE);
+  uint8_t field = FIELD_LINE + CHANNEL_COUNT; // Pierwsza linia pod kanałami
+  drawValueField(field, F("Wysokosc: "), altitude, F(" m"), ST77XX_WHITE);
+
+  // Wielkości pochodne z bieżącego odczytu i tendencja ciśnienia z bufora godzinowego (bez sięgania do karty SD)
+  float dew = dewPoint(temp, humidity);
+  float feels = heatIndex(temp, humidity);
+  float tendency = pressureTendency(lastReading.time);
+  Serial.print(F("Punkt rosy: ")); Serial.print(dew); Serial.println(F(" C"));
+  Serial.print(F("Odczuwalna: ")); Serial.print(feels); Serial.println(F(" C"));
+  Serial.print(F("Tendencja cisn. 3h: "));
+  if (isnan(tendency)) {
+    Serial.println(F("brak danych"));
+  } else {
+    if (tendency > 0) Serial.print('+'); // Wzrost ciśnienia ze znakiem, jak na ekranie
+    Serial.print(tendency); Serial.println(F(" hPa"));
+  }
+  drawValueField(field + 1, F("Pkt rosy: "), dew, F(" C"), ST77XX_WHITE);
+  drawValueField(field + 2, F("Odczuwalna: "), feels, F(" C"), ST77XX_WHITE);
+  if (isnan(tendency)) { // Brak pomiarów sprzed 3 godzin (np. krótko po pierwszym uruchomieniu)
+    drawFieldP(field + 3, F("Cisn. 3h: brak danych"), FIELD_LINE_X, DARKGREY);
+  } else {
+    drawValueField(field + 3, tendency > 0 ? F("Cisn. 3h: +") : F("Cisn. 3h: "), tendency, F(" hPa"), ST77XX_WHITE);
+  }
+  clearFieldsFrom(field + 4);
+}
+
+// Funkcja do aktualizacji zawartości wyświetlacza w zależności od aktywnego indeksu ekranu
+// index: indeks ekranu do wyświetlenia
+// Rysowane są tylko elementy, które się zmieniły; liczbę wysłanych pikseli podaje polecenie "stats".
+void updateDisplayForScreenIndex(int index) {
+  unsigned long start = micros();
+  framePixels = 0; // Początek nowej ramki
+  if (index != buttonsDrawnIndex) drawScreenButtons(index); // Pasek przycisków tylko po zmianie ekranu
+  uint8_t kind = screenKind(index);
+  if (kind != SCREEN_GRAPH && graphShown) graphClearArea(); // Wykres zajmuje miejsce linii tekstu innych ekranów
+
+  switch (kind) { // Funkcja wyświetlająca dla rodzaju ekranu z tabeli SCREENS
+    case SCREEN_CURRENT:
+      displayBME280();      // Ekran bieżących danych
+      break;
+    case SCREEN_AVERAGE:
+      displayAverageScreen(index); // Ekran średnich z okna dni
+      break;
+    case SCREEN_GRAPH:
+      displayGraph();       // Ekran wykresu historii
+      break;
+    case SCREEN_DIAG:
+      displayDiagnostics(); // Ukryty ekran diagnostyczny (czasy sond)
+      break;
+  }
+  probeRecord(PROBE_SCREEN, micros() - start);
+  if (framePixels > framePixelsMax) framePixelsMax = framePixels;
+}
+
+// Funkcja zwracająca rodzaj ekranu (SCREEN_*) z tabeli SCREENS
+// Bez rozwijania w miejscu wywołania: wyznaczenie adresu wiersza tabeli we Flash jest w programie tylko raz.
+__attribute__((noinline)) uint8_t screenKind(int index) {
+  return pgm_read_byte(&SCREENS[index].kind);
+}
+
+// Funkcja do wyświetlania ekranu średnich: średnie kanałów z okna dni opisanego w tabeli SCREENS, a pod nimi
+// statystyki dnia (okno dzisiejsze) albo średnia ze średnich dziennych (okno kilku dni); bez pomiarów w oknie -
+// komunikat o braku danych
+// index: wiersz tabeli SCREENS
+void displayAverageScreen(int index) {
+  const ScreenInfo &screen = SCREENS[index];
+  const __FlashStringHelper *period = (const __FlashStringHelper *)screen.period;
+  uint8_t daysBack = pgm_read_byte(&screen.daysBack);
+  uint8_t dayCount = pgm_read_byte(&screen.dayCount);
+
+  // Nagłówek ekranu
+  char text[FIELD_TEXT_LEN];
+  snprintf_P(text, sizeof(text), PSTR("Srednia z %S"), screen.period);
+  drawField(FIELD_TITLE, text, FIELD_CENTERED, ST77XX_WHITE); // Wyśrodkuj i wyświetl nagłówek
+
+  // Jedno przejście silnika agregacji daje zarówno średnią ważoną, jak i średnią ze średnich dziennych
+  AggWindow window;
+  aggWindowDays(window, clockDay(), daysBack, dayCount);
+  runAggregation(&window, 1, NULL);
+  SensorData avg = aggWindowMean(window); // Średnia ze wszystkich pomiarów okna
+
+  Serial.print(F("--- Średnie dane z ")); Serial.print(period); Serial.println(F(" ---"));
+  if (!avg.isValid) { // Sprawdź, czy średnie dane są poprawne (czy były jakieś dane do obliczeń)
+    snprintf_P(text, sizeof(text), PSTR("Brak danych z %S!"), screen.period);
+    drawField(FIELD_LINE, text, FIELD_LINE_X, ST77XX_RED); // Komunikat o braku danych na czerwono
+    clearFieldsFrom(FIELD_LINE + 1);
+    Serial.println(text);
+    return;
+  }
+  printAverage(avg);
+  drawAverageFields(FIELD_LINE, avg, ST77XX_WHITE);
+
+  uint8_t field = FIELD_LINE + CHANNEL_COUNT; // Pierwsza linia pod średnimi
+  if (daysBack == 0 && dayCount == 1) {
+    displayDayStats(field); // Statystyki dnia obejmują tylko dzisiejsze odczyty
+  } else if (dayCount > 1) {
+    SensorData dailyAvg = aggWindowDailyMean(window); // Średnia ze średnich dziennych
+    Serial.print(F("Srednia srednich dziennych (")); Serial.print(window.daysWithData); Serial.println(F(" dni):"));
+    printAverage(dailyAvg);
+
+    // Średnia ze średnich dziennych (każdy dzień z tą samą wagą) - poniżej, po pustej linii, w kolorze szarym
+    drawField(field, "", FIELD_LINE_X, ST77XX_WHITE);
+    drawFieldP(field + 1, F("Sr. srednich dziennych:"), FIELD_LINE_X, DARKGREY);
+    drawAverageFields(field + 2, dailyAvg, DARKGREY);
+  } else {
+    clearFieldsFrom(field);
+  }
+}
+
+// Funkcja do wyświetlania statystyk dnia z odczytów czujnika (pamięć RAM) - w kolorze szarym, od linii field
+void displayDayStats(uint8_t field) {
+  const ChannelStats &t = dayStats[CH_TEMPERATURE];
+  if (t.count == 0 || statsDay != lastReading.time / 86400UL) { // Brak odczytów z dzisiaj
+    clearFieldsFrom(field);
+    return;
+  }
+  char text[FIELD_TEXT_LEN];
+  snprintf_P(text, sizeof(text), PSTR("Temp. od %02u:%02u:"), (unsigned)(statsStart % 86400UL / 3600),
+             (unsigned)(statsStart % 3600 / 60)); // Po restarcie statystyki obejmują tylko część dnia
+  drawField(field, text, FIELD_LINE_X, DARKGREY);
+  drawExtremeField(field + 1, F("Min: "), t.minValue, F(" C"), t.minTime, DARKGREY);
+  drawExtremeField(field + 2, F("Max: "), t.maxValue, F(" C"), t.maxTime, DARKGREY);
+  drawValueField(field + 3, F("Odch. std: "), statsStdDev(t), F(" C"), DARKGREY);
+  clearFieldsFrom(field + 4);
+
+  Serial.print(text); Serial.print(F(" min ")); Serial.print(t.minValue, 2);
+  Serial.print(F(", max ")); Serial.print(t.maxValue, 2);
+  Serial.print(F(", odch. std ")); Serial.println(statsStdDev(t), 2);
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) { // Pozostałe kanały tylko na monitorze szeregowym
+    if (ch == CH_TEMPERATURE) continue;
+    Serial.print((const __FlashStringHelper *)CHANNELS[ch].label); Serial.print(F(".: min "));
+    Serial.print(dayStats[ch].minValue, 2);
+    Serial.print(F(", max ")); Serial.println(dayStats[ch].maxValue, 2);
+  }
+}
+
+// Funkcja do wyświetlania ukrytego ekranu diagnostycznego: średni i najdłuższy czas każdej sondy w us
+// (linie po 25 znaków - tyle mieści się za wcięciem FIELD_LINE_X)
+// Ekran jest odświeżany co SENSOR_TASK_MS, więc czas jego rysowania trafia też do sondy "ekran".
+void displayDiagnostics() {
+  char title[FIELD_TEXT_LEN];
+  char duty[8];
+  dtostrf(dutyCyclePercent(), 1, 1, duty);
+  snprintf_P(title, sizeof(title), PSTR("Diagnostyka, akt. %s%%"), duty); // Udział czasu aktywnej pracy procesora
+  drawField(FIELD_TITLE, title, FIELD_CENTERED, ST77XX_WHITE);
+  drawFieldP(FIELD_LINE, F("Sonda us     sr.     maks"), FIELD_LINE_X, DARKGREY);
+  for (uint8_t i = 0; i < PROBE_COUNT && FIELD_LINE + 1 + i < FIELD_COUNT; i++) {
+    const Probe &p = probes[i];
+    char text[FIELD_TEXT_LEN + 8];
+    snprintf_P(text, sizeof(text), PSTR("%-8S%8lu%9lu"), probeNames[i],
+             (unsigned long)(p.count > 0 ? p.totalMicros / p.count : 0), (unsigned long)p.maxMicros);
+    drawField(FIELD_LINE + 1 + i, text, FIELD_LINE_X, ST77XX_WHITE);
+  }
+  clearFieldsFrom(FIELD_LINE + 1 + PROBE_COUNT);
+}
+
+// Funkcja zwracająca pozycję Y wartości (jednostki stałoprzecinkowe) na osi wartości rysowanego wykresu
+int16_t graphY(int16_t value) {
+  return GRAPH_TOP + GRAPH_HEIGHT - 1 - (int32_t)(value - graphLow) * (GRAPH_HEIGHT - 1) / (graphHigh - graphLow);
+}
+
+// Funkcja wyznaczająca oś wartości (graphLow, graphHigh) z minimów i maksimów przedziałów widocznych na wykresie
+// Rekordy zakresu są czytane po kolei w kolejności pliku (jedno przesunięcie), a bieżący przedział - z RAM.
+// Bez pliku oś obejmuje pomiary z kolejki EEPROM.
+// Zwraca false, jeśli w żadnym przedziale nie ma pomiarów.
+bool graphScale(File &f, uint8_t range, uint8_t channel) {
+  int16_t low = INT16_MAX, high = INT16_MIN;
+  const GraphBucket &open = graphOpen[range];
+  if (open.count > 0 && open.number == graphEnd) {
+    low = open.minValue[channel];
+    high = open.maxValue[channel];
+  }
+  if (f) {
+    seekGraphBucket(f, range, 0);
+    GraphBucket b;
+    for (uint8_t i = 0; i < GRAPH_COLUMNS && f.read(&b, sizeof(b)) == sizeof(b); i++) {
+      if (b.count == 0 || b.number > graphEnd || b.number + GRAPH_COLUMNS <= graphEnd) continue; // Poza wykresem
+      if (b.number == open.number && open.count > 0) continue; // Przedział jest jeszcze otwarty - aktualny w RAM
+      if (b.minValue[channel] < low) low = b.minValue[channel];
+      if (b.maxValue[channel] > high) high = b.maxValue[channel];
+    }
+  } else { // Bez pliku (karta wyjęta) - pomiary czekające w kolejce EEPROM
+    QueueSlot s;
+    for (uint16_t i = 0; i < queueCount; i++) {
+      if (!queueReadSlot(queuePending(i), s)) continue;
+      uint32_t number = s.time / GRAPH_BUCKET_S[range];
+      if (number > graphEnd || number + GRAPH_COLUMNS <= graphEnd) continue; // Poza wykresem
+      int16_t v = s.value[channel];
+      if (v < low) low = v;
+      if (v > high) high = v;
+    }
+  }
+  if (low > high) return false;
+  // Oś obejmuje co najmniej jedną jednostkę (1 C, 1 %, 1 hPa), aby szum czujnika przy stałej wartości
+  // nie wypełniał całej wysokości wykresu
+  int16_t minSpan = channelScale(channel);
+  if (high - low < minSpan) {
+    low -= (minSpan - (high - low)) / 2;
+    high = low + minSpan;
+  }
+  graphLow = low;
+  graphHigh = high;
+  return true;
+}
+
+// Funkcja czyszcząca obszar wykresu (przed rysowaniem nowego wykresu i po przejściu na inny ekran)
+void graphClearArea() {
+  tft.fillRect(0, GRAPH_AREA_TOP, tft.width(), GRAPH_AREA_HEIGHT, BACKGROUND);
+  framePixels += tft.width() * GRAPH_AREA_HEIGHT;
+  graphShown = false;
+  graphColumn = GRAPH_COLUMNS;
+}
+
+// Funkcja rysująca tło wykresu: czysty obszar, osie, linia pomocnicza w połowie osi wartości oraz etykiety
+// (wartości na górze i na dole osi, początek i koniec osi czasu)
+void graphDrawFrame(uint8_t range, uint8_t channel) {
+  graphClearArea();
+  for (uint8_t i = FIELD_LINE; i < FIELD_COUNT; i++) { // Linie tekstu leżały w wyczyszczonym obszarze
+    screenFields[i].text[0] = '\0';
+    screenFields[i].width = 0;
+  }
+  graphShown = true;
+  tft.drawFastVLine(GRAPH_X - 1, GRAPH_TOP, GRAPH_HEIGHT + 1, DARKGREY);
+  tft.drawFastHLine(GRAPH_X - 1, GRAPH_TOP + GRAPH_HEIGHT, GRAPH_COLUMNS + 1, DARKGREY);
+  tft.drawFastHLine(GRAPH_X, GRAPH_TOP + GRAPH_HEIGHT / 2, GRAPH_COLUMNS, GRAPH_GRID);
+  framePixels += GRAPH_HEIGHT + 1 + GRAPH_COLUMNS + 1 + GRAPH_COLUMNS;
+
+  char high[8], low[8];
+  uint8_t decimals = pgm_read_byte(&CHANNELS[channel].decimals);
+  dtostrf((float)graphHigh / channelScale(channel), 1, decimals, high);
+  dtostrf((float)graphLow / channelScale(channel), 1, decimals, low);
+  tft.setTextSize(1);
+  tft.setTextColor(ST77XX_WHITE, BACKGROUND);
+  tft.setCursor(0, GRAPH_TOP);
+  tft.print(high);
+  tft.setCursor(0, GRAPH_TOP + GRAPH_HEIGHT - 8);
+  tft.print(low);
+  tft.setTextColor(DARKGREY, BACKGROUND);
+  tft.setCursor(GRAPH_X, GRAPH_TOP + GRAPH_HEIGHT + 3);
+  tft.print((const __FlashStringHelper *)graphRangeStarts[range]);
+  tft.setCursor(GRAPH_X + GRAPH_COLUMNS - 5 * 6, GRAPH_TOP + GRAPH_HEIGHT + 3);
+  tft.print(F("teraz"));
+  framePixels += (strlen(high) + strlen(low) + strlen_P(graphRangeStarts[range]) + 5) * 6 * 8;
+}
+
+// Funkcja rysująca kolumnę wykresu: pionowy pas od minimum do maksimum przedziału i linię średniej
+// Linia średniej to pionowy odcinek od średniej poprzedniej kolumny, więc przebieg jest ciągły także przy skokach
+// wartości; kolumna bez pomiarów przerywa linię.
+void graphDrawColumn(uint8_t column, const GraphBucket &b, uint8_t channel) {
+  if (b.count == 0) {
+    graphLastY = -1;
+    return;
+  }
+  int16_t x = GRAPH_X + column;
+  int16_t top = graphY(b.maxValue[channel]);
+  int16_t bottom = graphY(b.minValue[channel]);
+  tft.drawFastVLine(x, top, bottom - top + 1, DARKGREY);
+  int16_t y = graphY(b.sum[channel] / b.count);
+  int16_t from = graphLastY < 0 ? y : graphLastY;
+  tft.drawFastVLine(x, min(from, y), abs(from - y) + 1, pgm_read_word(&CHANNELS[channel].color));
+  framePixels += bottom - top + 1 + abs(from - y) + 1;
+  graphLastY = y;
+}
+
+// Funkcja do wyświetlania wykresu historii (wielkość i zakres wg graphView, zmiana przyciskiem odświeżania)
+// Nowy wykres - po wejściu na ekran, zmianie wykresu albo zamknięciu przedziału - zaczyna się od wyznaczenia osi
+// wartości i narysowania tła. Kolumny są rysowane od najstarszej; po przekroczeniu GRAPH_BUDGET_US rysowanie jest
+// przerywane, a zadanie rysowania dokańcza je w kolejnym przebiegu pętli (przyciski i zapis działają w tym czasie).
+void displayGraph() {
+  unsigned long start = micros();
+  uint8_t channel = graphView / GRAPH_RANGES;
+  uint8_t range = graphView % GRAPH_RANGES;
+  char title[FIELD_TEXT_LEN];
+  snprintf_P(title, sizeof(title), PSTR("%S, %S"), CHANNELS[channel].name, graphRangeNames[range]);
+  drawField(FIELD_TITLE, title, FIELD_CENTERED, ST77XX_WHITE);
+
+  File f;
+  if (graphReady) f = SD.open(GRAPH_FILE);
+  if (graphColumn >= GRAPH_COLUMNS) { // Nowy wykres
+    graphEnd = clockSeconds() / GRAPH_BUCKET_S[range];
+    Serial.print(F("--- Wykres: ")); Serial.print(title); Serial.println(F(" ---"));
+    if (!graphScale(f, range, channel)) {
+      if (f) f.close();
+      if (graphShown) graphClearArea();
+      drawFieldP(FIELD_LINE, F("Brak danych do wykresu"), FIELD_LINE_X, ST77XX_RED);
+      clearFieldsFrom(FIELD_LINE + 1);
+      Serial.println(F("Brak danych do wykresu"));
+      return;
+    }
+    Serial.print(F("Os wartosci: ")); Serial.print((float)graphLow / channelScale(channel));
+    Serial.print(F(" .. ")); Serial.println((float)graphHigh / channelScale(channel));
+    graphDrawFrame(range, channel);
+    graphColumn = 0;
+    graphLastY = -1;
+    graphQueueNext = 0;
+  }
+
+  const GraphBucket &open = graphOpen[range];
+  GraphBucket b;
+  while (graphColumn < GRAPH_COLUMNS) {
+    uint32_t number = graphEnd - (GRAPH_COLUMNS - 1 - graphColumn);
+    if (open.number == number && open.count > 0) b = open; // Bieżący przedział (ostatnia kolumna)
+    else if (!f) queueBucket(range, number, b);           // Bez pliku - tylko pomiary z kolejki EEPROM
+    else readGraphBucket(f, range, number, b);            // Przedział spoza pliku zostaje pusty
+    graphDrawColumn(graphColumn++, b, channel);
+    if (graphColumn < GRAPH_COLUMNS && micros() - start >= GRAPH_BUDGET_US) {
+      displayDirty = true; // Pozostałe kolumny w następnym przebiegu zadania rysowania
+      break;
+    }
+  }
+  if (f) f.close();
 }
 
 // --- Funkcje do wyliczania średnich z pliku CSV ---
 
+// Funkcja zwracająca numer dnia (liczbę pełnych dni od 2000-01-01) dla podanej daty
+// Dwie daty z tego samego dnia mają ten sam numer, a różnica numerów to liczba dni między nimi.
+uint16_t dayNumber(const DateTime &date) {
+  return date.secondstime() / 86400UL; // secondstime() liczy sekundy od 2000-01-01 00:00:00
+}
+
+// Funkcja zwracająca mnożnik wartości stałoprzecinkowej kanału (z tablicy CHANNELS w pamięci programu)
+int16_t channelScale(uint8_t ch) {
+  return (int16_t)pgm_read_word(&CHANNELS[ch].scale);
+}
+
+// Funkcja sprawdzająca, czy wartość stałoprzecinkowa kanału mieści się w jego realnym zakresie (z tablicy CHANNELS)
+bool channelInRange(uint8_t ch, int32_t value) {
+  return value >= (int16_t)pgm_read_word(&CHANNELS[ch].minValue) &&
+         value <= (int16_t)pgm_read_word(&CHANNELS[ch].maxValue);
+}
+
+// Funkcja sprawdzająca, czy odczytane wartości mieszczą się w realnych zakresach
+// Zakresy kanałów są w tablicy CHANNELS - możesz je tam dostosować, aby odfiltrować nieprawidłowe dane.
+bool isReadingPlausible(const SensorData &reading) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    float f = reading.value[ch] * channelScale(ch);
+    if (isnan(f) || f < INT16_MIN || f > INT16_MAX) return false; // NaN albo poza zakresem wartości stałoprzecinkowej
+    if (!channelInRange(ch, lround(f))) return false;
+  }
+  return true;
+}
+
+// Funkcja zwracająca numer dnia (dni od 2000-01-01) dla daty podanej liczbami, bez budowania obiektu DateTime
+// Obsługuje lata 2000-2099 (co czwarty rok przestępny); data musi być poprawna.
+uint16_t dateToDay(uint16_t year, uint8_t month, uint8_t day) {
+  uint16_t y = year - 2000;
+  uint16_t days = y * 365 + (y + 3) / 4 + DAYS_BEFORE_MONTH[month - 1] + day - 1; // (y + 3) / 4 - wcześniejsze lata przestępne
+  if (month > 2 && y % 4 == 0) days++; // 29 lutego bieżącego roku
+  return days;
+}
+
+// Funkcja odczytująca dokładnie count cyfr dziesiętnych spod wskaźnika p (p przesuwa się za odczytane cyfry)
+bool parseDigits(const char *&p, uint8_t count, uint16_t &value) {
+  value = 0;
+  for (uint8_t i = 0; i < count; i++, p++) {
+    if (*p < '0' || *p > '9') return false;
+    value = value * 10 + (*p - '0');
+  }
+  return true;
+}
+
+// Funkcja odczytująca liczbę dziesiętną (np. "-3.25") wprost do postaci stałoprzecinkowej o podanej skali
+// (10 - dziesiąte części, 100 - setne), bez obliczeń zmiennoprzecinkowych. Cyfry poza skalą zaokrąglają wynik
+// tak jak lround() w toFixedValues(). Zwraca false dla liczby w złym formacie lub spoza zakresu int16_t.
+bool parseFixed(const char *&p, int16_t scale, int16_t &value) {
+  bool negative = *p == '-';
+  if (negative) p++;
+  if (*p < '0' || *p > '9') return false; // Wymagana co najmniej jedna cyfra części całkowitej
+  int32_t v = 0;
+  while (*p >= '0' && *p <= '9') {
+    v = v * 10 + (*p++ - '0');
+    if (v > 32767) return false; // Część całkowita już poza zakresem
+  }
+  v *= scale;
+  if (*p == '.') {
+    p++;
+    for (int16_t unit = scale / 10; unit > 0 && *p >= '0' && *p <= '9'; unit /= 10) v += (*p++ - '0') * unit;
+    if (*p >= '5' && *p <= '9') v++; // Zaokrąglenie wg pierwszej cyfry poza skalą
+    while (*p >= '0' && *p <= '9') p++;
+  }
+  if (v > 32767) return false;
+  value = negative ? -v : v;
+  return true;
+}
+
+// Funkcja odczytująca datę w formacie RRRR-MM-DD spod wskaźnika p jako numer dnia (p przesuwa się za datę)
+// Zwraca false dla innego formatu i dla nieistniejącej daty (np. 31 kwietnia) lub roku spoza 2000-2099.
+bool parseDate(const char *&p, uint16_t &day) {
+  uint16_t year, month, monthDay;
+  if (!parseDigits(p, 4, year) || *p++ != '-' || !parseDigits(p, 2, month) || *p++ != '-' ||
+      !parseDigits(p, 2, monthDay)) {
+    return false;
+  }
+  if (year < 2000 || year > 2099 || month < 1 || month > 12 || monthDay < 1) return false;
+  uint16_t monthEnd = month < 12 ? DAYS_BEFORE_MONTH[month] : 365;
+  if (monthDay > monthEnd - DAYS_BEFORE_MONTH[month - 1] + (month == 2 && year % 4 == 0)) return false;
+  day = dateToDay(year, month, monthDay);
+  return true;
+}
+
+// Funkcja rozbierająca jedną linię pliku CSV na numer dnia, czas i wartości pomiarów
+// line: linia w formacie "RRRR-MM-DD, HH:MM:SS, Temperatura, Wilgotność, Ciśnienie" (bez końca linii)
+// Data trafia wprost do numeru dnia, a wartości - do postaci stałoprzecinkowej wg mnożników kanałów.
+// Zwraca false dla linii w innym formacie (np. nagłówka, uszkodzonej linii lub nieistniejącej daty)
+bool parseCSVLine(const char *line, CSVRow &row) {
+  const char *p = line;
+  uint16_t hour, minute, second;
+  if (!parseDate(p, row.day) || *p++ != ',') return false; // Data (format: RRRR-MM-DD)
+  while (*p == ' ') p++;
+  // Czas (format: HH:MM:SS po przecinku i spacji)
+  if (!parseDigits(p, 2, hour) || *p++ != ':' || !parseDigits(p, 2, minute) || *p++ != ':' ||
+      !parseDigits(p, 2, second)) {
+    return false;
+  }
+  if (hour > 23 || minute > 59 || second > 59) return false;
+  row.hour = hour;
+  row.minute = minute;
+  row.second = second;
+
+  // Temperatura, wilgotność i ciśnienie - każda wartość po przecinku i spacji
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    if (*p++ != ',') return false;
+    while (*p == ' ') p++;
+    if (!parseFixed(p, channelScale(ch), row.value[ch])) return false;
+  }
+  return *p == '\0'; // Po ostatniej wartości nie może być już nic
+}
+
+// Funkcja ustawiająca czytnik na pliku, na początku pierwszej pełnej linii zaczynającej się w miejscu start lub dalej
+// Liczniki pominiętych linii nie są zerowane - jeden czytnik może kolejno czytać kilka plików.
+void csvReaderStart(CSVReader &in, File &file, uint32_t start) {
+  in.file = &file;
+  in.pos = 0;
+  in.length = 0;
+  file.seek(start > 0 ? start - 1 : 0);
+  if (start == 0) return;
+  // Jeśli poprzedni znak to '\n', start jest już początkiem linii; inaczej pomiń resztę przeciętej linii
+  while (csvFill(in)) {
+    const uint8_t *nl = (const uint8_t *)memchr(in.block + in.pos, '\n', in.length - in.pos);
+    if (nl) {
+      in.pos = nl - in.block + 1;
+      return;
+    }
+    in.pos = in.length;
+  }
+}
+
+// Funkcja wczytująca następny blok pliku, jeśli bieżący został już przeczytany; zwraca false na końcu pliku
+bool csvFill(CSVReader &in) {
+  if (in.pos < in.length) return true;
+  int n = in.file->read(in.block, CSV_BLOCK); // Jedno wywołanie na blok zamiast jednego na znak
+  in.pos = 0;
+  in.length = n > 0 ? n : 0;
+  return n > 0;
+}
+
+// Funkcja wycinająca z pliku następną linię do bufora csvFileLine (bez "\r\n", zakończoną '\0')
+// Linia dłuższa niż CSV_LINE_MAX jest pomijana w całości (liczona w longLines), a niepełna ostatnia linia pliku
+// (bez '\n', np. po przerwanym zapisie) - liczona w badLines. Zwraca długość linii albo -1 na końcu pliku.
+int16_t csvReadLine(CSVReader &in) {
+  for (;;) {
+    uint8_t len = 0;
+    bool tooLong = false; // Czy linia przekroczyła już bufor
+    bool ended = false;   // Czy znaleziono koniec linii
+    while (!ended && csvFill(in)) {
+      const uint8_t *start = in.block + in.pos;
+      const uint8_t *nl = (const uint8_t *)memchr(start, '\n', in.length - in.pos);
+      uint8_t chunk = (nl ? nl : in.block + in.length) - start;
+      if (!tooLong && len + chunk <= CSV_LINE_MAX + 1) { // +1: miejsce na '\r' przed '\n'
+        memcpy(csvFileLine + len, start, chunk);
+        len += chunk;
+      } else {
+        tooLong = true;
+      }
+      in.pos += chunk;
+      if (nl) {
+        in.pos++; // Pomiń '\n'
+        ended = true;
+      }
+    }
+    if (!ended) { // Koniec pliku
+      if (len > 0 || tooLong) in.badLines++; // Niepełna ostatnia linia
+      return -1;
+    }
+    if (len > 0 && csvFileLine[len - 1] == '\r') len--;
+    if (tooLong || len > CSV_LINE_MAX) { // Za długa linia - pomiń ją i czytaj następną
+      in.longLines++;
+      continue;
+    }
+    csvFileLine[len] = '\0';
+    return len;
+  }
+}
+
+// Funkcja czytająca z pliku kolejny wiersz pomiarów; linie w innym formacie są pomijane i liczone w badLines
+// (poza nagłówkiem kolumn). Zwraca false na końcu pliku. Odczytana linia pozostaje w buforze csvFileLine
+// (np. do komunikatów).
+bool readCSVRow(CSVReader &in, CSVRow &row) {
+  while (csvReadLine(in) >= 0) {
+    if (parseCSVLine(csvFileLine, row)) return true;
+    if (strncmp_P(csvFileLine, PSTR("Date,"), 5) != 0) in.badLines++; // Nagłówek kolumn nie jest błędem
+  }
+  return false;
+}
+
+// Funkcja wypisująca liczbę linii pominiętych przez czytnik (tylko jeśli jakieś pominięto)
+void printSkippedLines(const CSVReader &in) {
+  if (in.badLines == 0 && in.longLines == 0) return;
+  Serial.print(F("Pominięto linii CSV: "));
+  Serial.print(in.badLines);
+  Serial.print(F(" uszkodzonych, "));
+  Serial.print(in.longLines);
+  Serial.println(F(" za długich"));
+}
+
+// Funkcja sprawdzająca, czy wartości z wiersza CSV mieszczą się w realnych zakresach
+// Te same zakresy co w isReadingPlausible() (tablica CHANNELS, jednostki stałoprzecinkowe).
+bool isRowPlausible(const CSVRow &row) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    if (!channelInRange(ch, row.value[ch])) return false;
+  }
+  return true;
+}
+
 // Funkcja obliczająca średnie wartości temperatury, wilgotności i ciśnienia
-// dla danych z określonej liczby dni wstecz.
+// dla danych z określonej liczby dni wstecz, zawsze przez przeszukanie pliku CSV (tylko pliku miesiąca tego dnia).
 // daysBack: 0 dla dzisiaj, 1 dla wczoraj, itd.
 SensorData calculateAverageFromCSV(int daysBack) {
-  File file = SD.open("dane.csv"); // Otwórz plik danych CSV do odczytu
-  SensorData sum = {0, 0, 0, false}; // Inicjalizacja sumatorów i flagi isValid na false
-  int count = 0; // Licznik poprawnych odczytów
-
-  if (file) { // Sprawdź, czy plik został pomyślnie otwarty
-    DateTime now = rtc.now(); // Pobierz aktualną datę z RTC
-
-    // Pomijamy pierwszą linię nagłówkową pliku CSV
-    file.readBytesUntil('\n', csvFileLine, sizeof(csvFileLine) - 1);
-
-    while (file.available()) { // Dopóki są dostępne dane w pliku
-      // Odczytaj jedną linię z pliku CSV
-      int len = file.readBytesUntil('\n', csvFileLine, sizeof(csvFileLine) - 1);
-      csvFileLine[len] = '\0'; // Dodaj znak null na końcu odczytanej linii, aby była poprawnym stringiem C
-       
-      // Parsowanie daty (format: YYYY-MM-DD) z początku linii CSV
-      int y = atoi(csvFileLine);      // Rok
-      int m = atoi(csvFileLine + 5);  // Miesiąc (przesunięcie o 5 znaków: YYYY-)
-      int d = atoi(csvFileLine + 8);  // Dzień (przesunięcie o 8 znaków: YYYY-MM-)
-
-      DateTime recordDate(y, m, d); // Utwórz obiekt DateTime dla daty zapisu z pliku
-      TimeSpan delta = now - recordDate; // Oblicz różnicę czasową między aktualną datą a datą rekordu
-
-      // Sprawdź, czy rekord pochodzi z wybranego dnia (np. dzisiaj, wczoraj)
-      if (delta.days() == daysBack) {
-        // Znajdź początek danych pomiarowych po dacie i czasie
-        char *ptr = strchr(csvFileLine, ',') + 1; // Przejdź za pierwszą przecinek (po dacie)
-        ptr = strchr(ptr, ',') + 1;             // Przejdź za drugi przecinek (po czasie)
-
-        // Konwersja stringów na wartości zmiennoprzecinkowe (float)
-        float temp = atof(ptr);                 // Temperatura
-        ptr = strchr(ptr, ',') + 1;             // Przejdź za kolejny przecinek
-
-        float hum = atof(ptr);                  // Wilgotność
-        ptr = strchr(ptr, ',') + 1;             // Przejdź za kolejny przecinek
-
-        float press = atof(ptr);                // Ciśnienie
-
-        // Dodatkowe sprawdzenie, czy odczytane wartości nie są absurdalne
-        // (np. bardzo duże liczby z powodu błędnego parsowania lub uszkodzenia danych)
-        // Możesz dostosować te zakresy do swoich potrzeb, aby odfiltrować nieprawidłowe dane.
-        if (!isnan(temp) && !isnan(hum) && !isnan(press) && // Upewnij się, że nie są to NaN
-            temp > -50 && temp < 100 &&                 // Przykładowy realny zakres temperatur
-            hum >= 0 && hum <= 100 &&                   // Przykładowy realny zakres wilgotności
-            press > 500 && press < 1200) {              // Przykładowy realny zakres ciśnienia
-          sum.temperature += temp; // Dodaj do sumy
-          sum.humidity += hum;
-          sum.pressure += press;
-          count++;                 // Zwiększ licznik poprawnych odczytów
-        } else {
-          Serial.print("Ostrzeżenie: pominięto niepoprawne dane z pliku SD (dzień ");
-          Serial.print(daysBack); Serial.print("): ");
-          Serial.println(csvFileLine); // Wypisz ostrzeżenie o pominiętej linii
-        }
+  AggWindow day;
+  aggWindowDays(day, clockDay(), daysBack, 1); // Okno obejmujące jeden dzień
+  AggPending pending; // Wiersze czekające w paczce zapisu - dokładane w RAM zamiast zapisu niepełnego sektora
+  aggPending = &pending;
+  loadAggPending(pending, NULL);
+  aggregateFromCSV(&day, 1, NULL);
+  aggAddPending(&day, 1);
+  return aggWindowMean(day); // Zwróć strukturę ze średnimi danymi lub NaN
+}
+
+// --- Pliki miesięczne dziennika CSV ---
+
+// Funkcja zwracająca numer miesiąca (liczbę pełnych miesięcy od 2000-01) dla podanej daty
+uint16_t monthNumber(const DateTime &date) {
+  return (date.year() - 2000) * 12 + date.month() - 1;
+}
+
+// Funkcja zwracająca numer miesiąca, do którego należy dzień o podanym numerze
+uint16_t dayToMonth(uint16_t day) {
+  return monthNumber(DateTime(day * 86400UL + SECONDS_FROM_1970_TO_2000));
+}
+
+// Funkcja wpisująca do bufora path (LOG_PATH_LEN znaków) ścieżkę pliku miesiąca, np. "/2026/10.csv"
+// Pierwsze 5 znaków to ścieżka katalogu roku - wystarczy wpisać '\0' w path[5].
+char *partitionPath(char *path, uint16_t month) {
+  snprintf_P(path, LOG_PATH_LEN, PSTR("/%04u/%02u.csv"), 2000 + month / 12, month % 12 + 1);
+  return path;
+}
+
+// Funkcja szukająca pierwszego istniejącego pliku miesiąca od miesiąca from do to (włącznie), idąc o step (1 lub -1)
+// Katalog roku jest sprawdzany raz na rok, a lata bez katalogu są pomijane w całości.
+// Zwraca numer miesiąca albo LOG_NO_MONTH, jeśli w zakresie nie ma żadnego pliku.
+uint16_t findPartition(uint16_t from, uint16_t to, int8_t step) {
+  char path[LOG_PATH_LEN];
+  int32_t yearFound = -1; // Rok, którego katalog już sprawdzono i istnieje
+  for (int32_t month = from; step > 0 ? month <= to : month >= to; month += step) {
+    partitionPath(path, month);
+    if (month / 12 != yearFound) {
+      path[5] = '\0';
+      if (!SD.exists(path)) { // Brak katalogu roku - przejdź na skraj roku, pętla przejdzie do sąsiedniego
+        month = step > 0 ? month - month % 12 + 11 : month - month % 12;
+        continue;
       }
+      path[5] = '/';
+      yearFound = month / 12;
     }
-    file.close(); // Zamknij plik po zakończeniu odczytu
+    if (SD.exists(path)) return month;
   }
+  return LOG_NO_MONTH;
+}
 
-  if (count > 0) { // Jeśli były jakieś poprawne dane do obliczenia średniej
-    sum.temperature = sum.temperature / count; // Oblicz średnią temperaturę
-    sum.humidity = sum.humidity / count;       // Oblicz średnią wilgotność
-    sum.pressure = sum.pressure / count;       // Oblicz średnie ciśnienie
-    sum.isValid = true; // Oznacz dane jako ważne, ponieważ były pomiary
-  } else {
-    // Jeśli nie ma danych dla danego dnia, ustaw wartości na NaN (Not a Number)
-    // i oznacz isValid jako false, aby wskazać brak poprawnych danych.
-    sum.temperature = NAN;
-    sum.humidity = NAN;
-    sum.pressure = NAN;
-    sum.isValid = false;
+// Funkcja otwierająca czytnik na pierwszym istniejącym pliku z zakresu miesięcy firstMonth..lastMonth
+// offset: miejsce początku odczytu w pliku miesiąca firstMonth (późniejsze pliki są czytane od początku)
+// Zwraca false, jeśli w zakresie nie ma żadnego pliku.
+bool logReaderOpen(LogReader &r, uint16_t firstMonth, uint16_t lastMonth, uint32_t offset) {
+  char path[LOG_PATH_LEN];
+  r.lastMonth = lastMonth;
+  r.endOffset = 0;
+  r.month = findPartition(firstMonth, lastMonth, 1);
+  if (r.month == LOG_NO_MONTH) return false;
+  r.file = SD.open(partitionPath(path, r.month));
+  if (!r.file) return false;
+  csvReaderStart(r.csv, r.file, r.month == firstMonth ? offset : 0);
+  return true;
+}
+
+// Funkcja zwracająca kolejny wiersz pomiarów z plików czytnika; po końcu pliku przechodzi do następnego miesiąca
+// Zwraca false po ostatnim pliku zakresu - r.month i r.endOffset wskazują wtedy koniec przeczytanych danych.
+bool logReaderNext(LogReader &r, CSVRow &row) {
+  char path[LOG_PATH_LEN];
+  while (r.file) {
+    if (readCSVRow(r.csv, row)) return true;
+    r.endOffset = r.file.size();
+    r.file.close();
+    uint16_t next = r.month < r.lastMonth ? findPartition(r.month + 1, r.lastMonth, 1) : LOG_NO_MONTH;
+    if (next == LOG_NO_MONTH) break;
+    r.month = next;
+    r.endOffset = 0;
+    r.file = SD.open(partitionPath(path, next));
+    if (r.file) csvReaderStart(r.csv, r.file, 0);
   }
-  return sum; // Zwróć strukturę ze średnimi danymi lub NaN
+  return false;
+}
+
+// Funkcja sprawdzająca, czy miejsce zapisane w indeksie lub dzienniku binarnym (miesiąc i miejsce w pliku) pasuje
+// do karty: plik tego miesiąca nie może być krótszy (inaczej został usunięty lub zastąpiony innym plikiem)
+bool logCursorValid(uint16_t month, uint32_t offset) {
+  if (offset == 0) return true; // Z tego miesiąca nie przeczytano jeszcze niczego
+  char path[LOG_PATH_LEN];
+  File file = SD.open(partitionPath(path, month));
+  if (!file) return false;
+  uint32_t size = file.size();
+  file.close();
+  return size >= offset;
 }
 
-// Funkcja obliczająca średnie wartości z całego ostatniego tygodnia (7 dni)
-SensorData calculateWeeklyAverage() {
-  SensorData sum = {0, 0, 0, false}; // Inicjalizacja sumatorów i flagi isValid na false
-  int validDays = 0;                 // Licznik dni, dla których znaleziono poprawne dane
+// Funkcja otwierająca do dopisywania plik podanego miesiąca (plik innego miesiąca jest najpierw zamykany)
+// Brakujący katalog roku jest tworzony, a nowy plik dostaje nagłówek kolumn.
+bool openDataFile(uint16_t month) {
+  if (dataFile && dataFileMonth == month) return true;
+  if (dataFile) dataFile.close();
+  char path[LOG_PATH_LEN];
+  partitionPath(path, month);
+  path[5] = '\0';
+  SD.mkdir(path); // Katalog roku (bez zmian, jeśli już istnieje)
+  path[5] = '/';
+  dataFile = SD.open(path, FILE_WRITE);
+  if (!dataFile) {
+    Serial.print(F("Błąd otwarcia pliku ")); Serial.print(path); Serial.println(F(" do zapisu"));
+    return false;
+  }
+  dataFileMonth = month;
+  if (dataFile.size() == 0) { // Nowy plik miesiąca - dodaj nagłówek
+    printCSVHeader(dataFile); // Nagłówek kolumn
+    dataFile.flush(); // Zapisz nagłówek od razu, aby rozmiar pliku na karcie był aktualny
+  }
+  return true;
+}
 
-  // Pętla od dzisiaj (0 dni wstecz) do 6 dni wstecz, łącznie 7 dni
-  for (int i = 0; i < 7; i++) {
-    SensorData day = calculateAverageFromCSV(i); // Oblicz średnie dla każdego dnia
-    if (day.isValid) { // Jeśli dane dla danego dnia są poprawne (były pomiary)
-      sum.temperature += day.temperature; // Dodaj średnie dzienne do sumy tygodniowej
-      sum.humidity += day.humidity;
-      sum.pressure += day.pressure;
-      validDays++; // Zwiększ licznik ważnych dni
+// Funkcja dzieląca dawny plik dane.csv na pliki miesięczne (przy pierwszym starcie z plikami miesięcznymi)
+// Biblioteka SD nie zmienia nazw plików, więc wiersze są przepisywane. Plik miesiąca jest tworzony od nowa przy
+// pierwszym wierszu tego miesiąca, więc podział przerwany zanikiem zasilania i powtórzony przy następnym starcie
+// nie dubluje wierszy. Plik dane.csv jest usuwany dopiero wtedy, gdy wszystkie wiersze są już w plikach miesięcy.
+void migrateLegacyLog() {
+  File legacy = SD.open(LEGACY_LOG_FILE);
+  if (!legacy) return; // Brak dawnego pliku - nie ma czego dzielić
+  Serial.println(F("Podział dane.csv na pliki miesięczne..."));
+  char path[LOG_PATH_LEN];
+  uint16_t newest = LOG_NO_MONTH; // Najpóźniejszy miesiąc, do którego trafiły już wiersze
+  uint32_t rows = 0;
+  bool ok = true;
+  CSVRow row;
+  CSVReader in;
+  csvReaderStart(in, legacy, 0);
+  while (ok && readCSVRow(in, row)) {
+    uint16_t month = dayToMonth(row.day);
+    if (!dataFile || month != dataFileMonth) {
+      if (newest == LOG_NO_MONTH || month > newest) { // Pierwszy wiersz miesiąca - plik miesiąca od nowa
+        if (dataFile) dataFile.close();
+        SD.remove(partitionPath(path, month));
+        newest = month;
+      }
+      ok = openDataFile(month);
     }
+    uint8_t len = strlen(csvFileLine); // Linia bez "\r\n", bufor ma miejsce na jeszcze 2 znaki
+    csvFileLine[len++] = '\r';
+    csvFileLine[len++] = '\n';
+    if (ok) ok = dataFile.write((const uint8_t *)csvFileLine, len) == len;
+    rows++;
   }
+  legacy.close();
+  if (dataFile) dataFile.close(); // Zamknięcie zapisuje na kartę ostatni plik miesiąca
+  if (!ok) {
+    Serial.println(F("Błąd podziału dane.csv - ponowna próba przy następnym starcie"));
+    return;
+  }
+  SD.remove(LEGACY_LOG_FILE);
+  Serial.print(F("Przeniesiono wierszy do plików miesięcznych: "));
+  Serial.println(rows);
+  printSkippedLines(in);
+}
 
-  if (validDays > 0) { // Jeśli znaleziono jakiekolwiek ważne dni z danymi
-    sum.temperature /= validDays; // Oblicz średnią tygodniową temperaturę
-    sum.humidity /= validDays;    // Oblicz średnią tygodniową wilgotność
-    sum.pressure /= validDays;    // Oblicz średnie tygodniowe ciśnienie
-    sum.isValid = true; // Oznacz średnią tygodniową jako ważną
-  } else {
-    // Jeśli nie ma żadnych ważnych danych z ostatnich 7 dni, ustaw wartości na NaN
-    // i oznacz isValid jako false.
-    sum.temperature = NAN;
-    sum.humidity = NAN;
-    sum.pressure = NAN;
-    sum.isValid = false;
-  }
-  return sum; // Zwróć strukturę ze średnimi tygodniowymi danymi lub NaN
+// --- Indeks dziennych agregatów (plik dni.idx) ---
+// Rekord dnia D leży pod adresem sizeof(DayIndexHeader) + (D - firstDay) * sizeof(DayIndexRecord),
+// więc odczyt danych z jednego dnia to jedno przesunięcie w pliku i odczyt jednego rekordu,
+// niezależnie od tego, ile danych jest w plikach CSV.
+
+// Funkcja licząca sumę kontrolną rekordu dnia (wszystkie bajty oprócz samej sumy kontrolnej)
+uint8_t dayRecordChecksum(const DayIndexRecord &rec) {
+  const uint8_t *bytes = (const uint8_t *)&rec;
+  uint8_t sum = 0xA5; // Wartość początkowa różna od zera, aby rekord wypełniony zerami nie był uznany za poprawny
+  for (uint8_t i = 0; i < sizeof(DayIndexRecord) - 1; i++) {
+    sum = ((sum << 1) | (sum >> 7)) ^ bytes[i]; // Rotacja i XOR - wykrywa też zamienione miejscami bajty
+  }
+  return sum;
+}
+
+// Funkcja przygotowująca pusty rekord dnia (dzień bez pomiarów)
+void clearDayRecord(DayIndexRecord &rec, uint16_t day) {
+  rec.day = day;
+  rec.count = 0;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    rec.sum[ch] = 0;
+    rec.minValue[ch] = 32767;  // Największa wartość int16_t - pierwszy pomiar zawsze będzie mniejszy
+    rec.maxValue[ch] = -32768; // Najmniejsza wartość int16_t - pierwszy pomiar zawsze będzie większy
+  }
+  rec.checksum = dayRecordChecksum(rec);
+}
+
+// Funkcja zamieniająca pomiar na wartości stałoprzecinkowe kanałów (wg mnożników z tablicy CHANNELS)
+void toFixedValues(const SensorData &reading, int16_t values[CHANNEL_COUNT]) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = lround(reading.value[ch] * channelScale(ch));
+}
+
+// Funkcja dodająca pomiar (w jednostkach stałoprzecinkowych) do rekordu dnia
+// weight: liczba pomiarów, które reprezentują wartości (1 - pojedynczy pomiar, więcej - średnia godzinowa z bufora)
+void addToDayRecord(DayIndexRecord &rec, const int16_t values[CHANNEL_COUNT], uint8_t weight) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    int16_t v = values[ch];
+    rec.sum[ch] += (int32_t)v * weight;
+    if (v < rec.minValue[ch]) rec.minValue[ch] = v;
+    if (v > rec.maxValue[ch]) rec.maxValue[ch] = v;
+  }
+  rec.count += weight;
+  rec.checksum = dayRecordChecksum(rec);
+}
+
+// Funkcja dołączająca do rekordu dziennego pomiary z drugiego rekordu tego samego dnia
+void mergeDayRecord(DayIndexRecord &rec, const DayIndexRecord &other) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    rec.sum[ch] += other.sum[ch];
+    if (other.minValue[ch] < rec.minValue[ch]) rec.minValue[ch] = other.minValue[ch];
+    if (other.maxValue[ch] > rec.maxValue[ch]) rec.maxValue[ch] = other.maxValue[ch];
+  }
+  rec.count += other.count;
+  rec.checksum = dayRecordChecksum(rec);
+}
+
+// Funkcja odczytująca i sprawdzająca nagłówek indeksu
+// Zwraca false, jeśli plik nie jest poprawnym indeksem w bieżącej wersji formatu
+bool readIndexHeader(File &idx, DayIndexHeader &hdr) {
+  idx.seek(0);
+  if (idx.read(&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+  if (memcmp_P(hdr.magic, PSTR("SIDX"), 4) != 0 || hdr.version != INDEX_VERSION ||
+      hdr.recordSize != sizeof(DayIndexRecord)) {
+    return false;
+  }
+  // Rozmiar pliku musi odpowiadać pełnej liczbie rekordów (inaczej ostatni zapis został przerwany)
+  return (idx.size() - sizeof(hdr)) % sizeof(DayIndexRecord) == 0;
+}
+
+// Funkcja zapisująca nagłówek na początku pliku indeksu
+bool writeIndexHeader(File &idx, const DayIndexHeader &hdr) {
+  idx.seek(0);
+  return idx.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+}
+
+// Funkcja odczytująca z indeksu rekord podanego dnia
+// Dla dni spoza indeksu (bez pomiarów) zwraca pusty rekord. Zwraca false, jeśli rekord jest uszkodzony.
+bool readDayRecord(File &idx, const DayIndexHeader &hdr, uint16_t day, DayIndexRecord &rec) {
+  uint32_t recordCount = (idx.size() - sizeof(DayIndexHeader)) / sizeof(DayIndexRecord);
+  if (hdr.firstDay == INDEX_NO_DAY || day < hdr.firstDay || (uint32_t)(day - hdr.firstDay) >= recordCount) {
+    clearDayRecord(rec, day);
+    return true;
+  }
+  idx.seek(sizeof(DayIndexHeader) + (uint32_t)(day - hdr.firstDay) * sizeof(DayIndexRecord));
+  if (idx.read(&rec, sizeof(rec)) != sizeof(rec)) return false;
+  return rec.day == day && rec.checksum == dayRecordChecksum(rec);
+}
+
+// Funkcja zapisująca rekord dnia do indeksu
+// Jeśli rekord leży za końcem pliku, dni bez pomiarów są uzupełniane pustymi rekordami,
+// aby położenie każdego rekordu wynikało wprost z numeru dnia.
+bool writeDayRecord(File &idx, DayIndexHeader &hdr, const DayIndexRecord &rec) {
+  if (hdr.firstDay == INDEX_NO_DAY) { // Pierwszy dzień w pustym indeksie
+    hdr.firstDay = rec.day;
+    if (!writeIndexHeader(idx, hdr)) return false;
+  }
+  if (rec.day < hdr.firstDay) return false; // Dzień sprzed początku indeksu (np. po cofnięciu zegara)
+
+  uint32_t recordCount = (idx.size() - sizeof(DayIndexHeader)) / sizeof(DayIndexRecord);
+  uint32_t slot = rec.day - hdr.firstDay; // Numer rekordu w pliku
+  if (slot > recordCount) {
+    DayIndexRecord empty;
+    idx.seek(idx.size());
+    for (uint32_t i = recordCount; i < slot; i++) { // Uzupełnij dni bez pomiarów
+      clearDayRecord(empty, hdr.firstDay + i);
+      if (idx.write((const uint8_t *)&empty, sizeof(empty)) != sizeof(empty)) return false;
+    }
+  }
+  idx.seek(sizeof(DayIndexHeader) + slot * sizeof(DayIndexRecord));
+  return idx.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
+
+// Funkcja dopisująca do indeksu pomiary z plików CSV od miejsca, do którego indeks jest aktualny (hdr.logMonth,
+// hdr.logOffset), aż do końca najnowszego pliku. Służy do pełnej przebudowy indeksu (od pierwszego pliku) oraz do
+// uzupełnienia indeksu o wiersze, które trafiły na kartę bez aktualizacji indeksu (np. przy zaniku zasilania).
+bool indexLogFrom(File &idx, DayIndexHeader &hdr) {
+  uint16_t month = dayToMonth(clockDay());
+  LogReader log;
+  if (!logReaderOpen(log, hdr.logMonth, hdr.logMonth > month ? hdr.logMonth : month, hdr.logOffset)) {
+    return true; // Brak plików od miejsca, do którego indeks jest aktualny - nic do dopisania
+  }
+
+  DayIndexRecord rec;      // Rekord aktualnie uzupełnianego dnia (w pamięci aż do zmiany dnia)
+  bool haveRecord = false; // Czy rec zawiera dane jakiegoś dnia
+  bool ok = true;
+  CSVRow row;
+  while (ok && logReaderNext(log, row)) {
+    if (!isRowPlausible(row)) continue;
+    if (hdr.firstDay != INDEX_NO_DAY && row.day < hdr.firstDay) continue; // Wiersz sprzed początku indeksu
+
+    if (!haveRecord || rec.day != row.day) { // Nowy dzień - zapisz poprzedni i wczytaj bieżący
+      if (haveRecord) ok = writeDayRecord(idx, hdr, rec);
+      if (ok) ok = readDayRecord(idx, hdr, row.day, rec);
+      haveRecord = true;
+    }
+    addToDayRecord(rec, row.value, 1);
+  }
+  if (log.file) log.file.close(); // Odczyt przerwany błędem indeksu
+  if (ok && haveRecord) ok = writeDayRecord(idx, hdr, rec);
+  bool moved = hdr.logMonth != log.month || hdr.logOffset != log.endOffset;
+  hdr.logMonth = log.month; // Indeks obejmuje teraz wszystkie pliki do końca ostatnio przeczytanego
+  hdr.logOffset = log.endOffset;
+  return ok && (!moved || writeIndexHeader(idx, hdr));
+}
+
+// Funkcja budująca indeks od nowa na podstawie wszystkich plików CSV
+bool rebuildDayIndex() {
+  Serial.println(F("Przebudowa indeksu dni.idx..."));
+  SD.remove(INDEX_FILE); // Usuń stary (uszkodzony lub nieaktualny) indeks
+  File idx = SD.open(INDEX_FILE, FILE_UPDATE);
+  dayIndexReady = false;
+  if (idx) {
+    DayIndexHeader hdr = {{'S', 'I', 'D', 'X'}, INDEX_VERSION, sizeof(DayIndexRecord), INDEX_NO_DAY, 0, 0};
+    dayIndexReady = writeIndexHeader(idx, hdr) && indexLogFrom(idx, hdr);
+    idx.close();
+  }
+  Serial.println(dayIndexReady ? F("Indeks gotowy.") : F("Błąd budowy indeksu."));
+  return dayIndexReady;
+}
+
+// Funkcja sprawdzająca indeks przy starcie (i po każdej zapisanej paczce)
+// Brakujący lub uszkodzony indeks jest budowany od nowa, a poprawny - uzupełniany tylko o wiersze
+// dopisane do plików CSV po jego ostatniej aktualizacji.
+void checkDayIndex() {
+  dayIndexReady = false;
+  if (!sdReady) return; // Bez karty SD nie ma z czego budować indeksu
+
+  File idx = SD.open(INDEX_FILE, FILE_UPDATE);
+  if (!idx) return;
+  DayIndexHeader hdr;
+  if (readIndexHeader(idx, hdr) && logCursorValid(hdr.logMonth, hdr.logOffset)) {
+    dayIndexReady = indexLogFrom(idx, hdr);
+  }
+  idx.close();
+  if (!dayIndexReady) rebuildDayIndex(); // Indeks nie pasuje do plików CSV - zbuduj go od nowa
+}
+
+// --- Silnik agregacji wielu okien ---
+// Wszystkie okna przekazane do runAggregation() są wypełniane w jednym przejściu po danych:
+// albo po rekordach indeksu dni.idx (tylko dni potrzebne oknom), albo po wierszach plików CSV.
+// Ekrany ze średnimi są klientami tego silnika.
+
+// Funkcja zerująca wyniki okna (zakres dni pozostaje bez zmian)
+void aggResetWindow(AggWindow &w) {
+  w.count = 0;
+  w.daysWithData = 0;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    w.sum[ch] = 0;
+    w.minValue[ch] = 32767;
+    w.maxValue[ch] = -32768;
+    w.dailyMeanSum[ch] = 0;
+  }
+}
+
+// Funkcja przygotowująca okno obejmujące dayCount kolejnych dni, kończące się daysBack dni przed dniem today
+// Przykłady: dzisiaj (0, 1), wczoraj (1, 1), ostatnie 7 dni (0, 7), ostatnie 30 dni (0, 30)
+void aggWindowDays(AggWindow &w, uint16_t today, uint8_t daysBack, uint8_t dayCount) {
+  w.lastDay = today - daysBack;
+  w.firstDay = w.lastDay - (dayCount - 1);
+  aggResetWindow(w);
+}
+
+// Funkcja przygotowująca okno bieżącego miesiąca kalendarzowego (od 1. dnia miesiąca do dzisiaj)
+void aggWindowMonth(AggWindow &w, const DateTime &now) {
+  w.firstDay = dayNumber(DateTime(now.year(), now.month(), 1));
+  w.lastDay = dayNumber(now);
+  aggResetWindow(w);
+}
+
+// Funkcja przygotowująca profil dobowy z dayCount ostatnich dni (łącznie z dzisiejszym)
+void hourProfileInit(HourProfile &p, uint16_t today, uint8_t dayCount) {
+  p.lastDay = today;
+  p.firstDay = today - (dayCount - 1);
+  for (uint8_t h = 0; h < 24; h++) {
+    p.count[h] = 0;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) p.sum[h][ch] = 0;
+  }
+}
+
+// Funkcja dodająca pomiar do profilu dobowego (jeśli profil istnieje i obejmuje dzień pomiaru)
+// weight: liczba pomiarów, które reprezentują wartości (jak w addToDayRecord())
+void hourProfileAdd(HourProfile *profile, uint16_t day, uint8_t hour, const int16_t values[CHANNEL_COUNT],
+                    uint8_t weight) {
+  if (!profile || day < profile->firstDay || day > profile->lastDay || hour > 23) return;
+  profile->count[hour] += weight;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) profile->sum[hour][ch] += (int32_t)values[ch] * weight;
+}
+
+// Funkcja dodająca zagregowany dzień (rekord dzienny) do wszystkich okien, które go obejmują
+void aggAddDay(AggWindow *windows, uint8_t windowCount, const DayIndexRecord &rec) {
+  DayIndexRecord merged;
+  const DayIndexRecord *day = &rec;
+  for (uint8_t i = 0; aggPending && i < aggPending->dayCount; i++) {
+    if (aggPending->added[i] || aggPending->days[i].day != rec.day) continue;
+    merged = rec; // Wiersze paczki zapisu należą do tego samego dnia - średnia dzienna obejmuje oba źródła
+    mergeDayRecord(merged, aggPending->days[i]);
+    aggPending->added[i] = true;
+    day = &merged;
+  }
+  if (day->count == 0) return; // Dzień bez pomiarów nie zmienia wyników
+  for (uint8_t i = 0; i < windowCount; i++) {
+    AggWindow &w = windows[i];
+    if (day->day < w.firstDay || day->day > w.lastDay) continue; // Dzień poza oknem
+    w.count += day->count;
+    w.daysWithData++;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+      w.sum[ch] += day->sum[ch];
+      if (day->minValue[ch] < w.minValue[ch]) w.minValue[ch] = day->minValue[ch];
+      if (day->maxValue[ch] > w.maxValue[ch]) w.maxValue[ch] = day->maxValue[ch];
+      w.dailyMeanSum[ch] += (float)day->sum[ch] / day->count / channelScale(ch);
+    }
+  }
+}
+
+// Funkcja zbierająca wiersze paczki zapisu (jeszcze nie na karcie) w rekordy dzienne
+// Wiersze trafiają od razu do profilu dobowego, a rekordy dzienne dołącza aggAddDay() albo aggAddPending().
+// profile: profil dobowy do uzupełnienia lub NULL
+void loadAggPending(AggPending &pending, HourProfile *profile) {
+  pending.dayCount = 0;
+  uint16_t pos = 0;
+  CSVRow row;
+  while (nextLogBufferRow(pos, logBufferLength, row)) {
+    uint8_t i = 0;
+    while (i < pending.dayCount && pending.days[i].day != row.day) i++;
+    if (i == pending.dayCount) {
+      if (i == 2) continue; // Więcej dni niż mieści paczka - nie powinno się zdarzyć
+      clearDayRecord(pending.days[i], row.day);
+      pending.added[i] = false;
+      pending.dayCount++;
+    }
+    addToDayRecord(pending.days[i], row.value, 1);
+    hourProfileAdd(profile, row.day, row.hour, row.value, 1);
+  }
+}
+
+// Funkcja dokładająca do okien dni z paczki zapisu, których nie było na karcie, i kończąca dołączanie paczki
+void aggAddPending(AggWindow *windows, uint8_t windowCount) {
+  AggPending *pending = aggPending;
+  aggPending = NULL;
+  for (uint8_t i = 0; i < pending->dayCount; i++) {
+    if (!pending->added[i]) aggAddDay(windows, windowCount, pending->days[i]);
+  }
+}
+
+// Funkcja wyznaczająca łączny zakres dni wszystkich okien (i profilu, jeśli podano)
+void aggDayRange(const AggWindow *windows, uint8_t windowCount, const HourProfile *profile,
+                 uint16_t &fromDay, uint16_t &toDay) {
+  fromDay = 0xFFFF;
+  toDay = 0;
+  for (uint8_t i = 0; i < windowCount; i++) {
+    if (windows[i].firstDay < fromDay) fromDay = windows[i].firstDay;
+    if (windows[i].lastDay > toDay) toDay = windows[i].lastDay;
+  }
+  if (profile) {
+    if (profile->firstDay < fromDay) fromDay = profile->firstDay;
+    if (profile->lastDay > toDay) toDay = profile->lastDay;
+  }
+}
+
+// Funkcja wypełniająca okna na podstawie indeksu dni.idx
+// Czyta jednym ciągiem tylko rekordy dni należących do okien. Zwraca false, jeśli indeks jest uszkodzony.
+bool aggregateFromIndex(AggWindow *windows, uint8_t windowCount) {
+  uint16_t fromDay, toDay;
+  aggDayRange(windows, windowCount, NULL, fromDay, toDay);
+
+  File idx = SD.open(INDEX_FILE);
+  DayIndexHeader hdr;
+  bool ok = idx && readIndexHeader(idx, hdr);
+  if (ok && hdr.firstDay != INDEX_NO_DAY) {
+    uint32_t recordCount = (idx.size() - sizeof(DayIndexHeader)) / sizeof(DayIndexRecord);
+    uint32_t first = fromDay > hdr.firstDay ? fromDay - hdr.firstDay : 0; // Pierwszy potrzebny rekord
+    uint32_t last = toDay >= hdr.firstDay ? toDay - hdr.firstDay : 0;     // Ostatni potrzebny rekord
+    if (toDay >= hdr.firstDay && first < recordCount) {
+      if (last >= recordCount) last = recordCount - 1;
+      idx.seek(sizeof(DayIndexHeader) + first * sizeof(DayIndexRecord));
+      DayIndexRecord rec;
+      for (uint32_t slot = first; ok && slot <= last; slot++) { // Rekordy leżą po kolei - bez dodatkowych przesunięć
+        ok = idx.read(&rec, sizeof(rec)) == sizeof(rec) && rec.day == hdr.firstDay + slot &&
+             rec.checksum == dayRecordChecksum(rec);
+        if (ok) aggAddDay(windows, windowCount, rec);
+      }
+    }
+  }
+  if (idx) idx.close();
+  if (!ok) dayIndexReady = false; // Indeks uszkodzony - przy następnym użyciu zostanie przebudowany
+  return ok;
+}
+
+// Funkcja wypełniająca okna (i opcjonalnie profil dobowy) w jednym przejściu po plikach CSV
+// Czytane są tylko pliki miesięcy, które obejmuje łączny zakres dni okien.
+// Wiersze kolejnych dni są sumowane do rekordu dziennego, który po zmianie dnia trafia do wszystkich okien.
+void aggregateFromCSV(AggWindow *windows, uint8_t windowCount, HourProfile *profile) {
+  uint16_t fromDay, toDay;
+  aggDayRange(windows, windowCount, profile, fromDay, toDay);
+  if (fromDay > toDay) return; // Brak okien
+
+  LogReader log; // Otwórz pliki miesięcy z zakresu dni do odczytu
+  if (!logReaderOpen(log, dayToMonth(fromDay), dayToMonth(toDay), 0)) return;
+
+  unsigned long start = micros();
+  DayIndexRecord rec;      // Suma pomiarów bieżącego dnia
+  bool haveRecord = false; // Czy rec zawiera dane jakiegoś dnia
+  CSVRow row;
+  while (logReaderNext(log, row)) { // Kolejne wiersze pomiarów z plików (czytnik zamyka ostatni plik)
+    if (row.day < fromDay || row.day > toDay) continue; // Wiersz spoza wszystkich okien
+
+    // Dodatkowe sprawdzenie, czy odczytane wartości nie są absurdalne
+    // (np. bardzo duże liczby z powodu błędnego parsowania lub uszkodzenia danych)
+    if (!isRowPlausible(row)) {
+      Serial.print(F("Ostrzeżenie: pominięto niepoprawne dane z pliku SD: "));
+      Serial.println(csvFileLine); // Wypisz ostrzeżenie o pominiętej linii
+      continue;
+    }
+
+    if (!haveRecord || rec.day != row.day) { // Nowy dzień - przekaż poprzedni do okien
+      if (haveRecord) aggAddDay(windows, windowCount, rec);
+      clearDayRecord(rec, row.day);
+      haveRecord = true;
+    }
+    addToDayRecord(rec, row.value, 1);
+    hourProfileAdd(profile, row.day, row.hour, row.value, 1);
+  }
+  if (haveRecord) aggAddDay(windows, windowCount, rec); // Ostatni dzień z plików
+  probeRecord(PROBE_CSV, micros() - start);
+  printSkippedLines(log.csv);
+}
+
+// Główna funkcja silnika: wypełnia wszystkie okna (i opcjonalnie profil dobowy) w jednym przejściu po danych
+// Najpierw próbuje bufora ostatnich pomiarów w RAM. Jeśli okna sięgają dalej, bez profilu dobowego dane
+// pochodzą z indeksu dni.idx, a z profilem - z dziennika binarnego dane.bin; pliki CSV są czytane
+// tylko wtedy, gdy żadne z nich nie jest dostępne. Wiersze czekające w paczce zapisu są dokładane w RAM,
+// więc agregacja nie wymusza zapisu niepełnego sektora.
+// profile: profil dobowy do wypełnienia lub NULL
+void runAggregation(AggWindow *windows, uint8_t windowCount, HourProfile *profile) {
+  if (aggregateFromRing(windows, windowCount, profile)) return; // Wszystkie okna w buforze RAM - bez karty SD
+  AggPending pending;
+  aggPending = &pending;
+  loadAggPending(pending, profile);
+  if (profile == NULL) {
+    if (!dayIndexReady) rebuildDayIndex(); // Spróbuj odtworzyć brakujący lub uszkodzony indeks
+    if (dayIndexReady && aggregateFromIndex(windows, windowCount)) {
+      aggAddPending(windows, windowCount);
+      return;
+    }
+    for (uint8_t i = 0; i < windowCount; i++) aggResetWindow(windows[i]); // Odrzuć częściowe wyniki z indeksu
+    loadAggPending(pending, profile);
+  }
+#if BINARY_LOG
+  if (binLogReady && aggregateFromBinaryLog(windows, windowCount, profile)) { // Tylko rekordy potrzebnych dni
+    aggAddPending(windows, windowCount);
+    return;
+  }
+  for (uint8_t i = 0; i < windowCount; i++) aggResetWindow(windows[i]); // Odrzuć częściowe wyniki z dziennika
+  if (profile) hourProfileInit(*profile, profile->lastDay, profile->lastDay - profile->firstDay + 1);
+  loadAggPending(pending, profile);
+#endif
+  aggregateFromCSV(windows, windowCount, profile); // Jedno przejście po plikach miesięcy z zakresu okien
+  aggAddPending(windows, windowCount);
+}
+
+// Funkcja zwracająca średnią ważoną okna: każdy pomiar ma tę samą wagę
+SensorData aggWindowMean(const AggWindow &w) {
+  SensorData avg = noReading(0); // Brak pomiarów - wartości NaN i isValid = false
+  if (w.count > 0) {
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) avg.value[ch] = (float)w.sum[ch] / w.count / channelScale(ch);
+    avg.isValid = true;
+  }
+  return avg;
+}
+
+// Funkcja zwracająca średnią ze średnich dziennych okna: każdy dzień z pomiarami ma tę samą wagę
+SensorData aggWindowDailyMean(const AggWindow &w) {
+  SensorData avg = noReading(0);
+  if (w.daysWithData > 0) {
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) avg.value[ch] = w.dailyMeanSum[ch] / w.daysWithData;
+    avg.isValid = true;
+  }
+  return avg;
+}
+
+// Funkcja zwracająca średnie wartości profilu dobowego dla podanej godziny (0-23)
+SensorData hourProfileMean(const HourProfile &p, uint8_t hour) {
+  SensorData avg = noReading(0);
+  if (hour < 24 && p.count[hour] > 0) {
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+      avg.value[ch] = (float)p.sum[hour][ch] / p.count[hour] / channelScale(ch);
+    }
+    avg.isValid = true;
+  }
+  return avg;
+}
+
+// --- Bufor pierścieniowy ostatnich pomiarów (RAM) ---
+
+// Funkcja dodająca pomiar do bufora
+// Pomiar z tej samej godziny co najnowsza pozycja bufora jest wliczany do jej średniej; pomiar z nowej godziny
+// zajmuje nową pozycję, a przy pełnym buforze nadpisywana jest najstarsza godzina.
+void ringPush(uint16_t day, uint8_t hour, const int16_t values[CHANNEL_COUNT]) {
+  if (ringCount > 0) {
+    HourSample &last = hourRing[(ringHead + RING_SIZE - 1) % RING_SIZE];
+    if (last.day == day && last.hour == hour && last.count < 255) {
+      last.count++;
+      for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+        ringHourSum[ch] += values[ch];
+        last.value[ch] = lround((float)ringHourSum[ch] / last.count);
+      }
+      return;
+    }
+  }
+
+  HourSample &slot = hourRing[ringHead];
+  if (ringCount == RING_SIZE) { // Bufor pełny - najstarsza godzina wypada z bufora
+    ringEvictedDay = slot.day;
+    ringComplete = false;
+  } else {
+    ringCount++;
+  }
+  slot.day = day;
+  slot.hour = hour;
+  slot.count = 1;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    slot.value[ch] = values[ch];
+    ringHourSum[ch] = values[ch];
+  }
+  ringHead = (ringHead + 1) % RING_SIZE;
+}
+
+// Funkcja zwracająca i-tą godzinę z bufora, licząc od najstarszej (0 = najstarsza)
+const HourSample &ringAt(uint8_t i) {
+  return hourRing[(ringHead + RING_SIZE - ringCount + i) % RING_SIZE];
+}
+
+// Funkcja dodająca do bufora wszystkie poprawne pomiary z pliku czytnika, od bieżącego miejsca do końca pliku
+void ringPushRows(CSVReader &in) {
+  CSVRow row;
+  while (readCSVRow(in, row)) {
+    if (!isRowPlausible(row)) continue;
+    ringPush(row.day, row.hour, row.value);
+  }
+}
+
+// Funkcja wypełniająca bufor ostatnimi pomiarami z plików CSV (wywoływana w setup())
+// Czyta tylko końcówkę danych: plik najnowszego miesiąca i plik miesiąca poprzedniego są traktowane jak jeden ciąg
+// (7 dni bufora sięga najwyżej do poprzedniego miesiąca). Odczyt zaczyna się około RING_SIZE godzin pomiarów
+// od końca i cofa się dalej tylko wtedy, gdy w przeczytanym fragmencie jest za mało godzin, żeby wypełnić bufor.
+void loadRingFromCSV() {
+  ringHead = 0;
+  ringCount = 0;
+  ringComplete = true;
+  if (!sdReady) { // Bez karty nie wiadomo, co jest w historii - bufor obejmuje tylko dni od teraz
+    ringComplete = false;
+    ringEvictedDay = clockDay();
+    return;
+  }
+  uint16_t lastMonth = findPartition(dayToMonth(clockDay()), 0, -1); // Najnowszy plik miesiąca
+  if (lastMonth == LOG_NO_MONTH) return; // Brak plików - brak historii, bufor jest kompletny
+  char path[LOG_PATH_LEN];
+  File file = SD.open(partitionPath(path, lastMonth)); // Otwórz plik danych CSV do odczytu
+  if (!file) return;
+  uint16_t prevMonth = lastMonth > 0 ? findPartition(lastMonth - 1, 0, -1) : LOG_NO_MONTH;
+  File prevFile; // Plik poprzedniego miesiąca (jeśli istnieje)
+  if (prevMonth != LOG_NO_MONTH) prevFile = SD.open(partitionPath(path, prevMonth));
+  uint32_t prevSize = prevFile ? prevFile.size() : 0;
+
+  // Wczytanie pomiarów od miejsca, od którego do końca danych jest co najmniej RING_SIZE godzin pomiarów
+  // (nadmiarowe najstarsze godziny wypadają z bufora przy dodawaniu kolejnych). Pierwsza próba zakłada jeden
+  // wiersz na godzinę; przy częstszym zapisie liczba bajtów na godzinę jest szacowana z przeczytanego fragmentu
+  // (z zapasem 1/8), więc zwykle wystarcza jedna dodatkowa próba.
+  uint32_t size = prevSize + file.size(); // Miejsca liczone od początku pliku poprzedniego miesiąca
+  uint32_t back = (uint32_t)RING_SIZE * RING_LINE_ESTIMATE; // Ile bajtów od końca czytać
+  uint32_t start;
+  unsigned long startMicros = micros();
+  for (;;) {
+    start = size > back ? size - back : 0;
+    ringHead = 0;
+    ringCount = 0;
+    CSVReader in;
+    if (start < prevSize) { // Fragment zaczyna się w pliku poprzedniego miesiąca
+      csvReaderStart(in, prevFile, start);
+      ringPushRows(in);
+      csvReaderStart(in, file, 0);
+    } else {
+      csvReaderStart(in, file, start - prevSize);
+    }
+    ringPushRows(in);
+    if (ringCount == RING_SIZE || start == 0) break;
+    // Bufor nie zapełnił się, więc nic z niego nie wypadło - za mało godzin we fragmencie, cofnij się dalej
+    // (najstarsza godzina fragmentu jest zwykle niepełna, więc nie jest liczona do szacunku)
+    back = ringCount > 1 ? back / (ringCount - 1) * (RING_SIZE + RING_SIZE / 8) : back * 2;
+  }
+  probeRecord(PROBE_CSV, micros() - startMicros);
+  file.close();
+  if (prevFile) prevFile.close();
+
+  // Fragment nie sięga początku danych - najstarszy dzień w buforze może być niepełny
+  bool olderData = start > 0 || (prevMonth != LOG_NO_MONTH && prevMonth > 0 &&
+                                 findPartition(prevMonth - 1, 0, -1) != LOG_NO_MONTH);
+  if (olderData && ringComplete) {
+    ringComplete = false;
+    ringEvictedDay = ringCount > 0 ? ringAt(0).day : clockDay();
+  }
+  Serial.print(F("Bufor ostatnich pomiarów: ")); Serial.print(ringCount); Serial.println(F(" godzin."));
+}
+
+// Funkcja wypełniająca okna (i opcjonalnie profil dobowy) z bufora w pamięci RAM
+// Zwraca false, jeśli bufor nie obejmuje w całości wszystkich dni potrzebnych oknom.
+bool aggregateFromRing(AggWindow *windows, uint8_t windowCount, HourProfile *profile) {
+  uint16_t fromDay, toDay;
+  aggDayRange(windows, windowCount, profile, fromDay, toDay);
+  if (!ringComplete && ringEvictedDay >= fromDay) return false; // Część dni wypadła już z bufora
+
+  DayIndexRecord rec;      // Suma pomiarów bieżącego dnia
+  bool haveRecord = false;
+  for (uint8_t i = 0; i < ringCount; i++) { // Od najstarszego do najnowszego pomiaru
+    const HourSample &sample = ringAt(i);
+    if (sample.day < fromDay || sample.day > toDay) continue;
+    if (!haveRecord || rec.day != sample.day) { // Nowy dzień - przekaż poprzedni do okien
+      if (haveRecord) aggAddDay(windows, windowCount, rec);
+      clearDayRecord(rec, sample.day);
+      haveRecord = true;
+    }
+    addToDayRecord(rec, sample.value, sample.count);
+    hourProfileAdd(profile, sample.day, sample.hour, sample.value, sample.count);
+  }
+  if (haveRecord) aggAddDay(windows, windowCount, rec);
+  return true;
+}
+
+// --- Statystyki bieżące i wielkości pochodne ---
+
+// Funkcja zerująca statystyki kanału
+void statsReset(ChannelStats &s) {
+  s.count = 0;
+  s.mean = 0;
+  s.m2 = 0;
+  s.minValue = NAN;
+  s.maxValue = NAN;
+  s.minTime = 0;
+  s.maxTime = 0;
+}
+
+// Funkcja dodająca pomiar do statystyk kanału (metoda Welforda: średnia i suma kwadratów odchyleń
+// są poprawiane o każdy nowy pomiar, więc nie trzeba pamiętać wcześniejszych pomiarów)
+void statsAdd(ChannelStats &s, float value, uint32_t time) {
+  if (s.count == 0 || value < s.minValue) {
+    s.minValue = value;
+    s.minTime = time;
+  }
+  if (s.count == 0 || value > s.maxValue) {
+    s.maxValue = value;
+    s.maxTime = time;
+  }
+  if (s.count == 0xFFFF) return; // Licznik pełny - średnia i wariancja zostają bez zmian
+  s.count++;
+  float delta = value - s.mean;   // Odchylenie od średniej sprzed pomiaru
+  s.mean += delta / s.count;
+  s.m2 += delta * (value - s.mean); // Iloczyn odchyleń od starej i nowej średniej
+}
+
+// Funkcja zwracająca odchylenie standardowe z próby (NaN, jeśli pomiarów jest mniej niż 2)
+float statsStdDev(const ChannelStats &s) {
+  if (s.count < 2) return NAN;
+  return sqrt(s.m2 / (s.count - 1));
+}
+
+// Funkcja dodająca odczyt czujnika do statystyk dnia (wywoływana przy każdym odczycie czujnika)
+// Pierwszy odczyt nowego dnia zeruje statystyki poprzedniego.
+void updateStats(const SensorData &reading) {
+  if (!isReadingPlausible(reading)) return;
+  uint16_t day = reading.time / 86400UL;
+  if (day != statsDay || dayStats[CH_TEMPERATURE].count == 0) {
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) statsReset(dayStats[ch]);
+    statsDay = day;
+    statsStart = reading.time;
+  }
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) statsAdd(dayStats[ch], reading.value[ch], reading.time);
+}
+
+// Funkcja zwracająca temperaturę punktu rosy w stopniach Celsjusza (wzór Magnusa, stałe wg Sonntaga:
+// błąd poniżej 0,1 C dla temperatur od -45 do 60 C); NaN dla wilgotności 0 %
+float dewPoint(float temp, float hum) {
+  if (!(hum > 0)) return NAN;
+  float gamma = log(hum / 100.0F) + 17.62F * temp / (243.12F + temp);
+  return 243.12F * gamma / (17.62F - gamma);
+}
+
+// Funkcja zwracająca temperaturę odczuwalną (wskaźnik ciepła NOAA) w stopniach Celsjusza
+// Poniżej około 27 C wskaźnik liczony jest prostym wzorem Steadmana i jest bliski temperaturze powietrza;
+// powyżej - regresją Rothfusza z poprawkami dla bardzo suchego i bardzo wilgotnego powietrza.
+float heatIndex(float temp, float hum) {
+  float t = temp * 1.8F + 32; // Wzory NOAA są podane dla stopni Fahrenheita
+  float hi = 0.5F * (t + 61.0F + (t - 68.0F) * 1.2F + hum * 0.094F);
+  if ((hi + t) / 2 >= 80) {
+    hi = -42.379F + 2.04901523F * t + 10.14333127F * hum - 0.22475541F * t * hum - 0.00683783F * t * t -
+         0.05481717F * hum * hum + 0.00122874F * t * t * hum + 0.00085282F * t * hum * hum -
+         0.00000199F * t * t * hum * hum;
+    if (hum < 13 && t >= 80 && t <= 112) hi -= (13 - hum) / 4 * sqrt((17 - fabs(t - 95)) / 17);
+    else if (hum > 85 && t >= 80 && t <= 87) hi += (hum - 85) / 10 * (87 - t) / 5;
+  }
+  return (hi - 32) / 1.8F;
+}
+
+// Funkcja zwracająca tendencję baryczną: zmianę ciśnienia w ciągu PRESSURE_TENDENCY_H godzin w hPa
+// Porównuje średnią najnowszej godziny w buforze pierścieniowym ze średnią godziny o PRESSURE_TENDENCY_H
+// wcześniejszej, więc nie sięga do karty SD. Zwraca NaN, jeśli którejś z tych godzin nie ma w buforze
+// (np. przerwa w pomiarach) albo najnowsza godzina w buforze nie jest bieżącą ani poprzednią godziną.
+// now: czas bieżącego pomiaru (sekundy od 2000-01-01)
+float pressureTendency(uint32_t now) {
+  if (ringCount == 0) return NAN;
+  const HourSample &last = ringAt(ringCount - 1);
+  uint32_t lastHour = (uint32_t)last.day * 24 + last.hour; // Godziny od 2000-01-01
+  if (now / 3600 > lastHour + 1) return NAN; // Bufor nie jest aktualny
+  uint32_t target = lastHour - PRESSURE_TENDENCY_H;
+  for (uint8_t i = ringCount - 1; i-- > 0;) { // Od przedostatniej godziny wstecz
+    const HourSample &sample = ringAt(i);
+    uint32_t hour = (uint32_t)sample.day * 24 + sample.hour;
+    if (hour == target) {
+      return (float)(last.value[CH_PRESSURE] - sample.value[CH_PRESSURE]) / channelScale(CH_PRESSURE);
+    }
+    if (hour < target) break; // Godziny target nie ma w buforze
+  }
+  return NAN;
+}
+
+// --- Przedziały wykresu historii (plik wykres.bin) ---
+// Rekord przedziału n zakresu r leży pod adresem sizeof(GraphHeader) + (r * GRAPH_COLUMNS + n % GRAPH_COLUMNS)
+// * sizeof(GraphBucket). Ostatni zakres (30 dni) ma najdłuższe przedziały.
+
+// Funkcja przygotowująca pusty przedział o podanym numerze
+void graphResetBucket(GraphBucket &b, uint32_t number) {
+  b.number = number;
+  b.count = 0;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    b.sum[ch] = 0;
+    b.minValue[ch] = INT16_MAX;
+    b.maxValue[ch] = INT16_MIN;
+  }
+}
+
+// Funkcja odczytująca i sprawdzająca nagłówek pliku przedziałów
+// Zwraca false, jeśli plik nie jest poprawnym plikiem przedziałów w bieżącej wersji formatu
+bool readGraphHeader(File &f, GraphHeader &hdr) {
+  f.seek(0);
+  if (f.read(&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+  if (memcmp_P(hdr.magic, PSTR("SGRF"), 4) != 0 || hdr.version != GRAPH_VERSION ||
+      hdr.recordSize != sizeof(GraphBucket) || hdr.columns != GRAPH_COLUMNS) {
+    return false;
+  }
+  // Plik ma stały rozmiar - inny oznacza przerwane tworzenie pliku
+  return f.size() == sizeof(hdr) + (uint32_t)GRAPH_RANGES * GRAPH_COLUMNS * sizeof(GraphBucket);
+}
+
+// Funkcja zapisująca nagłówek na początku pliku przedziałów
+bool writeGraphHeader(File &f, const GraphHeader &hdr) {
+  f.seek(0);
+  return f.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+}
+
+// Funkcja ustawiająca plik na rekordzie przedziału number zakresu range
+void seekGraphBucket(File &f, uint8_t range, uint32_t number) {
+  f.seek(sizeof(GraphHeader) + ((uint32_t)range * GRAPH_COLUMNS + number % GRAPH_COLUMNS) * sizeof(GraphBucket));
+}
+
+// Funkcja odczytująca z pliku przedział number zakresu range
+// Zwraca false (i pusty przedział w b), jeśli w miejscu przedziału leży inny przedział (starszy, bez pomiarów
+// albo sprzed przestawienia zegara) lub odczyt się nie powiódł.
+bool readGraphBucket(File &f, uint8_t range, uint32_t number, GraphBucket &b) {
+  seekGraphBucket(f, range, number);
+  if (f.read(&b, sizeof(b)) == sizeof(b) && b.number == number && b.count > 0) return true;
+  graphResetBucket(b, number);
+  return false;
+}
+
+// Funkcja zapisująca zamknięty przedział do pliku
+bool writeGraphBucket(File &f, uint8_t range, const GraphBucket &b) {
+  seekGraphBucket(f, range, b.number);
+  return f.write((const uint8_t *)&b, sizeof(b)) == sizeof(b);
+}
+
+// Funkcja dodająca pomiar do otwartych przedziałów wszystkich zakresów
+// Przedział, do którego pomiar już nie należy, jest zamykany - zapisywany do pliku f (jeśli jest otwarty)
+// i zastępowany nowym. Pusty przedział z numerem (ustawiony przy starcie) oznacza, że wcześniejsze pomiary są już
+// w pliku, więc pomiary sprzed niego są pomijane. Zwraca maskę bitową zakresów, w których zamknięto przedział.
+uint8_t graphPush(File &f, uint32_t time, const int16_t values[CHANNEL_COUNT]) {
+  uint8_t closed = 0;
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) {
+    GraphBucket &b = graphOpen[r];
+    uint32_t number = time / GRAPH_BUCKET_S[r];
+    if (b.count == 0 && b.number != GRAPH_NO_BUCKET && number < b.number) continue; // Pomiar jest już w pliku
+    if (number != b.number) {
+      if (b.count > 0) {
+        closed |= 1 << r;
+        if (f && !writeGraphBucket(f, r, b)) graphReady = false;
+      }
+      graphResetBucket(b, number);
+    }
+    graphBucketAdd(b, values);
+  }
+  return closed;
+}
+
+// Funkcja dodająca pomiar do przedziału (suma, minimum i maksimum każdego kanału)
+void graphBucketAdd(GraphBucket &b, const int16_t values[CHANNEL_COUNT]) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    int16_t v = values[ch];
+    b.sum[ch] += v;
+    if (v < b.minValue[ch]) b.minValue[ch] = v;
+    if (v > b.maxValue[ch]) b.maxValue[ch] = v;
+  }
+  b.count++;
+}
+
+// Funkcja składająca przedział wykresu z pomiarów czekających w kolejce EEPROM (wykres bez pliku wykres.bin)
+// Kolejka jest ułożona według czasu, a kolumny są rysowane od najstarszej, więc kolejne wywołania czytają kolejkę
+// dalej od graphQueueNext - każdy rekord raz na cały wykres.
+void queueBucket(uint8_t range, uint32_t number, GraphBucket &b) {
+  graphResetBucket(b, number);
+  QueueSlot s;
+  for (; graphQueueNext < queueCount; graphQueueNext++) {
+    if (!queueReadSlot(queuePending(graphQueueNext), s)) continue;
+    uint32_t n = s.time / GRAPH_BUCKET_S[range];
+    if (n > number) break; // Rekord następnej kolumny
+    if (n < number) continue;
+    int16_t values[CHANNEL_COUNT];
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = s.value[ch]; // Kopia spoza spakowanej struktury
+    graphBucketAdd(b, values);
+  }
+}
+
+// Funkcja przepisująca do nagłówka początki otwartych przedziałów (po zapisaniu zamkniętych przedziałów)
+void graphSyncHeader(GraphHeader &hdr) {
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) {
+    const GraphBucket &b = graphOpen[r];
+    if (b.count > 0) hdr.syncTime[r] = b.number * GRAPH_BUCKET_S[r];
+  }
+}
+
+// Funkcja dodająca zapisywany pomiar do przedziałów wykresu (wywoływana przy każdym zapisie pomiaru)
+// Plik jest otwierany tylko wtedy, gdy pomiar zamyka przedział (co GRAPH_BUCKET_S[0] sekund). Zamknięcie przedziału
+// wyświetlanego zakresu odświeża ekran wykresu - wykres przesuwa się o kolumnę.
+void graphAddSample(uint32_t time, const int16_t values[CHANNEL_COUNT]) {
+  bool closing = false;
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) {
+    if (graphOpen[r].count > 0 && graphOpen[r].number != time / GRAPH_BUCKET_S[r]) closing = true;
+  }
+  File f;
+  if (closing && graphReady) {
+    f = SD.open(GRAPH_FILE, FILE_UPDATE);
+    if (!f) graphReady = false; // Karta wyjęta - plik zostanie uzupełniony przy następnym starcie
+  }
+  uint8_t closed = graphPush(f, time, values);
+  if (f) {
+    GraphHeader hdr;
+    if (graphReady) graphReady = readGraphHeader(f, hdr);
+    if (graphReady) {
+      graphSyncHeader(hdr);
+      graphReady = writeGraphHeader(f, hdr);
+    }
+    f.close();
+  }
+  if (screenKind(screenIndex) == SCREEN_GRAPH && (closed & (1 << (graphView % GRAPH_RANGES)))) displayDirty = true;
+}
+
+// Funkcja odtwarzająca przedziały z pomiarów od czasu from: z dziennika dane.bin (pierwszy rekord znajduje
+// wyszukiwanie binarne) albo z plików CSV. Zwraca false przy błędzie zapisu pliku przedziałów.
+bool graphReplay(File &f, uint32_t from) {
+#if BINARY_LOG
+  if (binLogReady) {
+    File bin = SD.open(BINLOG_FILE);
+    BinLogHeader hdr;
+    bool ok = bin && readBinLogHeader(bin, hdr);
+    if (ok) {
+      uint32_t slot = binLogFindDay(bin, hdr, from / 86400UL);
+      BinLogCursor c;
+      ok = slot != 0xFFFFFFFF && (slot >= hdr.recordCount || binLogSeek(bin, c, slot, BINLOG_ALL_CHANNELS));
+      for (; ok && slot < hdr.recordCount; slot++) {
+        ok = binLogNext(bin, c);
+        if (!ok || c.row.time < from) continue; // Początek dnia sprzed czasu from
+        int16_t values[CHANNEL_COUNT];
+        for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = c.row.value[ch]; // Kopia spoza spakowanej struktury
+        graphPush(f, c.row.time, values);
+      }
+    }
+    if (bin) bin.close();
+    if (ok) return graphReady;
+    binLogReady = false; // Dziennik uszkodzony - przedziały z plików CSV
+  }
+#endif
+  LogReader log;
+  if (!logReaderOpen(log, dayToMonth(from / 86400UL), dayToMonth(clockDay()), 0)) return graphReady;
+  CSVRow row;
+  while (logReaderNext(log, row)) {
+    uint32_t time = (uint32_t)row.day * 86400UL + row.hour * 3600UL + row.minute * 60 + row.second;
+    if (time >= from && isRowPlausible(row)) graphPush(f, time, row.value);
+  }
+  return graphReady;
+}
+
+// Funkcja tworząca pusty plik przedziałów (wszystkie rekordy bez pomiarów)
+bool rebuildGraph() {
+  Serial.println(F("Tworzenie pliku wykres.bin..."));
+  SD.remove(GRAPH_FILE); // Usuń stary (uszkodzony lub w innej wersji formatu) plik
+  File f = SD.open(GRAPH_FILE, FILE_UPDATE);
+  if (!f) return false;
+  GraphHeader hdr = {{'S', 'G', 'R', 'F'}, GRAPH_VERSION, sizeof(GraphBucket), GRAPH_COLUMNS, {0}};
+  GraphBucket empty;
+  graphResetBucket(empty, GRAPH_NO_BUCKET);
+  bool ok = writeGraphHeader(f, hdr);
+  for (uint16_t i = 0; ok && i < GRAPH_RANGES * GRAPH_COLUMNS; i++) {
+    ok = f.write((const uint8_t *)&empty, sizeof(empty)) == sizeof(empty);
+  }
+  f.close();
+  return ok;
+}
+
+// Funkcja przygotowująca przedziały wykresu przy starcie (po sprawdzeniu dziennika binarnego)
+// Brakujący lub uszkodzony plik jest tworzony od nowa, a potem z dziennika odtwarzane są pomiary, których nie ma
+// jeszcze w zamkniętych przedziałach - najwyżej z okresu widocznego na wykresach (30 dni).
+void checkGraph() {
+  graphReady = false;
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) graphResetBucket(graphOpen[r], GRAPH_NO_BUCKET);
+  if (!sdReady) return; // Bez karty SD wykres pokaże tylko bieżące przedziały
+
+  File f = SD.open(GRAPH_FILE, FILE_UPDATE);
+  if (!f) return;
+  GraphHeader hdr;
+  if (!readGraphHeader(f, hdr)) {
+    f.close();
+    if (!rebuildGraph()) return;
+    f = SD.open(GRAPH_FILE, FILE_UPDATE);
+    if (!f) return;
+    if (!readGraphHeader(f, hdr)) {
+      f.close();
+      return;
+    }
+  }
+
+  // Pierwszy pomiar do odtworzenia dla każdego zakresu: początek otwartego przedziału z nagłówka, ale nie
+  // wcześniej niż początek najstarszej kolumny wykresu
+  uint32_t now = clockSeconds();
+  uint32_t from = now;
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) {
+    uint32_t first = now / GRAPH_BUCKET_S[r];
+    first = first >= GRAPH_COLUMNS ? (first - (GRAPH_COLUMNS - 1)) * GRAPH_BUCKET_S[r] : 0;
+    if (hdr.syncTime[r] > first) first = hdr.syncTime[r];
+    graphOpen[r].number = first / GRAPH_BUCKET_S[r]; // Pusty przedział z numerem - wcześniejsze pomiary są pomijane
+    if (first < from) from = first;
+  }
+  graphReady = true;
+  graphReady = graphReplay(f, from);
+  for (uint8_t r = 0; r < GRAPH_RANGES; r++) {
+    if (graphOpen[r].count == 0) graphOpen[r].number = GRAPH_NO_BUCKET; // Brak pomiarów - bez pomijania
+  }
+  if (graphReady) {
+    graphSyncHeader(hdr);
+    graphReady = writeGraphHeader(f, hdr);
+  }
+  f.close();
+  if (!graphReady) Serial.println(F("Błąd pliku wykres.bin - wykres bez historii."));
+}
+
+// --- Binarny dziennik pomiarów (plik dane.bin) ---
+// Blok numer b leży pod adresem SD_SECTOR * (1 + b), a obszar kolumny c - za nagłówkiem bloku, w odległości
+// sizeof(BinLogBlock) + c * BINLOG_REGION od początku bloku.
+
+// Funkcja odczytująca i sprawdzająca nagłówek dziennika binarnego
+// Zwraca false, jeśli plik nie jest poprawnym dziennikiem w bieżącej wersji formatu i z bieżącymi kanałami
+bool readBinLogHeader(File &bin, BinLogHeader &hdr) {
+  bin.seek(0);
+  if (bin.read(&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+  if (memcmp_P(hdr.magic, PSTR("SBIN"), 4) != 0 || hdr.version != BINLOG_VERSION ||
+      hdr.recordSize != sizeof(BinLogRecord) || hdr.channels != CHANNEL_COUNT || hdr.sampleInterval == 0) {
+    return false;
+  }
+  // Dziennik z rekordami składa się z całych sektorów (inaczej zapis nowego bloku został przerwany)
+  return hdr.recordCount == 0 || (bin.size() % SD_SECTOR == 0 && binLogBlockCount(bin) > 0);
+}
+
+// Funkcja zapisująca nagłówek na początku pliku dziennika
+bool writeBinLogHeader(File &bin, const BinLogHeader &hdr) {
+  bin.seek(0);
+  return bin.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+}
+
+// Funkcja kodująca liczbę jako varint: po 7 bitów na bajt od najmłodszych, najstarszy bit bajtu oznacza dalszy ciąg
+// Zwraca liczbę bajtów (1-5).
+uint8_t encodeVarint(uint32_t value, uint8_t *out) {
+  uint8_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+// Funkcja przekodowująca różnicę ze znakiem na liczbę bez znaku: 0, -1, 1, -2, 2... na 0, 1, 2, 3, 4...
+// (mała różnica dowolnego znaku daje krótki varint)
+uint32_t zigZag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// Funkcja odwrotna do zigZag()
+int32_t unZigZag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Funkcja zwracająca liczbę bloków w pliku dziennika (pierwszy sektor zajmuje nagłówek pliku)
+uint32_t binLogBlockCount(File &bin) {
+  return bin.size() < 2 * SD_SECTOR ? 0 : bin.size() / SD_SECTOR - 1;
+}
+
+// Funkcja zwracająca położenie bloku w pliku
+uint32_t binLogBlockOffset(uint32_t block) {
+  return SD_SECTOR * (block + 1);
+}
+
+static_assert(BINLOG_REGION <= 255, "Obszar kolumny bloku musi miescic sie w liczniku used[]");
+
+// Funkcja zwracająca położenie obszaru kolumny (0 - czas, 1 + numer kanału) względem początku bloku
+uint16_t binLogRegionOffset(uint8_t column) {
+  return sizeof(BinLogBlock) + column * BINLOG_REGION;
+}
+
+// Funkcja dopisująca zera na końcu pliku aż do rozmiaru end (nagłówek pliku i każdy blok zajmują cały sektor)
+bool binLogPad(File &bin, uint32_t end) {
+  static const uint8_t zeros[32] = {0};
+  if (bin.size() >= end) return true;
+  bin.seek(bin.size());
+  for (uint32_t left = end - bin.size(); left > 0;) {
+    uint8_t n = min(left, (uint32_t)sizeof(zeros));
+    if (bin.write(zeros, n) != n) return false;
+    left -= n;
+  }
+  return true;
+}
+
+// Funkcja ustawiająca kursor na początku bloku: odczyt nagłówka bloku i opróżnienie buforów kolumn
+bool binLogLoadBlock(File &bin, BinLogCursor &c, uint32_t block) {
+  bin.seek(binLogBlockOffset(block));
+  if (bin.read(&c.head, sizeof(c.head)) != sizeof(c.head) || c.head.count == 0) return false;
+  uint16_t crc = crc16Update(0xFFFF, (const uint8_t *)&c.head, offsetof(BinLogBlock, count)); // Niezmienna część
+  for (uint8_t col = 0; col < BINLOG_COLUMNS; col++) {
+    if (c.head.used[col] > BINLOG_REGION) return false;
+    c.read[col] = c.fill[col] = c.next[col] = 0;
+    c.crc[col] = crc;
+  }
+  c.block = block;
+  c.index = 0;
+  c.interval = 0;
+  return true;
+}
+
+// Funkcja dekodująca następną liczbę varint kolumny; bufor kolumny jest uzupełniany z karty po BINLOG_CHUNK bajtów
+// (tylko z zajętej części obszaru kolumny, więc suma CRC obejmuje dokładnie zapisane bajty)
+bool binLogReadVarint(File &bin, BinLogCursor &c, uint8_t column, uint32_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (c.next[column] == c.fill[column]) {
+      uint8_t n = min(BINLOG_CHUNK, c.head.used[column] - c.read[column]);
+      if (n == 0) return false; // Koniec kolumny w środku liczby albo za wcześnie - blok uszkodzony
+      bin.seek(binLogBlockOffset(c.block) + binLogRegionOffset(column) + c.read[column]);
+      if (bin.read(c.buf[column], n) != n) return false;
+      c.crc[column] = crc16Update(c.crc[column], c.buf[column], n);
+      c.read[column] += n;
+      c.fill[column] = n;
+      c.next[column] = 0;
+    }
+    uint8_t b = c.buf[column][c.next[column]++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+// Funkcja sprawdzająca blok odczytany do końca: każda zdekodowana kolumna musi być zużyta w całości
+// i mieć sumę CRC z nagłówka bloku (kolumny pominięte przez kursor nie są sprawdzane)
+bool binLogBlockChecked(const BinLogCursor &c) {
+  for (uint8_t col = 0; col < BINLOG_COLUMNS; col++) {
+    if (col > 0 && c.channel != BINLOG_ALL_CHANNELS && col != c.channel + 1) continue;
+    if (c.read[col] != c.head.used[col] || c.next[col] != c.fill[col] || c.crc[col] != c.head.crc[col]) return false;
+  }
+  return true;
+}
+
+// Funkcja odczytująca następny rekord do c.row; kursor dla jednego kanału (c.channel) dekoduje tylko czas i ten kanał,
+// a kursor z c.channel = CHANNEL_COUNT - tylko czas (pozostałe wartości c.row są wtedy nieokreślone).
+// Po ostatnim rekordzie bloku sprawdza blok, a następne wywołanie przechodzi do kolejnego bloku. Liczby rekordów
+// pilnuje wywołujący (hdr.recordCount). Zwraca false przy błędzie odczytu lub uszkodzonym bloku.
+bool binLogNext(File &bin, BinLogCursor &c) {
+  if (c.index == c.head.count && !binLogLoadBlock(bin, c, c.block + 1)) return false;
+  if (c.index == 0) { // Pierwszy rekord bloku - podstawa z nagłówka
+    c.row.time = c.head.baseTime;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) c.row.value[ch] = c.head.base[ch];
+  } else {
+    uint32_t code;
+    if (!binLogReadVarint(bin, c, 0, code)) return false;
+    c.interval += unZigZag(code); // Zmiana odstępu względem poprzedniego
+    c.row.time += c.interval;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+      if (c.channel != BINLOG_ALL_CHANNELS && ch != c.channel) continue;
+      if (!binLogReadVarint(bin, c, ch + 1, code)) return false;
+      c.row.value[ch] += unZigZag(code);
+    }
+  }
+  c.index++;
+  return c.index < c.head.count || binLogBlockChecked(c);
+}
+
+// Funkcja ustawiająca kursor przed rekordem slot (slot <= hdr.recordCount)
+// Blok jest znajdowany wyszukiwaniem binarnym po numerach pierwszych rekordów bloków, a wcześniejsze rekordy
+// tego bloku są dekodowane i pomijane.
+bool binLogSeek(File &bin, BinLogCursor &c, uint32_t slot, uint8_t channel) {
+  uint32_t lo = 0, hi = binLogBlockCount(bin); // Szukany blok leży w przedziale [lo, hi)
+  while (hi - lo > 1) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t first;
+    bin.seek(binLogBlockOffset(mid));
+    if (bin.read(&first, sizeof(first)) != sizeof(first)) return false;
+    if (first <= slot) lo = mid; // Ten blok lub dalszy
+    else hi = mid;
+  }
+  c.channel = channel;
+  if (!binLogLoadBlock(bin, c, lo) || slot < c.head.first || slot - c.head.first > c.head.count) return false;
+  while (c.index < slot - c.head.first) {
+    if (!binLogNext(bin, c)) return false;
+  }
+  return true;
+}
+
+// Funkcja odtwarzająca stan otwartego bloku przez zdekodowanie ostatniego bloku (przy starcie, przed dopisywaniem):
+// binLogTail, wartości i czas ostatniego rekordu oraz ostatni odstęp. Przy okazji sprawdza sumy CRC tego bloku.
+bool binLogLoadTail(File &bin, const BinLogHeader &hdr) {
+  binLogLastTime = 0;
+  if (hdr.recordCount == 0) return true;
+  BinLogCursor c;
+  c.channel = BINLOG_ALL_CHANNELS;
+  if (!binLogLoadBlock(bin, c, binLogBlockCount(bin) - 1) || c.head.first + c.head.count != hdr.recordCount) {
+    return false; // Liczba rekordów w nagłówku pliku nie zgadza się z ostatnim blokiem
+  }
+  while (c.index < c.head.count) {
+    if (!binLogNext(bin, c)) return false;
+  }
+  binLogTail = c.head;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) binLogTailValues[ch] = c.row.value[ch];
+  binLogTailInterval = c.interval;
+  binLogLastTime = c.row.time;
+  return true;
+}
+
+// Funkcja dopisująca rekord na końcu dziennika (licznik rekordów w hdr; nagłówek pliku zapisuje wywołujący)
+// Rekord nie późniejszy niż ostatni w dzienniku (np. po cofnięciu zegara) jest pomijany,
+// aby rekordy zawsze były posortowane według czasu i wyszukiwanie binarne pozostało poprawne.
+// Różnice względem ostatniego rekordu trafiają na koniec obszarów kolumn otwartego bloku (binLogTail), a nagłówek
+// bloku jest zapisywany ponownie. Jeśli różnica którejś kolumny się nie mieści, rekord zaczyna nowy blok jako jego
+// podstawa - nowy blok od razu zajmuje cały sektor (reszta wypełniona zerami).
+bool appendBinLogRecord(File &bin, BinLogHeader &hdr, uint32_t time, const int16_t values[CHANNEL_COUNT]) {
+  if (time <= binLogLastTime && hdr.recordCount > 0) return true;
+  uint8_t code[BINLOG_COLUMNS][5]; // Zakodowane różnice kolumn (varint ma najwyżej 5 bajtów)
+  uint8_t length[BINLOG_COLUMNS];
+  uint32_t interval = time - binLogLastTime;
+  bool fits = hdr.recordCount > 0;
+  if (fits) {
+    length[0] = encodeVarint(zigZag((int32_t)(interval - binLogTailInterval)), code[0]);
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+      length[ch + 1] = encodeVarint(zigZag((int32_t)values[ch] - binLogTailValues[ch]), code[ch + 1]);
+    }
+    for (uint8_t col = 0; col < BINLOG_COLUMNS; col++) {
+      if (binLogTail.used[col] + length[col] > BINLOG_REGION) fits = false;
+    }
+  }
+
+  uint32_t offset;
+  if (fits) { // Dopisanie różnic do otwartego bloku
+    offset = binLogBlockOffset(binLogBlockCount(bin) - 1);
+    for (uint8_t col = 0; col < BINLOG_COLUMNS; col++) {
+      bin.seek(offset + binLogRegionOffset(col) + binLogTail.used[col]);
+      if (bin.write(code[col], length[col]) != length[col]) return false;
+      binLogTail.crc[col] = crc16Update(binLogTail.crc[col], code[col], length[col]);
+      binLogTail.used[col] += length[col];
+    }
+    binLogTail.count++;
+    binLogTailInterval = interval;
+  } else { // Nowy blok z rekordem jako podstawą
+    offset = binLogBlockOffset(binLogBlockCount(bin));
+    if (!binLogPad(bin, offset + SD_SECTOR)) return false;
+    binLogTail.first = hdr.recordCount;
+    binLogTail.baseTime = time;
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) binLogTail.base[ch] = values[ch];
+    binLogTail.count = 1;
+    uint16_t crc = crc16Update(0xFFFF, (const uint8_t *)&binLogTail, offsetof(BinLogBlock, count));
+    for (uint8_t col = 0; col < BINLOG_COLUMNS; col++) {
+      binLogTail.used[col] = 0;
+      binLogTail.crc[col] = crc;
+    }
+    binLogTailInterval = 0;
+  }
+  bin.seek(offset);
+  if (bin.write((const uint8_t *)&binLogTail, sizeof(binLogTail)) != sizeof(binLogTail)) return false;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) binLogTailValues[ch] = values[ch];
+  hdr.recordCount++;
+  binLogLastTime = time;
+  return true;
+}
+
+// Funkcja szukająca numeru pierwszego rekordu z dnia day lub późniejszego
+// Najpierw wyszukiwanie binarne bloku po czasach pierwszych rekordów (czytane jest tylko 8 bajtów nagłówka bloku);
+// pierwsza próba trafia w blok wynikający z nominalnego odstępu między pomiarami i średniej liczby rekordów w bloku.
+// Potem dekodowana jest tylko kolumna czasu znalezionego bloku.
+// Zwraca liczbę rekordów, jeśli wszystkie są wcześniejsze; 0xFFFFFFFF przy błędzie odczytu.
+uint32_t binLogFindDay(File &bin, const BinLogHeader &hdr, uint16_t day) {
+  uint32_t target = (uint32_t)day * 86400UL; // Początek szukanego dnia w sekundach od 2000 roku
+  uint32_t blocks = binLogBlockCount(bin);
+  uint32_t start[2]; // Numer i czas pierwszego rekordu bloku (początek BinLogBlock)
+  if (hdr.recordCount == 0 || blocks == 0) return 0;
+  bin.seek(binLogBlockOffset(0));
+  if (bin.read(start, sizeof(start)) != sizeof(start)) return 0xFFFFFFFF;
+  if (start[1] >= target) return 0; // Dzień sprzed początku dziennika
+
+  // Szukany blok: ostatni, którego pierwszy rekord jest wcześniejszy niż początek dnia; leży w przedziale [lo, hi)
+  uint32_t lo = 0, hi = blocks;
+  uint32_t probe = (target - start[1]) / hdr.sampleInterval / (hdr.recordCount / blocks + 1); // Przybliżony blok
+  while (hi - lo > 1) {
+    if (probe <= lo || probe >= hi) probe = lo + (hi - lo) / 2;
+    bin.seek(binLogBlockOffset(probe));
+    if (bin.read(start, sizeof(start)) != sizeof(start)) return 0xFFFFFFFF;
+    if (start[1] < target) lo = probe; // Ten blok lub dalszy
+    else hi = probe;
+    probe = lo + (hi - lo) / 2;
+  }
+
+  BinLogCursor c;
+  c.channel = CHANNEL_COUNT; // Tylko kolumna czasu
+  if (!binLogLoadBlock(bin, c, lo)) return 0xFFFFFFFF;
+  while (c.index < c.head.count) {
+    if (!binLogNext(bin, c)) return 0xFFFFFFFF;
+    if (c.row.time >= target) return c.head.first + c.index - 1;
+  }
+  return c.head.first + c.head.count; // Dzień zaczyna się od pierwszego rekordu następnego bloku
+}
+
+// Funkcja dopisująca do dziennika pomiary z plików CSV od miejsca, do którego dziennik jest aktualny
+// (hdr.logMonth, hdr.logOffset), aż do końca najnowszego pliku. Służy do konwersji wszystkich plików CSV
+// oraz do uzupełnienia dziennika o wiersze, które trafiły na kartę bez zapisu w dzienniku.
+bool binLogFrom(File &bin, BinLogHeader &hdr) {
+  uint16_t month = dayToMonth(clockDay());
+  LogReader log;
+  if (!logReaderOpen(log, hdr.logMonth, hdr.logMonth > month ? hdr.logMonth : month, hdr.logOffset)) {
+    return true; // Brak plików od miejsca, do którego dziennik jest aktualny - nic do dopisania
+  }
+
+  bool ok = true;
+  uint32_t count = hdr.recordCount;
+  CSVRow row;
+  while (ok && logReaderNext(log, row)) {
+    if (!isRowPlausible(row)) continue;
+    uint32_t time = (uint32_t)row.day * 86400UL + row.hour * 3600UL + row.minute * 60 + row.second;
+    ok = appendBinLogRecord(bin, hdr, time, row.value);
+  }
+  if (log.file) log.file.close(); // Odczyt przerwany błędem zapisu dziennika
+  bool moved = hdr.logMonth != log.month || hdr.logOffset != log.endOffset || hdr.recordCount != count;
+  hdr.logMonth = log.month; // Dziennik obejmuje teraz wszystkie pliki do końca ostatnio przeczytanego
+  hdr.logOffset = log.endOffset;
+  return ok && (!moved || writeBinLogHeader(bin, hdr));
+}
+
+// Funkcja tworząca dziennik od nowa przez konwersję wszystkich plików CSV
+bool rebuildBinaryLog() {
+  Serial.println(F("Konwersja plików CSV do dane.bin..."));
+  SD.remove(BINLOG_FILE); // Usuń stary (uszkodzony lub nieaktualny) dziennik
+  File bin = SD.open(BINLOG_FILE, FILE_UPDATE);
+  binLogReady = false;
+  binLogLastTime = 0;
+  if (bin) {
+    BinLogHeader hdr = {{'S', 'B', 'I', 'N'}, BINLOG_VERSION, sizeof(BinLogRecord), LOG_INTERVAL_S, 0, 0,
+                         CHANNEL_COUNT, 0};
+    binLogReady = writeBinLogHeader(bin, hdr) && binLogFrom(bin, hdr);
+    bin.close();
+  }
+  Serial.println(binLogReady ? F("Dziennik binarny gotowy.") : F("Błąd konwersji do dziennika binarnego."));
+  return binLogReady;
+}
+
+// Funkcja sprawdzająca dziennik binarny przy starcie (i po każdej zapisanej paczce)
+// Brakujący lub uszkodzony dziennik jest tworzony od nowa z plików CSV, a poprawny - uzupełniany
+// tylko o wiersze dopisane do plików CSV po jego ostatniej aktualizacji.
+void checkBinaryLog() {
+  binLogReady = false;
+  if (!sdReady) return; // Bez karty SD nie ma z czego tworzyć dziennika
+
+  File bin = SD.open(BINLOG_FILE, FILE_UPDATE);
+  if (!bin) return;
+  BinLogHeader hdr;
+  if (readBinLogHeader(bin, hdr) && logCursorValid(hdr.logMonth, hdr.logOffset)) {
+    binLogReady = binLogLoadTail(bin, hdr) && binLogFrom(bin, hdr);
+  }
+  bin.close();
+  if (!binLogReady) rebuildBinaryLog(); // Dziennik nie pasuje do plików CSV - utwórz go od nowa
+}
+
+// Funkcja wypełniająca okna (i opcjonalnie profil dobowy) na podstawie dziennika binarnego
+// Pierwszy rekord zakresu jest znajdowany wyszukiwaniem binarnym, dalej rekordy są czytane po kolei
+// aż do końca zakresu dni. Zwraca false, jeśli dziennik jest niedostępny lub uszkodzony.
+bool aggregateFromBinaryLog(AggWindow *windows, uint8_t windowCount, HourProfile *profile) {
+  uint16_t fromDay, toDay;
+  aggDayRange(windows, windowCount, profile, fromDay, toDay);
+
+  File bin = SD.open(BINLOG_FILE);
+  BinLogHeader hdr;
+  bool ok = bin && readBinLogHeader(bin, hdr);
+  if (ok) {
+    uint32_t slot = binLogFindDay(bin, hdr, fromDay);
+    BinLogCursor c;
+    ok = slot != 0xFFFFFFFF && (slot >= hdr.recordCount || binLogSeek(bin, c, slot, BINLOG_ALL_CHANNELS));
+
+    DayIndexRecord day;      // Suma pomiarów bieżącego dnia
+    bool haveDay = false;    // Czy day zawiera dane jakiegoś dnia
+    for (; ok && slot < hdr.recordCount; slot++) { // Rekordy leżą po kolei - dekodowanie blok po bloku
+      ok = binLogNext(bin, c);
+      uint16_t recDay = c.row.time / 86400UL;
+      if (!ok || recDay > toDay) break; // Koniec zakresu
+      if (!haveDay || day.day != recDay) { // Nowy dzień - przekaż poprzedni do okien
+        if (haveDay) aggAddDay(windows, windowCount, day);
+        clearDayRecord(day, recDay);
+        haveDay = true;
+      }
+      int16_t values[CHANNEL_COUNT];
+      for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = c.row.value[ch]; // Kopia spoza spakowanej struktury
+      addToDayRecord(day, values, 1);
+      hourProfileAdd(profile, recDay, (c.row.time / 3600UL) % 24, values, 1);
+    }
+    if (ok && haveDay) aggAddDay(windows, windowCount, day); // Ostatni dzień zakresu
+  }
+  if (bin) bin.close();
+  if (!ok) binLogReady = false; // Dziennik uszkodzony - przy następnym starcie zostanie odtworzony
+  return ok;
+}
+
+// Funkcja tworząca plik eksport.csv z dziennika binarnego w układzie plików CSV
+// Wartości pochodzą z zapisu stałoprzecinkowego, więc ciśnienie ma dokładność 0,1 hPa.
+// Zwraca false, jeśli eksport się nie udał albo przerwał go błąd odczytu dane.bin (plik eksport.csv jest wtedy niepełny).
+bool exportBinaryLogToCSV() {
+  flushLogBuffer(); // Eksport ma obejmować także wiersze czekające w paczce
+  File bin = SD.open(BINLOG_FILE);
+  BinLogHeader hdr;
+  if (!bin || !readBinLogHeader(bin, hdr)) {
+    if (bin) bin.close();
+    Serial.println(F("Brak poprawnego pliku dane.bin do eksportu"));
+    return false;
+  }
+  SD.remove(EXPORT_FILE); // Eksport zawsze od nowa
+  File out = SD.open(EXPORT_FILE, FILE_WRITE);
+  if (!out) {
+    bin.close();
+    Serial.println(F("Nie można utworzyć pliku eksport.csv"));
+    return false;
+  }
+
+  printCSVHeader(out); // Nagłówek kolumn jak w plikach CSV
+  uint32_t rows = 0;
+  BinLogCursor c;
+  bool ok = hdr.recordCount == 0 || binLogSeek(bin, c, 0, BINLOG_ALL_CHANNELS);
+  for (; ok && rows < hdr.recordCount; rows++) {
+    ok = binLogNext(bin, c);
+    if (!ok) break;
+    float values[CHANNEL_COUNT];
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = (float)c.row.value[ch] / channelScale(ch);
+    printCSVRow(out, DateTime(c.row.time + SECONDS_FROM_1970_TO_2000), values);
+  }
+  out.close();
+  bin.close();
+  if (!ok) { // Uszkodzony blok dane.bin - eksport jest niepełny, a dziennik zostanie odtworzony przy następnym starcie
+    Serial.println(F("Błąd odczytu pliku dane.bin"));
+    binLogReady = false;
+  }
+  Serial.print(F("Wyeksportowano wierszy do eksport.csv: "));
+  Serial.println(rows);
+  return ok;
+}
+
+// --- Zapis na kartę SD w paczkach sektorowych ---
+
+// Funkcja licząca sumę kontrolną Fletchera nagłówka dziennika zapisu (bez pola checksum) i treści paczki
+uint16_t journalChecksum(const LogJournalHeader &hdr, const uint8_t *data) {
+  const uint8_t *bytes = (const uint8_t *)&hdr;
+  const uint16_t headerBytes = sizeof(LogJournalHeader) - sizeof(hdr.checksum); // Pole checksum jest ostatnie
+  uint16_t a = 0xA5, b = 0; // Wartość początkowa różna od zera - dziennik wypełniony zerami nie jest poprawny
+  for (uint16_t i = 0; i < headerBytes + hdr.length; i++) {
+    uint8_t c = i < headerBytes ? bytes[i] : data[i - headerBytes];
+    a = (a + c) % 255;
+    b = (b + a) % 255;
+  }
+  return (b << 8) | a;
+}
+
+// Funkcja dokładająca wiersz do paczki
+// Jeśli wiersz nie mieści się przed granicą sektora wyznaczoną dla bieżącej paczki albo należy już do następnego
+// miesiąca, paczka jest najpierw zapisywana. Gdy ten zapis się nie uda, wiersz idzie za nią do kolejki EEPROM
+// (w nowej paczce czekałby na zapis dłużej niż późniejsze pomiary kolejki).
+// line: znaki wiersza (z końcem linii), length: ich liczba, time: czas pomiaru (sekundy od 2000-01-01)
+void appendLogLine(const uint8_t *line, uint8_t length, uint32_t time) {
+  uint16_t month = monthNumber(DateTime(time + SECONDS_FROM_1970_TO_2000));
+  if (logBufferLength > 0 && (logBufferLength + length > logBufferLimit || month != logBufferMonth) &&
+      !flushLogBuffer()) {
+    memcpy(logBuffer, line, length);
+    logBufferFailed(length);
+    return;
+  }
+  if (logBufferLength == 0) { // Nowa paczka - kończy się na granicy sektora liczonej od bieżącego końca pliku
+    // Pierwszy wiersz nowego miesiąca otwiera (i tworzy) plik tego miesiąca
+    uint16_t toBoundary = SD_SECTOR - (openDataFile(month) ? dataFile.size() % SD_SECTOR : 0);
+    // Do końca sektora nie zmieści się nawet jeden wiersz - paczka dopełnia ten sektor i cały następny
+    logBufferLimit = toBoundary >= LOG_LINE_MAX ? toBoundary : toBoundary + SD_SECTOR;
+    logBufferTime = time;
+    logBufferMonth = month;
+  }
+  memcpy(logBuffer + logBufferLength, line, length);
+  logBufferLength += length;
+  logBufferLastTime = time;
+}
+
+// Funkcja zapisująca paczkę: najpierw do dziennika zapisu zapis.jnl, potem na koniec pliku miesiąca
+// Następnie indeks dni.idx i dziennik dane.bin są uzupełniane o nowe wiersze (jak przy starcie).
+// Zwraca false, jeśli zapis się nie powiódł - wiersze paczki trafiają wtedy do kolejki EEPROM (logBufferFailed()).
+bool flushLogBuffer() {
+  if (logBufferLength == 0) return true;
+  uint16_t length = logBufferLength;
+  logBufferLength = 0; // Paczka jest zapisywana tylko raz, także przy błędzie (nie blokuje kolejnych wierszy)
+  if (!openDataFile(logBufferMonth)) {
+    logBufferFailed(length);
+    return false;
+  }
+
+  // Dziennik zapisu: numer kolejny, plik i miejsce paczki w pliku oraz jej treść (zamknięcie pliku wymusza zapis)
+  unsigned long start = micros();
+  LogJournalHeader hdr = {{'S', 'J', 'N', 'L'}, logSequence + 1, logBufferMonth, dataFile.size(), length, 0};
+  hdr.checksum = journalChecksum(hdr, logBuffer);
+  File jnl = SD.open(JOURNAL_FILE, FILE_UPDATE); // Zawsze od początku pliku - rozmiar pliku się nie zmienia
+  bool ok = jnl && jnl.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+            jnl.write(logBuffer, length) == length;
+  if (jnl) jnl.close();
+
+  // Paczka na koniec pliku miesiąca - jedno wywołanie flush() na całą paczkę
+  if (ok) {
+    logSequence = hdr.sequence;
+    ok = dataFile.write(logBuffer, length) == length;
+    dataFile.flush();
+  }
+  probeRecord(PROBE_FLUSH, micros() - start);
+  if (!ok) {
+    Serial.println(F("Błąd zapisu paczki na SD"));
+    dataFile.close(); // Plik zostanie otwarty ponownie przy następnej paczce
+    logBufferFailed(length);
+    return false;
+  }
+  cardLastTime = logBufferLastTime;
+  Serial.print(F("Zapisano dane na SD (paczka ")); Serial.print(hdr.sequence);
+  Serial.print(F(", ")); Serial.print(length); Serial.println(F(" B)."));
+
+  // Indeks i dziennik binarny czytają tylko dopisaną paczkę (od rozmiaru pliku, do którego były aktualne)
+  if (dayIndexReady) checkDayIndex();
+#if BINARY_LOG
+  if (binLogReady) checkBinaryLog();
+#endif
+  return true;
+}
+
+// Funkcja odczytująca z paczki kolejny wiersz z poprawnymi wartościami (pozostałe są pomijane)
+// pos: pozycja w logBuffer, przesuwana za odczytany wiersz; length: liczba bajtów paczki
+bool nextLogBufferRow(uint16_t &pos, uint16_t length, CSVRow &row) {
+  char line[LOG_LINE_MAX];
+  uint8_t n = 0;
+  while (pos < length) {
+    char c = logBuffer[pos++];
+    if (c != '\n') {
+      if (c != '\r' && n < sizeof(line) - 1) line[n++] = c;
+      continue;
+    }
+    line[n] = '\0';
+    n = 0;
+    if (parseCSVLine(line, row) && isRowPlausible(row)) return true;
+  }
+  return false;
+}
+
+// Funkcja obsługująca nieudany zapis paczki: karta jest od teraz niedostępna (pomiary trafiają do kolejki EEPROM,
+// a karta jest uruchamiana ponownie co SD_PROBE_S sekund), a wiersze paczki - do kolejki. Paczka z przepisywanej
+// kolejki nie wraca do niej, bo jej rekordy są nadal w kolejce.
+// length: liczba bajtów paczki w logBuffer
+void logBufferFailed(uint16_t length) {
+  sdReady = false;
+  sdProbeTime = clockSeconds();
+  if (queueDraining) return;
+  uint16_t pos = 0;
+  CSVRow row;
+  while (nextLogBufferRow(pos, length, row)) {
+    queuePush((uint32_t)row.day * 86400UL + row.hour * 3600UL + row.minute * 60 + row.second, row.value);
+  }
+}
+
+// Funkcja dokańczająca przy starcie zapis paczki przerwany zanikiem zasilania
+// Paczka z dziennika zapisu jest porównywana z plikiem jej miesiąca w miejscu, w którym powinna leżeć. Jeśli jej tam
+// brakuje lub jest niepełna (a za nią nie ma już innych danych), zostaje zapisana ponownie w to samo miejsce.
+void recoverLogJournal() {
+  File jnl = SD.open(JOURNAL_FILE);
+  if (!jnl) return; // Brak dziennika - nie zapisano jeszcze żadnej paczki
+  LogJournalHeader hdr;
+  bool ok = jnl.read(&hdr, sizeof(hdr)) == sizeof(hdr) && memcmp_P(hdr.magic, PSTR("SJNL"), 4) == 0 &&
+            hdr.length <= sizeof(logBuffer) && jnl.read(logBuffer, hdr.length) == hdr.length &&
+            journalChecksum(hdr, logBuffer) == hdr.checksum;
+  jnl.close();
+  if (!ok) return; // Przerwany zapis dziennika - paczka nie dotarła do pliku CSV, więc plik jest nienaruszony
+  logSequence = hdr.sequence;
+
+  char path[LOG_PATH_LEN];
+  File csv = SD.open(partitionPath(path, hdr.month), O_READ | O_WRITE); // Bez O_CREAT - plik paczki już istnieje
+  if (!csv) return;
+  uint32_t size = csv.size();
+  if (size >= hdr.offset && size <= hdr.offset + hdr.length) { // Plik kończy się w obrębie paczki
+    bool complete = size == hdr.offset + hdr.length;
+    csv.seek(hdr.offset);
+    for (uint16_t i = 0; complete && i < hdr.length; i++) complete = csv.read() == logBuffer[i];
+    if (!complete) {
+      csv.seek(hdr.offset);
+      csv.write(logBuffer, hdr.length);
+      csv.flush();
+      Serial.print(F("Odtworzono paczkę ")); Serial.print(hdr.sequence);
+      Serial.print(F(" w ")); Serial.print(path);
+      Serial.print(F(" (")); Serial.print(hdr.length); Serial.println(F(" B)."));
+    }
+  }
+  csv.close();
+}
+
+// --- Kolejka pomiarów w pamięci EEPROM ---
+
+// Funkcja przygotowująca uruchomioną kartę (przy starcie i po ponownym uruchomieniu karty)
+void attachCard() {
+  sdReady = true;
+  recoverLogJournal(); // Dokończ zapis paczki przerwany zanikiem zasilania (przed dopisywaniem nowych wierszy)
+  migrateLegacyLog();  // Podziel dawny plik dane.csv na pliki miesięczne (tylko przy pierwszym starcie)
+  // Otwarcie pliku bieżącego miesiąca do zapisu (jeśli nie istnieje, zostanie utworzony z nagłówkiem kolumn)
+  // Plik pozostaje otwarty do dalszych operacji zapisu.
+  // Zapewnia to, że strumień zapisu jest gotowy, a plik nie jest za każdym razem otwierany i zamykany,
+  // co mogłoby spowolnić działanie i zwiększyć zużycie pamięci.
+  openDataFile(dayToMonth(clockDay()));
+  cardLastTime = lastCSVTime(); // Rekordy kolejki do tego czasu są już na karcie
+}
+
+// Funkcja ponownie uruchamiająca niedostępną kartę (zadanie zapisu, co SD_PROBE_S sekund)
+// Włożona karta jest przygotowywana jak przy starcie, a indeks i dziennik binarny są uzupełniane (inna karta -
+// budowane od nowa); kolejka jest przepisywana w kolejnych przebiegach zadania zapisu.
+// now: bieżący czas (sekundy od 2000-01-01)
+void probeCard(uint32_t now) {
+  if (now >= sdProbeTime && now < sdProbeTime + SD_PROBE_S) return; // Jeszcze nie czas (cofnięty zegar - od razu)
+  sdProbeTime = now;
+  if (dataFile) dataFile.close(); // Uchwyt pliku sprzed wyjęcia karty jest nieważny
+  SD.end();
+  if (!SD.begin(chipSelect)) return;
+  Serial.println(F("Karta SD ponownie dostępna."));
+  attachCard();
+  checkDayIndex();
+#if BINARY_LOG
+  checkBinaryLog();
+#endif
+}
+
+// Funkcja zwracająca czas ostatniego wiersza pomiarów na karcie (0 - brak wierszy)
+// Czyta tylko końcówkę najnowszego pliku miesiąca, a jeśli nie ma w nim wierszy (np. plik nowego miesiąca
+// z samym nagłówkiem) - końcówkę pliku poprzedniego miesiąca.
+uint32_t lastCSVTime() {
+  char path[LOG_PATH_LEN];
+  uint16_t month = findPartition(dayToMonth(clockDay()), 0, -1);
+  for (uint8_t i = 0; i < 2 && month != LOG_NO_MONTH; i++) {
+    File file = SD.open(partitionPath(path, month));
+    if (!file) break;
+    CSVReader in;
+    csvReaderStart(in, file, file.size() > 2 * LOG_LINE_MAX ? file.size() - 2 * LOG_LINE_MAX : 0);
+    CSVRow row, last;
+    bool found = false;
+    while (readCSVRow(in, row)) {
+      last = row;
+      found = true;
+    }
+    file.close();
+    if (found) return (uint32_t)last.day * 86400UL + last.hour * 3600UL + last.minute * 60 + last.second;
+    month = month > 0 ? findPartition(month - 1, 0, -1) : LOG_NO_MONTH;
+  }
+  return 0;
+}
+
+// Funkcja zwracająca adres pozycji kolejki w pamięci EEPROM
+uint16_t queueSlotAddress(uint16_t slot) {
+  return QUEUE_EEPROM_START + slot * sizeof(QueueSlot);
+}
+
+// Funkcja licząca sumę CRC-16 pozycji kolejki (bez pola crc)
+uint16_t queueSlotCrc(const QueueSlot &s) {
+  return crc16Update(0xFFFF, (const uint8_t *)&s, offsetof(QueueSlot, crc));
+}
+
+// Funkcja odczytująca pozycję kolejki; zwraca false dla pozycji pustej (skasowana pamięć) lub uszkodzonej
+bool queueReadSlot(uint16_t slot, QueueSlot &s) {
+  EEPROM.get(queueSlotAddress(slot), s);
+  return s.time != 0xFFFFFFFF && s.crc == queueSlotCrc(s);
+}
+
+// Funkcja zwracająca pozycję i-tego rekordu czekającego w kolejce (0 - najstarszy)
+uint16_t queuePending(uint16_t i) {
+  return (queueHead + QUEUE_SLOTS - queueCount + i) % QUEUE_SLOTS;
+}
+
+// Funkcja dopisująca pomiar na koniec kolejki (pełna kolejka traci najstarszy rekord)
+// Zapis zmienionych bajtów pozycji trwa do ok. 50 ms (3,3 ms na bajt EEPROM) - raz na pomiar.
+void queuePush(uint32_t time, const int16_t values[CHANNEL_COUNT]) {
+  QueueSlot s;
+  s.sequence = ++queueSequence;
+  s.time = time;
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) s.value[ch] = values[ch];
+  s.crc = queueSlotCrc(s);
+  EEPROM.put(queueSlotAddress(queueHead), s);
+  queueHead = (queueHead + 1) % QUEUE_SLOTS;
+  if (queueCount < QUEUE_SLOTS) queueCount++;
+  else queueOverwritten++;
+}
+
+// Funkcja odtwarzająca stan kolejki przy starcie
+// Najnowszy rekord to poprawna pozycja z największym numerem (porównanie z przepełnieniem - numery w kolejce
+// różnią się o mniej niż QUEUE_SLOTS). Czekają rekordy przed nim o kolejnych numerach i malejących czasach,
+// późniejsze niż ostatni wiersz na karcie; bez karty - wszystkie (przepisanie pominie te, które już są na karcie).
+void queueLoad() {
+  QueueSlot s;
+  bool found = false;
+  uint16_t newest = 0;
+  for (uint16_t slot = 0; slot < QUEUE_SLOTS; slot++) {
+    if (!queueReadSlot(slot, s)) continue;
+    if (!found || (int16_t)(s.sequence - queueSequence) > 0) {
+      newest = slot;
+      queueSequence = s.sequence;
+      found = true;
+    }
+  }
+  queueHead = found ? (newest + 1) % QUEUE_SLOTS : 0;
+  queueCount = 0;
+  uint32_t time = 0xFFFFFFFF;
+  for (uint16_t sequence = queueSequence; found && queueCount < QUEUE_SLOTS; sequence--) {
+    uint16_t slot = (queueHead + QUEUE_SLOTS - 1 - queueCount) % QUEUE_SLOTS; // Od najnowszego wstecz
+    if (!queueReadSlot(slot, s) || s.sequence != sequence || s.time >= time || s.time <= cardLastTime) {
+      break;
+    }
+    time = s.time;
+    queueCount++;
+  }
+}
+
+// Funkcja dodająca rekordy czekające w kolejce do bufora ostatnich pomiarów i przedziałów wykresu (przy starcie),
+// aby ekrany średnich i wykres obejmowały także pomiary, których nie ma jeszcze na karcie
+// Bez karty bufor nie ma historii sprzed kolejki: w całości są w nim tylko dni po pierwszym rekordzie za ostatnią
+// przerwą w pomiarach (dłuższą niż QUEUE_GAP_S), i to tylko wtedy, gdy kolejka sięga do chwili startu.
+void queueMergeHistory() {
+  if (queueCount == 0) return;
+  QueueSlot s;
+  uint32_t last = 0, runStart = 0;
+  for (uint16_t i = 0; i < queueCount; i++) {
+    if (!queueReadSlot(queuePending(i), s)) continue;
+    if (s.time - last > QUEUE_GAP_S) runStart = s.time; // Przerwa - wcześniejsze pomiary mogą być tylko na karcie
+    last = s.time;
+    int16_t values[CHANNEL_COUNT];
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = s.value[ch]; // Kopia spoza spakowanej struktury
+    ringPush(s.time / 86400UL, s.time % 86400UL / 3600, values);
+    graphAddSample(s.time, values);
+  }
+  if (!sdReady && clockSeconds() - last <= QUEUE_GAP_S) ringEvictedDay = runStart / 86400UL;
+  Serial.print(F("Kolejka EEPROM: ")); Serial.print(queueCount); Serial.println(F(" pomiarów do zapisu na kartę."));
+}
+
+// Funkcja przepisująca na kartę do QUEUE_DRAIN_BATCH najstarszych rekordów kolejki (zadanie zapisu)
+// Rekordy trafiają do paczki jak nowe pomiary i opuszczają kolejkę dopiero po zapisaniu paczki; rekordy nie
+// późniejsze niż ostatni wiersz na karcie są pomijane (już na niej są). Po przepisaniu całej kolejki przedziały
+// wykresu są odtwarzane z dziennika, jeśli plik wykres.bin nie był aktualizowany bez karty.
+void queueDrain() {
+  if (!flushLogBuffer()) return; // Paczka powinna być pusta - nowe pomiary czekają w kolejce
+  uint8_t count = min(queueCount, (uint16_t)QUEUE_DRAIN_BATCH);
+  queueDraining = true;
+  QueueSlot s;
+  for (uint8_t i = 0; i < count && sdReady; i++) { // Po nieudanym zapisie paczki dalsze wiersze nie mają sensu
+    if (!queueReadSlot(queuePending(i), s) || s.time <= cardLastTime) continue;
+    float values[CHANNEL_COUNT];
+    for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) values[ch] = (float)s.value[ch] / channelScale(ch);
+    LineBuffer line;
+    printCSVRow(line, DateTime(s.time + SECONDS_FROM_1970_TO_2000), values);
+    appendLogLine(line.text, line.length, s.time);
+  }
+  bool ok = flushLogBuffer() && sdReady; // Paczka zapisana wcześniej w appendLogLine() też mogła się nie udać
+  queueDraining = false;
+  if (!ok) return; // Karta znowu niedostępna - rekordy zostają w kolejce
+  queueCount -= count;
+  if (queueCount > 0) return;
+  Serial.println(F("Kolejka EEPROM przepisana na kartę."));
+  if (!graphReady) checkGraph();
+}
+
+// Funkcja wypisująca stan kolejki (polecenie "kolejka")
+void printQueue() {
+  Serial.print(F("Kolejka EEPROM: ")); Serial.print(queueCount); Serial.print(F(" z "));
+  Serial.print(QUEUE_SLOTS); Serial.print(F(" pozycji do zapisu, nadpisanych: ")); Serial.print(queueOverwritten);
+  Serial.print(F(", numer ostatniego: ")); Serial.println(queueSequence);
+  Serial.println(sdReady ? F("Karta SD dostępna.") : F("Karta SD niedostępna."));
+}
+
+// --- Pobieranie dziennika przez port szeregowy ---
+
+// Funkcja licząca CRC-16/CCITT (wielomian 0x1021) kolejnych bajtów
+// crc: wynik dla wcześniejszych bajtów (0xFFFF na początku)
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, uint16_t length) {
+  while (length--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Funkcja wysyłająca jedną ramkę pobierania: nagłówek, count rekordów spod data i CRC
+void sendExportFrame(char type, uint32_t index, const uint8_t *data, uint8_t count) {
+  ExportFrameHeader hdr = {{EXPORT_SYNC0, EXPORT_SYNC1}, type, count, index};
+  uint16_t length = count * sizeof(BinLogRecord);
+  uint16_t crc = crc16Update(0xFFFF, (const uint8_t *)&hdr, sizeof(hdr));
+  crc = crc16Update(crc, data, length);
+  Serial.write((const uint8_t *)&hdr, sizeof(hdr));
+  if (length > 0) Serial.write(data, length);
+  Serial.write((const uint8_t *)&crc, sizeof(crc)); // Młodszy bajt pierwszy (jak w pliku dane.bin)
+}
+
+// Funkcja wypisująca pliki miesięcy z rozmiarami, liczbę rekordów dziennika binarnego i kanały (polecenie "lista")
+void listPartitions() {
+  flushLogBuffer(); // Rozmiary mają obejmować także wiersze czekające w paczce
+  char path[LOG_PATH_LEN];
+  uint16_t last = dayToMonth(clockDay());
+  uint16_t files = 0;
+  uint16_t month = sdReady ? findPartition(0, last, 1) : LOG_NO_MONTH;
+  while (month != LOG_NO_MONTH) {
+    File file = SD.open(partitionPath(path, month));
+    if (file) {
+      Serial.print(F("plik ")); Serial.print(path); Serial.print(' '); Serial.println(file.size());
+      file.close();
+      files++;
+    }
+    month = month < last ? findPartition(month + 1, last, 1) : LOG_NO_MONTH;
+  }
+  uint32_t records = 0;
+  File bin = binLogReady ? SD.open(BINLOG_FILE) : File();
+  if (bin) {
+    BinLogHeader hdr;
+    if (readBinLogHeader(bin, hdr)) records = hdr.recordCount;
+    bin.close();
+  }
+  Serial.print(F("dziennik ")); Serial.println(records);
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) { // Kolejność wartości w rekordach ramek pobierania
+    Serial.print(F("kanal ")); Serial.print((const __FlashStringHelper *)CHANNELS[ch].column);
+    Serial.print(' '); Serial.println(channelScale(ch));
+  }
+  Serial.print(F("koniec ")); Serial.println(files);
+}
+
+// Funkcja rozpoczynająca pobieranie (polecenie "pobierz OD DO [N]"); ramki wysyła dalej exportTask()
+// args: tekst polecenia po słowie "pobierz"
+void startExport(const char *args) {
+  stopExport(); // Nowe polecenie zastępuje trwające pobieranie
+  const char *p = args;
+  uint16_t fromDay, toDay;
+  uint32_t skip = 0; // Liczba rekordów zakresu już odebranych
+  bool ok = parseDate(p, fromDay) && *p++ == ' ' && parseDate(p, toDay) && fromDay <= toDay;
+  if (ok && *p == ' ') {
+    char *end;
+    skip = strtoul(p + 1, &end, 10);
+    p = end;
+  }
+  if (!ok || *p != '\0') {
+    Serial.println(F("Błędne polecenie, oczekiwano: pobierz RRRR-MM-DD RRRR-MM-DD [N]"));
+    sendExportFrame('B', 0, NULL, 0);
+    return;
+  }
+
+  flushLogBuffer(); // Pobieranie ma obejmować także wiersze czekające w paczce
+  BinLogHeader hdr;
+  exportFirst = exportEnd = 0xFFFFFFFF;
+  if (binLogReady) exportFile = SD.open(BINLOG_FILE);
+  if (exportFile && readBinLogHeader(exportFile, hdr)) {
+    exportFirst = binLogFindDay(exportFile, hdr, fromDay); // Wyszukiwanie binarne - bez czytania całego pliku
+    exportEnd = binLogFindDay(exportFile, hdr, toDay + 1);
+  }
+  exportNext = skip < exportEnd - exportFirst ? exportFirst + skip : exportEnd;
+  if (!exportFile || exportFirst == 0xFFFFFFFF || exportEnd == 0xFFFFFFFF ||
+      (exportNext < exportEnd && !binLogSeek(exportFile, exportCursor, exportNext, BINLOG_ALL_CHANNELS))) {
+    Serial.println(F("Brak poprawnego pliku dane.bin do pobrania"));
+    sendExportFrame('B', 0, NULL, 0);
+    stopExport();
+    return;
+  }
+  exportActive = true;
+  sendExportFrame('S', exportEnd - exportFirst, NULL, 0);
+}
+
+// Funkcja kończąca pobieranie i zamykająca plik dane.bin
+void stopExport() {
+  if (exportFile) exportFile.close();
+  exportActive = false;
+}
+
+// Zadanie pobierania: wysyłanie kolejnych ramek przez najwyżej EXPORT_SLICE_MS, potem oddanie czasu innym zadaniom
+// Serial.write() czeka, gdy bufor nadawczy jest pełny, więc ramki wychodzą z prędkością portu.
+void exportTask() {
+  if (!exportActive) return;
+  uint8_t data[EXPORT_FRAME_RECORDS * sizeof(BinLogRecord)];
+  unsigned long start = millis();
+  do {
+    if (exportNext >= exportEnd) { // Wszystkie rekordy zakresu wysłane
+      sendExportFrame('E', exportEnd - exportFirst, NULL, 0);
+      stopExport();
+      return;
+    }
+    uint8_t count = exportEnd - exportNext < EXPORT_FRAME_RECORDS ? exportEnd - exportNext : EXPORT_FRAME_RECORDS;
+    BinLogRecord *rows = (BinLogRecord *)data;
+    for (uint8_t i = 0; i < count; i++) {
+      if (!binLogNext(exportFile, exportCursor)) {
+        Serial.println(F("Błąd odczytu pliku dane.bin"));
+        sendExportFrame('B', exportNext - exportFirst, NULL, 0);
+        stopExport();
+        return;
+      }
+      rows[i] = exportCursor.row;
+    }
+    sendExportFrame('D', exportNext - exportFirst, data, count);
+    exportNext += count;
+  } while (millis() - start < EXPORT_SLICE_MS);
+}
+
+// --- Zapytania o jeden kanał ---
+// Polecenie "kanal ETYKIETA OD DO" podaje minimum, średnią i maksimum jednego kanału dla każdego dnia z zakresu.
+// Dziennik dane.bin przechowuje kolumny osobno, więc dekodowana jest tylko kolumna czasu i kolumna tego kanału
+// (zwykle 2-3 bajty na pomiar), bez parsowania plików CSV.
+
+// Funkcja zwracająca numer kanału o podanej etykiecie ekranu albo nazwie kolumny CSV; CHANNEL_COUNT - brak kanału
+uint8_t findChannel(const char *name) {
+  for (uint8_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+    if (strcmp_P(name, CHANNELS[ch].label) == 0 || strcmp_P(name, CHANNELS[ch].column) == 0) return ch;
+  }
+  return CHANNEL_COUNT;
+}
+
+// Funkcja wypisująca wiersz dnia: "RRRR-MM-DD min srednia max" (wartości stałoprzecinkowe przeliczone wg scale)
+void printChannelDay(uint16_t day, uint16_t count, int32_t sum, int16_t minValue, int16_t maxValue, int16_t scale) {
+  DateTime date((uint32_t)day * 86400UL + SECONDS_FROM_1970_TO_2000);
+  char text[12];
+  snprintf_P(text, sizeof(text), PSTR("%04u-%02u-%02u"), date.year(), date.month(), date.day());
+  Serial.print(text); Serial.print(' ');
+  Serial.print((float)minValue / scale, 2); Serial.print(' ');
+  Serial.print((float)sum / count / scale, 2); Serial.print(' ');
+  Serial.println((float)maxValue / scale, 2);
+}
+
+// Funkcja obsługująca polecenie "kanal ETYKIETA RRRR-MM-DD RRRR-MM-DD"
+// args: tekst polecenia po słowie "kanal" (nazwa kanału jest rozdzielana w miejscu)
+void printChannelDays(char *args) {
+  char *p = strchr(args, ' ');
+  uint8_t ch = CHANNEL_COUNT;
+  uint16_t fromDay, toDay;
+  bool ok = p != NULL;
+  if (ok) {
+    *p++ = '\0'; // Koniec nazwy kanału
+    ch = findChannel(args);
+    const char *q = p;
+    ok = ch < CHANNEL_COUNT && parseDate(q, fromDay) && *q++ == ' ' && parseDate(q, toDay) && fromDay <= toDay &&
+         *q == '\0';
+  }
+  if (!ok) {
+    Serial.println(F("Błędne polecenie, oczekiwano: kanal ETYKIETA RRRR-MM-DD RRRR-MM-DD"));
+    return;
+  }
+
+  flushLogBuffer(); // Zapytanie ma obejmować także wiersze czekające w paczce
+  File bin = binLogReady ? SD.open(BINLOG_FILE) : File();
+  BinLogHeader hdr;
+  uint32_t slot = 0xFFFFFFFF, end = 0xFFFFFFFF;
+  if (bin && readBinLogHeader(bin, hdr)) {
+    slot = binLogFindDay(bin, hdr, fromDay);
+    end = binLogFindDay(bin, hdr, toDay + 1);
+  }
+  BinLogCursor c;
+  if (slot == 0xFFFFFFFF || end == 0xFFFFFFFF || (slot < end && !binLogSeek(bin, c, slot, ch))) {
+    if (bin) bin.close();
+    Serial.println(F("Brak poprawnego pliku dane.bin"));
+    return;
+  }
+
+  Serial.print(F("--- ")); Serial.print((const __FlashStringHelper *)CHANNELS[ch].name);
+  Serial.println(F(": dzien min srednia max ---"));
+  int16_t scale = channelScale(ch);
+  uint32_t records = end - slot;
+  uint16_t day = 0, count = 0; // Bieżący dzień i liczba jego pomiarów
+  int32_t sum = 0;
+  int16_t minValue = 0, maxValue = 0;
+  uint32_t firstBlock = c.block;
+  for (; ok && slot < end; slot++) {
+    ok = binLogNext(bin, c);
+    if (!ok) break;
+    uint16_t recDay = c.row.time / 86400UL;
+    int16_t value = c.row.value[ch];
+    if (count > 0 && recDay != day) { // Nowy dzień - wypisz poprzedni
+      printChannelDay(day, count, sum, minValue, maxValue, scale);
+      count = 0;
+    }
+    if (count == 0) {
+      day = recDay;
+      sum = 0;
+      minValue = maxValue = value;
+    }
+    count++;
+    sum += value;
+    if (value < minValue) minValue = value;
+    if (value > maxValue) maxValue = value;
+  }
+  bin.close();
+  if (!ok) {
+    Serial.println(F("Błąd odczytu pliku dane.bin"));
+    return;
+  }
+  if (count > 0) printChannelDay(day, count, sum, minValue, maxValue, scale);
+  Serial.print(F("Pomiarow: ")); Serial.print(records);
+  Serial.print(F(", blokow dziennika: ")); Serial.println(records > 0 ? c.block - firstBlock + 1 : 0);
+}
+
+// --- Polecenia z monitora szeregowego ---
+
+// Funkcja zbierająca znaki z portu szeregowego i wykonująca polecenie po odebraniu końca linii
+// Obsługiwane polecenia: "eksport" - utworzenie pliku eksport.csv z dziennika binarnego,
+// "zadania" - najdłuższe czasy wykonania zadań i przebiegu pętli, "stats" i "stats zeruj" - liczniki sond czasu
+// wykonania, "zegar" - synchronizacja zegara programowego z RTC, "lista", "pobierz" i "przerwij" - pobieranie
+// dziennika przez port szeregowy (opis na początku pliku), "kanal ETYKIETA OD DO" - minimum, średnia i maksimum
+// jednego kanału dla kolejnych dni, "kolejka" - stan kolejki pomiarów w pamięci EEPROM
+void handleSerialInput() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (serialCommandLength < sizeof(serialCommand) - 1) serialCommand[serialCommandLength++] = c;
+      continue;
+    }
+    serialCommand[serialCommandLength] = '\0';
+    if (serialCommandLength == 0) continue; // Pusta linia (np. "\r\n")
+    serialCommandLength = 0;
+    lastActivity = uptimeMillis(); // Polecenie z portu odsuwa uśpienie (ekranu nie włącza)
+
+    if (strcmp_P(serialCommand, PSTR("eksport")) == 0) {
+      exportBinaryLogToCSV();
+    } else if (strcmp_P(serialCommand, PSTR("zadania")) == 0) {
+      printTaskTimes();
+    } else if (strcmp_P(serialCommand, PSTR("lista")) == 0) {
+      listPartitions();
+    } else if (strncmp_P(serialCommand, PSTR("pobierz "), 8) == 0) {
+      startExport(serialCommand + 8);
+    } else if (strcmp_P(serialCommand, PSTR("przerwij")) == 0) {
+      stopExport();
+    } else if (strncmp_P(serialCommand, PSTR("kanal "), 6) == 0) {
+      printChannelDays(serialCommand + 6);
+    } else if (strcmp_P(serialCommand, PSTR("zegar")) == 0) {
+      printClock();
+    } else if (strcmp_P(serialCommand, PSTR("kolejka")) == 0) {
+      printQueue();
+    } else if (strcmp_P(serialCommand, PSTR("stats")) == 0) {
+      printProbeStats();
+    } else if (strcmp_P(serialCommand, PSTR("stats zeruj")) == 0) {
+      probeReset();
+      Serial.println(F("Liczniki sond wyzerowane"));
+    } else {
+      Serial.print(F("Nieznane polecenie: "));
+      Serial.println(serialCommand);
+    }
+  }
 }
@@ -0,0 +1,336 @@
+// Pomiary wydajności odczytu dziennika, agregacji i rysowania ekranów na syntetycznych plikach CSV
+//
+// Użycie: bench [opcje]
+//   -r KATALOG   katalog roboczy na wygenerowane karty SD (domyślnie build/bench-data)
+//   -c PROCENT   udział uszkodzonych linii w generowanych plikach (domyślnie 1)
+//   -S ZIARNO    ziarno generatora liczb losowych (domyślnie 1)
+//   -b PLIK      raport odniesienia (wcześniejszy wydruk tego programu) do porównania
+//
+// Dla każdego zestawu danych (miesiąc, rok, 5 lat pomiarów godzinowych) program generuje pliki miesięczne /RRRR/MM.csv,
+// uruchamia setup() szkicu i mierzy kolejne operacje. Każdy zestaw działa w osobnym procesie potomnym,
+// więc stan globalny szkicu (bufor pomiarów, indeks, pola ekranu) nie przechodzi między zestawami.
+//
+// Kolumny raportu:
+//   wiersze    liczba linii plików CSV przeczytanych przez operację ("-" dla operacji bez pełnego przejścia)
+//   ms_host    czas operacji na komputerze (zegar rzeczywisty)
+//   wiersze/s  wiersze / ms_host - przepustowość kodu parsującego i agregującego
+//   ms_wirt    czas wirtualny wg modeli peryferiów (bloki karty SD, transfery SPI wyświetlacza, I2C)
+//   SD_B       bajty odczytane z karty SD
+//   SD_bloki   bloki 512 B wczytane z karty SD
+//   SPI_B      bajty wysłane do wyświetlacza
+//   SPI_tr     liczba transakcji SPI wyświetlacza (ustawień okna adresowego)
+//
+// Szkic jest dołączany bezpośrednio, aby pomiary mogły wymusić konkretną ścieżkę (np. bez bufora w RAM).
+#include "../../Main_project.cpp"
+#include "sim.h"
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+  char dataset[8];       // Nazwa zestawu danych
+  char operation[24];    // Nazwa operacji
+  uint32_t rows;         // Liczba wierszy pliku CSV przeczytanych przez operację (0 - bez przejścia po pliku)
+  double hostMs;         // Czas na komputerze
+  double virtualMs;      // Czas wirtualny
+  uint64_t sdBytes;      // Bajty odczytane z karty
+  uint64_t sdBlocks;     // Bloki wczytane z karty
+  uint32_t spiBytes;     // Bajty SPI wyświetlacza
+  uint32_t spiTransactions; // Transakcje SPI wyświetlacza
+};
+
+struct Dataset {
+  const char *name;      // Nazwa zestawu (bez spacji - klucz w raporcie odniesienia)
+  uint16_t days;         // Liczba dni pomiarów
+};
+
+static const Dataset DATASETS[] = {{"miesiac", 30}, {"rok", 365}, {"5lat", 1826}};
+static const DateTime BENCH_END(2026, 3, 15, 12, 30, 0); // Chwila uruchomienia szkicu (ostatni wiersz o 12:00)
+
+// Generator liczb pseudolosowych xorshift32 - ten sam plik dla tego samego ziarna
+static uint32_t rngState = 1;
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+static double rngUnit() { return (rng() & 0xFFFFFF) / 16777216.0; }
+
+// Zapis jednej linii w formacie printCSVRow()
+static int formatRow(char *buf, size_t len, const DateTime &t, double temp, double hum, double press) {
+  return snprintf(buf, len, "%04d-%02d-%02d, %02d:%02d:%02d, %.2f, %.2f, %.2f", t.year(), t.month(), t.day(), t.hour(),
+                  t.minute(), t.second(), temp, hum, press);
+}
+
+// Uszkodzenie linii na jeden z typowych sposobów (przerwany zapis, śmieci, wartości spoza zakresu, zbyt długa
+// linia, pusta linia, brakujące pole)
+static void corruptRow(char *buf, size_t len) {
+  size_t n = strlen(buf);
+  switch (rng() % 6) {
+    case 0: buf[rng() % n] = '\0'; break;
+    case 1:
+      for (size_t i = 0; i < n; i++) buf[i] = (char)(0x21 + rng() % 94);
+      break;
+    case 2: {
+      char *comma = strchr(buf, ',');
+      if (comma) comma = strchr(comma + 1, ',');
+      if (comma) snprintf(comma, len - (comma - buf), ", 999.00, -5.00, 0.00");
+      break;
+    }
+    case 3:
+      while (n + 1 < len && n < 120) buf[n++] = (char)('a' + rng() % 26);
+      buf[n] = '\0';
+      break;
+    case 4: buf[0] = '\0'; break;
+    default: {
+      char *comma = strrchr(buf, ',');
+      if (comma) *comma = '\0';
+      break;
+    }
+  }
+}
+
+// Generowanie plików miesięcznych: pomiary co godzinę przez days dni, kończące się przed BENCH_END
+// Zwraca liczbę linii danych (łącznie z uszkodzonymi); lastMonthRows - liczba linii w pliku ostatniego miesiąca
+static uint32_t generateLog(const char *dir, uint16_t days, double corruptPercent, uint32_t &lastMonthRows) {
+  FILE *f = nullptr;
+  int fileMonth = -1;
+  uint32_t end = DateTime(BENCH_END.year(), BENCH_END.month(), BENCH_END.day(), BENCH_END.hour(), 0, 0).secondstime();
+  uint32_t rows = (uint32_t)days * 24;
+  double pressure = 1013.0;
+  char line[160];
+  for (uint32_t i = 0; i < rows; i++) {
+    DateTime t(end - (rows - 1 - i) * 3600UL + SECONDS_FROM_1970_TO_2000);
+    double yearPhase = 2 * M_PI * (t.secondstime() % 31557600UL) / 31557600.0;
+    double dayPhase = 2 * M_PI * t.hour() / 24.0;
+    double temp = 10 - 12 * cos(yearPhase) - 4 * cos(dayPhase) + (rngUnit() - 0.5);
+    double hum = 65 + 15 * cos(dayPhase) + 10 * (rngUnit() - 0.5);
+    pressure += (rngUnit() - 0.5) * 0.8 + (1013.0 - pressure) * 0.01;
+    formatRow(line, sizeof(line), t, temp, hum < 0 ? 0 : (hum > 100 ? 100 : hum), pressure);
+    if (rngUnit() * 100 < corruptPercent) corruptRow(line, sizeof(line));
+    if (t.year() * 12 + t.month() != fileMonth) { // Nowy miesiąc - nowy plik z nagłówkiem
+      if (f) fclose(f);
+      char path[32];
+      snprintf(path, sizeof(path), "/%04d", t.year());
+      mkdir((dir + std::string(path)).c_str(), 0755);
+      snprintf(path, sizeof(path), "/%04d/%02d.csv", t.year(), t.month());
+      f = fopen((dir + std::string(path)).c_str(), "w");
+      if (!f) return 0;
+      fprintf(f, "Date, Time, Temperature, Humidity, Pressure\n");
+      fileMonth = t.year() * 12 + t.month();
+      lastMonthRows = 0;
+    }
+    fprintf(f, "%s\n", line);
+    lastMonthRows++;
+  }
+  if (f) fclose(f);
+  return rows;
+}
+
+// Pomiar jednej operacji: liczniki są zerowane przed operacją, a wynik trafia do potoku procesu nadrzędnego
+template <typename Fn>
+static void measure(int out, const char *dataset, const char *operation, uint32_t rows, Fn fn) {
+  simResetSdCounters();
+  tft.resetSpiCounters();
+  uint64_t virtualStart = simNowMicros();
+  auto hostStart = std::chrono::steady_clock::now();
+  fn();
+  auto hostEnd = std::chrono::steady_clock::now();
+  BenchResult r = {};
+  snprintf(r.dataset, sizeof(r.dataset), "%s", dataset);
+  snprintf(r.operation, sizeof(r.operation), "%s", operation);
+  r.rows = rows;
+  r.hostMs = std::chrono::duration<double, std::milli>(hostEnd - hostStart).count();
+  r.virtualMs = (simNowMicros() - virtualStart) / 1000.0;
+  r.sdBytes = simSdBytesRead();
+  r.sdBlocks = simSdBlockReads();
+  r.spiBytes = tft.spiBytes();
+  r.spiTransactions = tft.spiTransactions();
+  if (write(out, &r, sizeof(r)) != (ssize_t)sizeof(r)) _exit(1);
+}
+
+// Operacje mierzone na jednym zestawie (w procesie potomnym)
+// Średnia z ostatnich 7 dni przez silnik agregacji (jak ekran tygodnia)
+static SensorData weeklyAverage() {
+  AggWindow week;
+  aggWindowDays(week, clockDay(), 0, 7);
+  runAggregation(&week, 1, NULL);
+  return aggWindowMean(week);
+}
+
+static void runDataset(int out, const char *dir, const char *name, uint32_t rows, uint32_t lastMonthRows) {
+  simSetRootDir(dir);
+  simSetClock(BENCH_END);
+  simSetSensorConstant(21.5f, 45.0f, 1013.0f);
+  simResetSdCounters();
+
+  // Start: sprawdzenie i budowa indeksu dni.idx, konwersja do dane.bin, wypełnienie bufora, pierwszy ekran
+  measure(out, name, "start", rows, [] { setup(); });
+
+  // Przeszukanie pliku CSV miesiąca (dawna ścieżka ekranów ze średnimi)
+  measure(out, name, "csv_dzis", lastMonthRows, [] { calculateAverageFromCSV(0); });
+  measure(out, name, "csv_wczoraj", lastMonthRows, [] { calculateAverageFromCSV(1); });
+
+  // Średnia tygodniowa przez silnik agregacji: z bufora RAM, a po jego wyłączeniu z indeksu dni.idx
+  measure(out, name, "tydzien_bufor", 0, [] { weeklyAverage(); });
+  bool savedComplete = ringComplete;
+  uint8_t savedCount = ringCount;
+  ringComplete = false;
+  ringCount = 0;
+  ringEvictedDay = 0xFFFF;
+  measure(out, name, "tydzien_indeks", 0, [] { weeklyAverage(); });
+
+  // Profil dobowy z 30 dni - wymaga pojedynczych pomiarów (dziennik binarny lub plik CSV)
+  measure(out, name, "profil30", 0, [] {
+    AggWindow month;
+    HourProfile profile;
+    uint16_t today = clockDay();
+    aggWindowDays(month, today, 0, 30);
+    hourProfileInit(profile, today, 30);
+    runAggregation(&month, 1, &profile);
+  });
+  // Ten sam profil z plików CSV (bez dziennika binarnego) - porównanie bajtów odczytanych z karty
+  bool savedReady = binLogReady;
+  binLogReady = false;
+  measure(out, name, "profil30_csv", 0, [] {
+    AggWindow month;
+    HourProfile profile;
+    uint16_t today = clockDay();
+    aggWindowDays(month, today, 0, 30);
+    hourProfileInit(profile, today, 30);
+    runAggregation(&month, 1, &profile);
+  });
+  binLogReady = savedReady;
+  ringComplete = savedComplete;
+  ringCount = savedCount;
+  ringEvictedDay = 0;
+
+  // Zapytanie o jeden kanał z 30 dni (polecenie "kanal"): tylko kolumny czasu i temperatury z dane.bin
+  measure(out, name, "kanal30", 0, [] {
+    DateTime from(BENCH_END.unixtime() - 29 * 86400UL);
+    char command[40];
+    snprintf(command, sizeof(command), "Temp %04u-%02u-%02u %04u-%02u-%02u", from.year(), from.month(), from.day(),
+             BENCH_END.year(), BENCH_END.month(), BENCH_END.day());
+    printChannelDays(command);
+  });
+
+  // Ścieżki rysowania: przejście przez wszystkie ekrany (setup() narysował już ekran 0) i powrót na ekran
+  // bieżących danych, a na koniec ponowne odświeżenie bez zmian. Ekran, który dzieli rysowanie na przebiegi
+  // (wykres), jest mierzony do końca - z przebiegami zadania rysowania, które go dokańczają.
+  static const char *const screenOps[screenCount] = {"ekran_biezace", "ekran_dzis", "ekran_wczoraj", "ekran_tydzien",
+                                                     "ekran_30dni", "ekran_wykres"};
+  for (int i = 1; i <= screenCount; i++) {
+    int index = i % screenCount;
+    measure(out, name, screenOps[index], 0, [index] {
+      displayDirty = false;
+      updateDisplayForScreenIndex(index);
+      while (displayDirty) renderTask();
+    });
+  }
+  measure(out, name, "ekran_bez_zmian", 0, [] { updateDisplayForScreenIndex(0); });
+}
+
+// Wczytanie raportu odniesienia: klucz "zestaw operacja" -> (ms_wirt, SD_B)
+static bool loadBaseline(const char *path, std::map<std::string, std::pair<double, double>> &baseline) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[256], dataset[32], operation[32];
+  char rows[16], rowsPerS[16];
+  double hostMs, virtualMs, sdBytes;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%31s %31s %15s %lf %15s %lf %lf", dataset, operation, rows, &hostMs, rowsPerS, &virtualMs,
+               &sdBytes) == 7) {
+      baseline[std::string(dataset) + " " + operation] = {virtualMs, sdBytes};
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void printRatio(double now, double before) {
+  if (before > 0) printf(" %7.2fx", now / before);
+  else printf(" %8s", now > 0 ? "nowe" : "-");
+}
+
+int main(int argc, char **argv) {
+  const char *root = "build/bench-data", *baselinePath = nullptr;
+  double corruptPercent = 1.0;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:c:S:b:")) != -1) {
+    switch (opt) {
+      case 'r': root = optarg; break;
+      case 'c': corruptPercent = atof(optarg); break;
+      case 'S': rngState = (uint32_t)strtoul(optarg, nullptr, 10) | 1; break;
+      case 'b': baselinePath = optarg; break;
+      default:
+        fprintf(stderr, "Użycie: %s [-r katalog] [-c procent_uszkodzonych] [-S ziarno] [-b raport_odniesienia]\n",
+                argv[0]);
+        return 2;
+    }
+  }
+
+  std::map<std::string, std::pair<double, double>> baseline;
+  if (baselinePath && !loadBaseline(baselinePath, baseline)) {
+    fprintf(stderr, "Nie można wczytać raportu odniesienia %s\n", baselinePath);
+    return 1;
+  }
+
+  printf("# Uszkodzone linie: %.2f%%, ziarno: %u\n", corruptPercent, rngState);
+  printf("# %-8s %-17s %8s %9s %11s %9s %10s %8s %8s %7s%s\n", "zestaw", "operacja", "wiersze", "ms_host", "wiersze/s",
+         "ms_wirt", "SD_B", "SD_bloki", "SPI_B", "SPI_tr", baselinePath ? "  wirt/odn   SD/odn" : "");
+  for (const Dataset &ds : DATASETS) {
+    std::string dir = std::string(root) + "/" + ds.name;
+    if (system(("rm -rf '" + dir + "' && mkdir -p '" + dir + "'").c_str()) != 0) {
+      fprintf(stderr, "Nie można przygotować katalogu %s\n", dir.c_str());
+      return 1;
+    }
+    uint32_t lastMonthRows = 0;
+    uint32_t rows = generateLog(dir.c_str(), ds.days, corruptPercent, lastMonthRows);
+
+    int fds[2];
+    if (pipe(fds) != 0) return 1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      simSerialOutput(fopen("/dev/null", "w"));
+      runDataset(fds[1], dir.c_str(), ds.name, rows, lastMonthRows);
+      close(fds[1]);
+      _exit(0);
+    }
+    close(fds[1]);
+    BenchResult r;
+    while (read(fds[0], &r, sizeof(r)) == (ssize_t)sizeof(r)) {
+      char rows[12] = "-", rowsPerS[16] = "-";
+      if (r.rows > 0) {
+        snprintf(rows, sizeof(rows), "%u", r.rows);
+        snprintf(rowsPerS, sizeof(rowsPerS), "%.0f", r.rows / (r.hostMs / 1000.0));
+      }
+      printf("  %-8s %-17s %8s %9.2f %11s %9.1f %10llu %8llu %8u %7u", r.dataset, r.operation, rows, r.hostMs, rowsPerS,
+             r.virtualMs, (unsigned long long)r.sdBytes, (unsigned long long)r.sdBlocks, r.spiBytes,
+             r.spiTransactions);
+      if (baselinePath) {
+        auto it = baseline.find(std::string(r.dataset) + " " + r.operation);
+        printRatio(r.virtualMs, it != baseline.end() ? it->second.first : 0);
+        printRatio((double)r.sdBytes, it != baseline.end() ? it->second.second : 0);
+      }
+      printf("\n");
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "Pomiar zestawu %s zakończony błędem\n", ds.name);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+// Symulacja wyświetlacza ST7735: bufor ramki 160x128 z możliwością zapisu do pliku PPM
+#pragma once
+#include <Adafruit_GFX.h>
+
+#define INITR_GREENTAB 0x00
+#define INITR_REDTAB 0x01
+#define INITR_BLACKTAB 0x02
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+class Adafruit_ST7735 : public Adafruit_GFX {
+ public:
+  Adafruit_ST7735(int8_t cs, int8_t dc, int8_t rst);
+  void initR(uint8_t options = INITR_GREENTAB);
+  void setRotation(uint8_t r) override;
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void enableDisplay(bool enable);
+  void enableSleep(bool enable);
+
+  // Rozszerzenia symulacji: dostęp do bufora ramki i liczniki transferów SPI
+  uint16_t pixelAt(int16_t x, int16_t y) const;
+  bool dumpPPM(const char *path) const;
+  uint32_t spiBytes() const { return spiBytes_; }
+  uint32_t spiTransactions() const { return spiTransactions_; }
+  void resetSpiCounters() { spiBytes_ = spiTransactions_ = 0; }
+
+ private:
+  void setWindowToPhysical(int16_t x, int16_t y, int16_t &px, int16_t &py) const;
+  uint16_t fb_[160 * 128];
+  uint32_t spiBytes_, spiTransactions_;
+  bool displayOn_;
+};
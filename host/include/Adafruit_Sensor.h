@@ -0,0 +1,3 @@
+// Symulacja biblioteki Adafruit_Sensor - tylko zgodność nagłówków
+#pragma once
+#include <Arduino.h>
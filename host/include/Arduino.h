@@ -0,0 +1,193 @@
+// Minimalna emulacja rdzenia Arduino dla kompilacji na komputerze (Linux)
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcmp_P memcmp
+#define memcpy_P memcpy
+#define PGM_P const char *
+
+// snprintf_P jak w avr-libc: %S oznacza napis w pamięci programu (w glibc %S to napis wide-char, więc format
+// jest przepisywany na %s)
+static inline int snprintf_P(char *buf, size_t size, const char *format, ...) {
+  char fmt[256];
+  size_t o = 0;
+  for (const char *p = format; *p && o < sizeof(fmt) - 1; p++) {
+    fmt[o++] = *p;
+    if (*p != '%') continue;
+    while (p[1] && strchr("-+ #0123456789.lh", p[1]) && o < sizeof(fmt) - 1) fmt[o++] = *++p; // Flagi, szerokość
+    if (p[1] && o < sizeof(fmt) - 1) fmt[o++] = *++p == 'S' ? 's' : *p;
+  }
+  fmt[o] = '\0';
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, size, fmt, args);
+  va_end(args);
+  return n;
+}
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+template <typename A, typename B> static inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B> static inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+template <typename T> static inline T constrain(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+// --- Czas i piny (symulowane) ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void attachInterrupt(uint8_t interruptNum, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+int digitalPinToInterrupt(uint8_t pin);
+static inline char *dtostrf(double val, signed char width, unsigned char prec, char *out) {
+  sprintf(out, "%*.*f", width, prec, val);
+  return out;
+}
+static inline void noInterrupts() {}
+static inline void interrupts() {}
+
+// --- Print / Stream ---
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t w = 0;
+    while (n--) w += write(*buf++);
+    return w;
+  }
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char *buf, size_t n) { return write((const uint8_t *)buf, n); }
+
+  size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC) {
+    if (base == DEC && v < 0) return print('-') + printNumber((unsigned long)(-v), base);
+    return printNumber((unsigned long)v, base);
+  }
+  size_t print(unsigned long v, int base = DEC) { return printNumber(v, base); }
+  size_t print(double v, int digits = 2) { return printFloat(v, digits); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+
+ private:
+  size_t printNumber(unsigned long n, int base) {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+      char c = n % base;
+      n /= base;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+  }
+  size_t printFloat(double number, int digits) {
+    if (isnan(number)) return print("nan");
+    if (isinf(number)) return print("inf");
+    if (number > 4294967040.0 || number < -4294967040.0) return print("ovf");
+    size_t n = 0;
+    if (number < 0.0) { n += print('-'); number = -number; }
+    double rounding = 0.5;
+    for (int i = 0; i < digits; ++i) rounding /= 10.0;
+    number += rounding;
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    n += print(intPart);
+    if (digits > 0) n += print('.');
+    while (digits-- > 0) {
+      remainder *= 10.0;
+      unsigned int toPrint = (unsigned int)remainder;
+      n += print(toPrint);
+      remainder -= toPrint;
+    }
+    return n;
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long) {}
+  size_t readBytes(char *buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int c = read();
+      if (c < 0) break;
+      buf[n++] = (char)c;
+    }
+    return n;
+  }
+  size_t readBytesUntil(char term, char *buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int c = read();
+      if (c < 0 || c == term) break;
+      buf[n++] = (char)c;
+    }
+    return n;
+  }
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud);
+  void end() {}
+  operator bool() { return true; }
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
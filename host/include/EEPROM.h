@@ -0,0 +1,26 @@
+// Symulacja wbudowanej pamięci EEPROM ATmega2560 (4 KB) z interfejsem biblioteki EEPROM Arduino
+#pragma once
+#include <Arduino.h>
+
+#define E2END 0xFFF  // Ostatni adres pamięci EEPROM (na AVR z avr/io.h)
+
+class EEPROMClass {
+ public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t value);
+  void update(int idx, uint8_t value);  // Zapis tylko wtedy, gdy wartość się zmienia (mniejsze zużycie komórek)
+  uint16_t length() { return E2END + 1; }
+
+  template <typename T> T &get(int idx, T &t) {
+    uint8_t *p = (uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) p[i] = read(idx + i);
+    return t;
+  }
+  template <typename T> const T &put(int idx, const T &t) {
+    const uint8_t *p = (const uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) update(idx + i, p[i]);
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,67 @@
+// Symulacja biblioteki RTClib (DateTime, TimeSpan, RTC_PCF8563)
+#pragma once
+#include <Arduino.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800UL
+
+class TimeSpan {
+ public:
+  TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+  TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+      : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 + (int32_t)minutes * 60 + seconds) {}
+  int16_t days() const { return _seconds / 86400L; }
+  int8_t hours() const { return _seconds / 3600 % 24; }
+  int8_t minutes() const { return _seconds / 60 % 60; }
+  int8_t seconds() const { return _seconds % 60; }
+  int32_t totalseconds() const { return _seconds; }
+  TimeSpan operator+(const TimeSpan &right) const { return TimeSpan(_seconds + right._seconds); }
+  TimeSpan operator-(const TimeSpan &right) const { return TimeSpan(_seconds - right._seconds); }
+
+ protected:
+  int32_t _seconds;
+};
+
+class DateTime {
+ public:
+  DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000);
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+  uint16_t year() const { return 2000U + yOff; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint8_t dayOfTheWeek() const;
+  uint32_t secondstime() const;
+  uint32_t unixtime() const;
+  bool isValid() const;
+  DateTime operator+(const TimeSpan &span) const { return DateTime(unixtime() + span.totalseconds()); }
+  DateTime operator-(const TimeSpan &span) const { return DateTime(unixtime() - span.totalseconds()); }
+  TimeSpan operator-(const DateTime &right) const { return TimeSpan(unixtime() - right.unixtime()); }
+  bool operator<(const DateTime &right) const { return unixtime() < right.unixtime(); }
+  bool operator==(const DateTime &right) const { return unixtime() == right.unixtime(); }
+
+ protected:
+  uint8_t yOff, m, d, hh, mm, ss;
+};
+
+enum Pcf8563SqwPinMode {
+  PCF8563_SquareWaveOFF = 0x00,
+  PCF8563_SquareWave1Hz = 0x83,
+  PCF8563_SquareWave32Hz = 0x82,
+  PCF8563_SquareWave1kHz = 0x81,
+  PCF8563_SquareWave32kHz = 0x80
+};
+
+class RTC_PCF8563 {
+ public:
+  bool begin();
+  void adjust(const DateTime &dt);
+  bool lostPower();
+  bool isrunning();
+  DateTime now();
+  void start();
+  void stop();
+  Pcf8563SqwPinMode readSqwPinMode();
+  void writeSqwPinMode(Pcf8563SqwPinMode mode);
+};
@@ -0,0 +1,62 @@
+// Symulacja karty SD: pliki trzymane są w katalogu na dysku komputera
+#pragma once
+#include <Arduino.h>
+
+#define O_READ 0x01
+#define O_RDONLY O_READ
+#define O_WRITE 0x02
+#define O_WRONLY O_WRITE
+#define O_RDWR (O_READ | O_WRITE)
+#define O_APPEND 0x04
+#define O_CREAT 0x10
+#define O_TRUNC 0x40
+
+#define FILE_READ O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+struct SimFileState;
+
+class File : public Stream {
+ public:
+  File();
+  File(const File &other);
+  File &operator=(const File &other);
+  ~File();
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(void *buf, uint16_t n);
+  void flush();
+  bool seek(uint32_t pos);
+  uint32_t position();
+  uint32_t size();
+  void close();
+  operator bool() const;
+  const char *name() const;
+  bool isDirectory();
+  File openNextFile(uint8_t mode = O_RDONLY);
+  void rewindDirectory();
+
+  // Używane tylko przez symulację
+  explicit File(SimFileState *state);
+
+ private:
+  SimFileState *state_;
+};
+
+class SDClass {
+ public:
+  bool begin(uint8_t csPin);
+  void end();
+  File open(const char *path, uint8_t mode = FILE_READ);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool mkdir(const char *path);
+  bool rmdir(const char *path);
+};
+
+extern SDClass SD;
@@ -0,0 +1,3 @@
+// Symulacja magistrali SPI - brak funkcjonalności, tylko zgodność nagłówków
+#pragma once
+#include <Arduino.h>
@@ -0,0 +1,19 @@
+// Symulacja magistrali I2C dla kompilacji na komputerze
+#pragma once
+#include <Arduino.h>
+
+class TwoWire : public Stream {
+ public:
+  void begin() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t addr);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t addr, uint8_t quantity);
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,12 @@
+// Symulacja usypiania procesora AVR (avr/sleep.h): sleep_cpu() przesuwa wirtualny czas do przerwania budzącego
+#pragma once
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_SAVE 3
+#define SLEEP_MODE_PWR_DOWN 2
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_cpu();
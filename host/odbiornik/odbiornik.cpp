@@ -0,0 +1,346 @@
+// Odbiornik dziennika pobieranego ze stacji przez port szeregowy (polecenia "lista" i "pobierz" szkicu)
+//
+// Użycie: odbiornik -p PORT [-b PRĘDKOŚĆ] -l
+//         odbiornik -p PORT [-b PRĘDKOŚĆ] -o PLIK.csv OD DO
+//   -p PORT      port szeregowy stacji (np. /dev/ttyACM0 albo łącze pseudoterminala z "stacja -t")
+//   -b PRĘDKOŚĆ  prędkość portu (domyślnie 500000, jak SERIAL_BAUD w szkicu)
+//   -l           wypisanie plików miesięcy na karcie stacji
+//   -o PLIK.csv  zapis rekordów z dni OD..DO (RRRR-MM-DD) w formacie plików CSV stacji. Jeśli plik już istnieje,
+//                pobieranie jest wznawiane od rekordu po ostatnim zapisanym wierszu
+//   -w SEKUNDY   czas oczekiwania na kolejną ramkę, po którym pobieranie jest wznawiane (domyślnie 3)
+//
+// Przed pobieraniem odbiornik wysyła "lista" i z wierszy "kanal KOLUMNA SKALA" poznaje kanały stacji (liczbę wartości
+// w rekordzie, ich skale i nagłówek kolumn pliku CSV); stacja bez tych wierszy ma trzy kanały: temperaturę,
+// wilgotność i ciśnienie. Ramki z błędem CRC są pomijane; przerwa w numeracji rekordów, brak ramek przez czas -w albo ramka końca
+// przed odebraniem wszystkich rekordów powodują ponowne polecenie "pobierz" od pierwszego brakującego rekordu.
+// Komunikaty tekstowe stacji wysyłane między ramkami trafiają na stderr.
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Układ ramki jak w szkicu (ExportFrameHeader, BinLogRecord; liczby od młodszego bajtu)
+static const uint8_t SYNC0 = 0xA5, SYNC1 = 0x5A;
+static const size_t HEADER_SIZE = 8;       // Znacznik (2), rodzaj (1), liczba rekordów (1), numer (4)
+static const uint8_t MAX_RECORDS = 24;     // EXPORT_FRAME_RECORDS
+static const size_t MAX_CHANNELS = 16;     // Najwięcej kanałów w rekordzie
+static const time_t EPOCH_2000 = 946684800; // Sekundy od 1970-01-01 do 2000-01-01
+static const int MAX_RETRIES = 10;          // Najwięcej wznowień jednego pobierania
+
+// Kanały rekordu (z wierszy "kanal" polecenia "lista"); rekord to czas (4) i po 2 bajty na kanał
+struct Channel {
+  std::string column;  // Nazwa kolumny w pliku CSV
+  int scale;           // Mnożnik wartości stałoprzecinkowej
+};
+static Channel channels[MAX_CHANNELS] = {{"Temperature", 100}, {"Humidity", 100}, {"Pressure", 10}};
+static size_t channelCount = 3;
+static size_t recordSize() { return 4 + 2 * channelCount; }
+
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static int16_t get16(const uint8_t *p) { return (int16_t)(p[0] | (p[1] << 8)); }
+
+static uint16_t crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static speed_t baudConstant(long baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+  }
+  return 0;
+}
+
+// Otwarcie portu w trybie surowym (bez echa i edycji linii) z podaną prędkością
+static int openPort(const char *path, long baud) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) return -1;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    speed_t speed = baudConstant(baud);
+    if (speed) cfsetspeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIFLUSH); // Komunikaty wysłane przed otwarciem portu nie są potrzebne
+  return fd;
+}
+
+static bool sendCommand(int fd, const std::string &command) {
+  std::string line = command + "\n";
+  return write(fd, line.data(), line.size()) == (ssize_t)line.size();
+}
+
+// Bufor odbiorczy: bajty z portu, z których wycinane są ramki i linie tekstu
+struct Receiver {
+  int fd;
+  std::string buf;
+  std::string text;  // Niepełna linia tekstu stacji
+  int waitMs;
+};
+
+// Dołożenie bajtów z portu; zwraca false po upływie waitMs bez żadnego bajtu
+static bool receive(Receiver &r) {
+  struct pollfd p = {r.fd, POLLIN, 0};
+  int ready = poll(&p, 1, r.waitMs);
+  if (ready <= 0) return false;
+  char chunk[4096];
+  ssize_t n = read(r.fd, chunk, sizeof(chunk));
+  if (n <= 0) return false;
+  r.buf.append(chunk, (size_t)n);
+  return true;
+}
+
+// Bajt spoza ramek - część komunikatu tekstowego stacji
+static void textByte(Receiver &r, char c, bool echo) {
+  if (c == '\n') {
+    if (echo && !r.text.empty()) fprintf(stderr, "stacja: %s\n", r.text.c_str());
+    r.text.clear();
+  } else if (c != '\r') {
+    r.text += c;
+  }
+}
+
+// Wycięcie z bufora następnej poprawnej ramki; false, jeśli w buforze nie ma jeszcze całej ramki
+static bool nextFrame(Receiver &r, std::string &frame) {
+  size_t i = 0;
+  while (i + 1 < r.buf.size()) {
+    const uint8_t *p = (const uint8_t *)r.buf.data() + i;
+    if (p[0] != SYNC0 || p[1] != SYNC1) {
+      textByte(r, r.buf[i++], true);
+      continue;
+    }
+    if (r.buf.size() - i < HEADER_SIZE) break;
+    uint8_t count = p[3];
+    char type = (char)p[2];
+    if (count > MAX_RECORDS || !strchr("SDEB", type)) { // Przypadkowy znacznik w tekście
+      textByte(r, r.buf[i++], true);
+      continue;
+    }
+    size_t length = HEADER_SIZE + count * recordSize() + 2;
+    if (r.buf.size() - i < length) break;
+    uint16_t crc = p[length - 2] | (p[length - 1] << 8);
+    if (crc16(p, length - 2) != crc) { // Uszkodzona ramka - szukaj następnego znacznika
+      textByte(r, r.buf[i++], false);
+      continue;
+    }
+    frame.assign(r.buf, i, length);
+    r.buf.erase(0, i + length);
+    return true;
+  }
+  r.buf.erase(0, i);
+  return false;
+}
+
+static void writeRecord(FILE *out, const uint8_t *rec) {
+  time_t t = (time_t)get32(rec) + EPOCH_2000;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  fprintf(out, "%04d-%02d-%02d, %02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+          tm.tm_sec);
+  for (size_t ch = 0; ch < channelCount; ch++) fprintf(out, ", %.2f", (double)get16(rec + 4 + 2 * ch) / channels[ch].scale);
+  fprintf(out, "\r\n");
+}
+
+// Nagłówek kolumn jak w plikach CSV stacji
+static void writeHeader(FILE *out) {
+  fprintf(out, "Date, Time");
+  for (size_t ch = 0; ch < channelCount; ch++) fprintf(out, ", %s", channels[ch].column.c_str());
+  fprintf(out, "\r\n");
+}
+
+// Przygotowanie pliku wyjściowego: obcięcie niepełnej ostatniej linii i policzenie zapisanych rekordów
+static FILE *openOutput(const char *path, uint32_t &records) {
+  records = 0;
+  FILE *f = fopen(path, "r+b");
+  if (!f) {
+    f = fopen(path, "wb");
+    if (f) writeHeader(f);
+    return f;
+  }
+  long lastEnd = 0, pos = 0;
+  uint32_t lines = 0;
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    pos++;
+    if (c == '\n') {
+      lines++;
+      lastEnd = pos;
+    }
+  }
+  if (ftruncate(fileno(f), lastEnd) != 0) {
+    fclose(f);
+    return nullptr;
+  }
+  fseek(f, lastEnd, SEEK_SET);
+  records = lines > 0 ? lines - 1 : 0; // Bez nagłówka kolumn
+  if (lines == 0) writeHeader(f);
+  return f;
+}
+
+// Polecenie "lista": wypisanie plików (print) i odczyt kanałów stacji
+static int listFiles(Receiver &r, bool print) {
+  if (!sendCommand(r.fd, "lista")) return 1;
+  size_t found = 0;
+  for (;;) {
+    size_t nl;
+    while ((nl = r.buf.find('\n')) == std::string::npos) {
+      if (!receive(r)) {
+        fprintf(stderr, "Brak odpowiedzi stacji\n");
+        return 1;
+      }
+    }
+    std::string line = r.buf.substr(0, nl);
+    r.buf.erase(0, nl + 1);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    char column[32];
+    int scale;
+    if (line.compare(0, 5, "plik ") == 0 || line.compare(0, 9, "dziennik ") == 0) {
+      if (print) printf("%s\n", line.c_str());
+    } else if (sscanf(line.c_str(), "kanal %31s %d", column, &scale) == 2 && scale > 0 && found < MAX_CHANNELS) {
+      if (print) printf("%s\n", line.c_str());
+      channels[found++] = {column, scale};
+    } else if (line.compare(0, 7, "koniec ") == 0) {
+      if (found > 0) channelCount = found; // Bez wierszy "kanal" - trzy kanały starszych wersji szkicu
+      return 0;
+    } else if (!line.empty()) {
+      fprintf(stderr, "stacja: %s\n", line.c_str());
+    }
+  }
+}
+
+static int download(Receiver &r, const char *path, const char *from, const char *to) {
+  if (listFiles(r, false) != 0) return 1; // Kanały stacji - układ rekordów i kolumn pliku
+  uint32_t received;
+  FILE *out = openOutput(path, received);
+  if (!out) {
+    fprintf(stderr, "Nie można otworzyć pliku %s\n", path);
+    return 1;
+  }
+  if (received > 0) fprintf(stderr, "Wznowienie od rekordu %u\n", received);
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint32_t total = 0, start = received;
+  bool started = false;
+  int retries = 0;
+  std::string frame;
+  for (;;) {
+    // (Ponowne) polecenie pobierania od pierwszego brakującego rekordu
+    char command[64];
+    snprintf(command, sizeof(command), "pobierz %s %s %u", from, to, received);
+    if (!sendCommand(r.fd, command)) break;
+    bool resume = false;
+    while (!resume) {
+      if (!nextFrame(r, frame)) {
+        if (!receive(r)) {
+          fprintf(stderr, "Brak ramek przez %d ms\n", r.waitMs);
+          resume = true;
+        }
+        continue;
+      }
+      const uint8_t *p = (const uint8_t *)frame.data();
+      uint8_t count = p[3];
+      uint32_t index = get32(p + 4);
+      switch (p[2]) {
+        case 'S':
+          total = index;
+          if (!started) fprintf(stderr, "Rekordów w zakresie: %u\n", total);
+          started = true;
+          break;
+        case 'D':
+          if (index > received) { // Zgubiona ramka
+            fprintf(stderr, "Przerwa w danych (rekord %u zamiast %u)\n", index, received);
+            resume = true;
+            break;
+          }
+          for (uint8_t k = 0; k < count; k++) {
+            if (index + k < received) continue; // Rekord już zapisany (ramka powtórzona po wznowieniu)
+            writeRecord(out, p + HEADER_SIZE + k * recordSize());
+            received++;
+          }
+          fflush(out);
+          break;
+        case 'E':
+          if (received >= index) {
+            fclose(out);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+            uint32_t sent = received - start;
+            fprintf(stderr, "Odebrano rekordów: %u (%.1f s, %.0f B/s danych)\n", sent, s,
+                    s > 0 ? sent * recordSize() / s : 0.0);
+            return 0;
+          }
+          resume = true;
+          break;
+        case 'B':
+          fprintf(stderr, "Stacja odrzuciła pobieranie\n");
+          fclose(out);
+          return 1;
+      }
+    }
+    if (++retries > MAX_RETRIES) break;
+    sendCommand(r.fd, "przerwij");
+    usleep(100000);
+    tcflush(r.fd, TCIFLUSH); // Odrzuć resztę przerwanego pobierania
+    r.buf.clear();
+    fprintf(stderr, "Wznowienie od rekordu %u (próba %d)\n", received, retries);
+  }
+  fclose(out);
+  fprintf(stderr, "Pobieranie przerwane po %u z %u rekordów - uruchom ponownie, aby wznowić\n", received, total);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  const char *port = nullptr, *output = nullptr;
+  long baud = 500000;
+  bool list = false;
+  int waitMs = 3000;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:b:lo:w:")) != -1) {
+    switch (opt) {
+      case 'p': port = optarg; break;
+      case 'b': baud = atol(optarg); break;
+      case 'l': list = true; break;
+      case 'o': output = optarg; break;
+      case 'w': waitMs = (int)(atof(optarg) * 1000); break;
+      default: port = nullptr; optind = argc + 1; break;
+    }
+  }
+  if (!port || (!list && (!output || argc - optind != 2))) {
+    fprintf(stderr, "Użycie: %s -p port [-b prędkość] -l\n"
+                    "       %s -p port [-b prędkość] [-w sekundy] -o plik.csv RRRR-MM-DD RRRR-MM-DD\n",
+            argv[0], argv[0]);
+    return 2;
+  }
+  int fd = openPort(port, baud);
+  if (fd < 0) {
+    fprintf(stderr, "Nie można otworzyć portu %s: %s\n", port, strerror(errno));
+    return 1;
+  }
+  Receiver r = {fd, "", "", waitMs};
+  int status = list ? listFiles(r, true) : download(r, output, argv[optind], argv[optind + 1]);
+  close(fd);
+  return status;
+}
@@ -0,0 +1,101 @@
+#!/bin/sh
+# Raport zajętości pamięci RAM i Flash z pliku ELF, z podziałem na moduły (szkic, rdzeń, biblioteki)
+#
+# Użycie: pamiec.sh PLIK.elf [N]
+#   PLIK.elf  program z kompilacji Arduino (np. arduino-cli compile --build-path build-avr ... - plik
+#             build-avr/Main_project.ino.elf) albo build/stacja z kompilacji na komputerze
+#   N         liczba największych zmiennych w pamięci RAM na liście (domyślnie 15)
+#
+# Moduł symbolu jest ustalany z informacji o źródle (opcja -g, domyślna w kompilacji Arduino): szkic, rdzeń
+# Arduino, katalog biblioteki albo symulacja. Na AVR pamięć RAM zajmują sekcje .data (także stałe bez PROGMEM
+# i literały napisów bez F() - są kopiowane z Flash przy starcie) i .bss, a Flash - .text (z tablicami PROGMEM)
+# i wartości początkowe .data. Wiersz "bez nazwy" to dane bez symbolu, głównie literały napisów.
+# Na komputerze rozmiary są większe (wskaźniki 8 B, stałe w .rodata nie zajmują RAM) - liczy się różnica między
+# kolejnymi wersjami szkicu. Narzędzia: zmienne NM i SIZE (domyślnie avr-nm/avr-size dla AVR, inaczej nm/size).
+
+ELF=$1
+TOP=${2:-15}
+if [ -z "$ELF" ] || [ ! -f "$ELF" ]; then
+  echo "Użycie: $0 PLIK.elf [N]" >&2
+  exit 2
+fi
+
+AVR=0
+if readelf -h "$ELF" 2>/dev/null | grep -q "Atmel AVR"; then AVR=1; fi
+if [ $AVR = 1 ]; then
+  NM=${NM:-avr-nm}
+  SIZE=${SIZE:-avr-size}
+else
+  NM=${NM:-nm}
+  SIZE=${SIZE:-size}
+fi
+
+# Rozmiary sekcji (size -A: nazwa, rozmiar, adres)
+SECTIONS=$($SIZE -A "$ELF") || exit 1
+
+# Symbole z rozmiarem: adres, rozmiar, typ, nazwa, tabulator, plik:linia
+$NM -S -l -C -t d --size-sort "$ELF" | awk -v avr=$AVR -v top="$TOP" -v sections="$SECTIONS" '
+function module(src) {
+  if (src == "") return "inne (biblioteka C, bez informacji o zrodle)"
+  if (src ~ /Main_project/ || src ~ /\/sketch\//) return "szkic"
+  if (match(src, /\/libraries\/[^\/]+\//)) return "biblioteka " substr(src, RSTART + 11, RLENGTH - 12)
+  if (src ~ /\/cores\//) return "rdzen Arduino"
+  if (src ~ /\/host\/sim\//) return "symulacja"
+  if (src ~ /\/host\/include\//) return "zamienniki bibliotek"
+  return "inne (biblioteka C, bez informacji o zrodle)"
+}
+BEGIN {
+  n = split(sections, lines, "\n")
+  for (i = 1; i <= n; i++) {
+    split(lines[i], f, " ")
+    if (f[1] == ".data" || f[1] == ".bss" || f[1] == ".noinit" || f[1] == ".text" || f[1] == ".rodata") sec[f[1]] = f[2]
+  }
+}
+{
+  tab = index($0, "\t")
+  src = tab ? substr($0, tab + 1) : ""
+  sub(/:[0-9]+$/, "", src)
+  head = tab ? substr($0, 1, tab - 1) : $0
+  split(head, f, " ")
+  size = f[2] + 0; type = tolower(f[3])
+  name = head; sub(/^[^ ]+ [^ ]+ [^ ]+ /, "", name)
+  m = module(src)
+  mods[m] = 1
+  ram = 0; flash = 0
+  if (type == "b") ram = size
+  else if (type == "d") { ram = size; flash = size }
+  else if (type == "r") { if (avr) ram = size; flash = size }
+  else if (type == "t" || type == "w") flash = size
+  else next
+  modRam[m] += ram; modFlash[m] += flash
+  if (type == "d") namedData += size
+  if (type == "r") namedConst += size
+  if (ram > 0) { count++; varSize[count] = ram; varName[count] = name; varMod[count] = m }
+}
+END {
+  ramTotal = sec[".data"] + sec[".bss"] + sec[".noinit"]
+  flashTotal = sec[".text"] + sec[".data"] + sec[".rodata"]
+  # Dane bez symbolu: na AVR w .data (RAM i Flash), na komputerze w .rodata (tylko Flash)
+  unnamedRam = avr ? sec[".data"] - namedData - namedConst : 0
+  unnamedFlash = avr ? unnamedRam : sec[".rodata"] - namedConst
+  printf "%-46s %8s %8s\n", "Modul", "RAM", "Flash"
+  for (m in mods) printf "%-46s %8d %8d\n", m, modRam[m], modFlash[m] | "sort"
+  close("sort")
+  printf "%-46s %8d %8d\n", "bez nazwy (literaly napisow)", unnamedRam, unnamedFlash
+  printf "%-46s %8d %8d\n", "Razem (sekcje)", ramTotal, flashTotal
+  if (avr) {
+    printf "ATmega2560: RAM %d z 8192 B (%.0f%%), na stos i sterte zostaje %d B; Flash %d z 253952 B (%.0f%%)\n",
+           ramTotal, 100 * ramTotal / 8192, 8192 - ramTotal, flashTotal, 100 * flashTotal / 253952
+  }
+  printf "\nNajwieksze zmienne w pamieci RAM:\n"
+  for (i = 1; i <= count; i++) order[i] = i
+  for (i = 2; i <= count; i++) {  # Sortowanie malejąco po rozmiarze (lista ma kilkaset pozycji)
+    k = order[i]; j = i - 1
+    while (j > 0 && varSize[order[j]] < varSize[k]) { order[j + 1] = order[j]; j-- }
+    order[j + 1] = k
+  }
+  for (i = 1; i <= count && i <= top; i++) {
+    k = order[i]
+    printf "%8d  %-40s %s\n", varSize[k], substr(varName[k], 1, 40), varMod[k]
+  }
+}'
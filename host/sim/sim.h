@@ -0,0 +1,40 @@
+// Interfejs sterowania symulacją (używany przez program hosta, niedostępny na urządzeniu)
+#pragma once
+#include <Arduino.h>
+#include <RTClib.h>
+
+void simAdvanceMicros(uint64_t us);
+uint64_t simNowMicros();
+void simSetPin(uint8_t pin, int level);
+void simSerialInput(const char *text);
+void simSerialOutput(FILE *out);
+void simSerialPort(int fd);  // Port szeregowy przez pseudoterminal (fd strony nadrzędnej) z czasem nadawania bajtów
+void simSetWakeLimit(uint64_t at);  // Najpóźniejsze wybudzenie z uśpienia (czas simNowMicros)
+uint64_t simSleptMicros();          // Łączny czas uśpienia procesora w trybie power-down
+uint32_t simSleepCount();           // Liczba uśpień procesora
+
+void simSetRootDir(const char *dir);
+void simSetCardPresent(bool present);
+uint64_t simSdBytesRead();
+uint64_t simSdBytesWritten();
+uint64_t simSdBlockReads();
+void simResetSdCounters();
+
+bool simEepromLoad(const char *path);  // Zawartość pamięci EEPROM z pliku (brak pliku - pamięć skasowana)
+bool simEepromSave(const char *path);
+uint32_t simEepromBytesWritten();
+
+void simSetClock(const DateTime &dt);
+uint32_t simClockReads();
+void simRtcWriteRegister(uint8_t reg, uint8_t value);  // Rejestry sterujące PCF8563 (licznik czasu, przerwania)
+uint8_t simRtcReadRegister(uint8_t reg);
+uint64_t simRtcTimerDue();  // Czas (simNowMicros) najbliższego doliczenia licznika do zera lub UINT64_MAX
+void simRtcPoll();          // Ustawienie flagi i wyjścia INT po doliczeniu licznika do zera
+
+struct SimSample {
+  uint32_t unixtime;
+  float temperature, humidity, pressure;
+};
+uint32_t simI2cTransactions();
+bool simLoadSensorTrace(const char *path);
+void simSetSensorConstant(float temperature, float humidity, float pressure);
@@ -0,0 +1,181 @@
+// Symulacja czujnika BME280: stałe wartości albo odtwarzanie zapisanego przebiegu
+#include <Adafruit_BME280.h>
+#include <Wire.h>
+#include "sim.h"
+
+#include <vector>
+
+static std::vector<SimSample> trace;
+static float constTemp = 21.5f, constHum = 45.0f, constPress = 1013.0f;
+
+bool simLoadSensorTrace(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  trace.clear();
+  SimSample s;
+  unsigned long t;
+  while (fscanf(f, "%lu,%f,%f,%f", &t, &s.temperature, &s.humidity, &s.pressure) == 4) {
+    s.unixtime = (uint32_t)t;
+    trace.push_back(s);
+  }
+  fclose(f);
+  return !trace.empty();
+}
+
+void simSetSensorConstant(float temperature, float humidity, float pressure) {
+  trace.clear();
+  constTemp = temperature;
+  constHum = humidity;
+  constPress = pressure;
+}
+
+static uint32_t i2cTransactions = 0;
+static void simI2cCount(uint32_t n) { i2cTransactions += n; }
+static SimSample currentSample() {
+  SimSample s = {0, constTemp, constHum, constPress};
+  if (trace.empty()) return s;
+  uint32_t now = RTC_PCF8563().now().unixtime();
+  size_t lo = 0, hi = trace.size();
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (trace[mid].unixtime <= now) lo = mid; else hi = mid;
+  }
+  return trace[lo];
+}
+
+// Czujnik odpowiada pod oboma adresami BME280 (drugi czujnik, np. zewnętrzny, to 0x77 - wyjście SDO w stanie wysokim);
+// oba mają te same rejestry i podają te same wartości
+static bool isBmeAddr(uint8_t addr) { return addr == 0x76 || addr == 0x77; }
+
+bool Adafruit_BME280::begin(uint8_t addr) {
+  addr_ = addr;
+  return isBmeAddr(addr);
+}
+void Adafruit_BME280::setSampling(sensor_mode, sensor_sampling, sensor_sampling, sensor_sampling, sensor_filter,
+                                  standby_duration) {}
+bool Adafruit_BME280::takeForcedMeasurement() {
+  simI2cCount(4);  // Zapis ctrl_meas + odpytanie rejestru stanu
+  simAdvanceMicros(8000);
+  return true;
+}
+float Adafruit_BME280::readTemperature() {
+  simI2cCount(2);  // Adres rejestru + odczyt 3 bajtów
+  simAdvanceMicros(400);
+  return currentSample().temperature;
+}
+float Adafruit_BME280::readPressure() {
+  simI2cCount(4);  // Ponowny odczyt temperatury + ciśnienie
+  simAdvanceMicros(800);
+  return currentSample().pressure * 100.0f;
+}
+float Adafruit_BME280::readHumidity() {
+  simI2cCount(4);  // Ponowny odczyt temperatury + wilgotność
+  simAdvanceMicros(800);
+  return currentSample().humidity;
+}
+float Adafruit_BME280::readAltitude(float seaLevel) {
+  float atmospheric = readPressure() / 100.0F;
+  return 44330.0 * (1.0 - pow(atmospheric / seaLevel, 0.1903));
+}
+
+// Magistrala I2C z modelem rejestrów BME280 (kalibracja i rejestry pomiarowe 0xF7-0xFE); zapisy i odczyty pod
+// adresem zegara PCF8563 trafiają do jego modelu w sim_rtc.cpp (odczyt czasu idzie przez RTC_PCF8563::now())
+static const uint8_t RTC_ADDR = 0x51;
+TwoWire Wire;
+static uint8_t regs[256];
+static bool regsReady = false;
+static uint8_t txAddr = 0, regPtr = 0;
+static bool txHasReg = false;
+static uint8_t rxBuf[64];
+static uint8_t rxLen = 0, rxPos = 0;
+uint32_t simI2cTransactions() { return i2cTransactions; }
+
+// Przykładowe współczynniki kalibracyjne (BMP280 z noty katalogowej + typowe wartości wilgotności)
+static const uint16_t T1 = 27504; static const int16_t T2 = 26435, T3 = -1000;
+static const uint16_t P1 = 36477; static const int16_t P2 = -10685, P3 = 3024, P4 = 2855, P5 = 140, P6 = -7,
+                                                      P7 = 15500, P8 = -14600, P9 = 6000;
+static const uint8_t H1 = 75; static const int16_t H2 = 362; static const uint8_t H3 = 0;
+static const int16_t H4 = 313, H5 = 50; static const int8_t H6 = 30;
+
+static void put16(uint8_t r, uint16_t v) { regs[r] = v & 0xFF; regs[r + 1] = v >> 8; }
+static void initRegs() {
+  if (regsReady) return;
+  regsReady = true;
+  put16(0x88, T1); put16(0x8A, T2); put16(0x8C, T3); put16(0x8E, P1); put16(0x90, P2); put16(0x92, P3);
+  put16(0x94, P4); put16(0x96, P5); put16(0x98, P6); put16(0x9A, P7); put16(0x9C, P8); put16(0x9E, P9);
+  regs[0xA1] = H1; put16(0xE1, H2); regs[0xE3] = H3;
+  regs[0xE4] = (H4 >> 4) & 0xFF; regs[0xE5] = (H4 & 0x0F) | ((H5 & 0x0F) << 4); regs[0xE6] = (H5 >> 4) & 0xFF;
+  regs[0xE7] = (uint8_t)H6; regs[0xD0] = 0x60;
+}
+
+static int32_t compT(int32_t adcT, int32_t &tFine) {
+  int32_t var1 = ((((adcT >> 3) - ((int32_t)T1 << 1))) * ((int32_t)T2)) >> 11;
+  int32_t var2 = (((((adcT >> 4) - ((int32_t)T1)) * ((adcT >> 4) - ((int32_t)T1))) >> 12) * ((int32_t)T3)) >> 14;
+  tFine = var1 + var2;
+  return (tFine * 5 + 128) >> 8;
+}
+static double compP(int32_t adcP, int32_t tFine) {  // Wariant double z noty - niezależny od kodu szkicu
+  double var1 = ((double)tFine / 2.0) - 64000.0;
+  double var2 = var1 * var1 * ((double)P6) / 32768.0;
+  var2 = var2 + var1 * ((double)P5) * 2.0;
+  var2 = (var2 / 4.0) + (((double)P4) * 65536.0);
+  var1 = (((double)P3) * var1 * var1 / 524288.0 + ((double)P2) * var1) / 524288.0;
+  var1 = (1.0 + var1 / 32768.0) * ((double)P1);
+  double p = 1048576.0 - (double)adcP;
+  p = (p - (var2 / 4096.0)) * 6250.0 / var1;
+  var1 = ((double)P9) * p * p / 2147483648.0;
+  var2 = p * ((double)P8) / 32768.0;
+  return p + (var1 + var2 + ((double)P7)) / 16.0;
+}
+static double compH(int32_t adcH, int32_t tFine) {
+  double h = ((double)tFine) - 76800.0;
+  h = (adcH - (((double)H4) * 64.0 + ((double)H5) / 16384.0 * h)) *
+      (((double)H2) / 65536.0 * (1.0 + ((double)H6) / 67108864.0 * h * (1.0 + ((double)H3) / 67108864.0 * h)));
+  h = h * (1.0 - ((double)H1) * h / 524288.0);
+  return h < 0 ? 0 : (h > 100 ? 100 : h);
+}
+
+// Zamiana wartości fizycznych na surowe odczyty ADC (bisekcja po monotonicznych wzorach kompensacji)
+static void encodeSample() {
+  SimSample s = currentSample();
+  int32_t lo = 0, hi = 0xFFFFF, tFine = 0;
+  while (lo < hi) { int32_t mid = (lo + hi) / 2; if (compT(mid, tFine) < lround(s.temperature * 100)) lo = mid + 1; else hi = mid; }
+  int32_t adcT = lo; compT(adcT, tFine);
+  lo = 0; hi = 0xFFFFF;
+  while (lo < hi) { int32_t mid = (lo + hi) / 2; if (compP(mid, tFine) > s.pressure * 100.0) lo = mid + 1; else hi = mid; }
+  int32_t adcP = lo;
+  lo = 0; hi = 0xFFFF;
+  while (lo < hi) { int32_t mid = (lo + hi) / 2; if (compH(mid, tFine) < s.humidity) lo = mid + 1; else hi = mid; }
+  int32_t adcH = lo;
+  regs[0xF7] = adcP >> 12; regs[0xF8] = (adcP >> 4) & 0xFF; regs[0xF9] = (adcP & 0x0F) << 4;
+  regs[0xFA] = adcT >> 12; regs[0xFB] = (adcT >> 4) & 0xFF; regs[0xFC] = (adcT & 0x0F) << 4;
+  regs[0xFD] = adcH >> 8; regs[0xFE] = adcH & 0xFF;
+}
+
+void TwoWire::beginTransmission(uint8_t addr) { txAddr = addr; txHasReg = false; }
+size_t TwoWire::write(uint8_t c) {
+  if (!txHasReg) { regPtr = c; txHasReg = true; }
+  else if (txAddr == RTC_ADDR) simRtcWriteRegister(regPtr++, c);
+  else regs[regPtr++] = c;
+  return 1;
+}
+uint8_t TwoWire::endTransmission(bool) {
+  i2cTransactions++;
+  simAdvanceMicros(200);
+  return isBmeAddr(txAddr) || txAddr == RTC_ADDR ? 0 : 2;
+}
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t quantity) {
+  if ((!isBmeAddr(addr) && addr != RTC_ADDR) || quantity > sizeof(rxBuf)) return 0;
+  initRegs();
+  if (isBmeAddr(addr) && regPtr <= 0xFE && regPtr + quantity > 0xF7) encodeSample();
+  for (uint8_t i = 0; i < quantity; i++) {
+    rxBuf[i] = addr == RTC_ADDR ? simRtcReadRegister(regPtr + i) : regs[(uint8_t)(regPtr + i)];
+  }
+  rxLen = quantity; rxPos = 0;
+  i2cTransactions++;
+  simAdvanceMicros(100 + 90 * quantity);  // 100 kHz: ok. 90 us na bajt
+  return quantity;
+}
+int TwoWire::available() { return rxLen - rxPos; }
+int TwoWire::read() { return rxPos < rxLen ? rxBuf[rxPos++] : -1; }
+int TwoWire::peek() { return rxPos < rxLen ? rxBuf[rxPos] : -1; }
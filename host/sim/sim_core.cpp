@@ -0,0 +1,178 @@
+// Symulacja rdzenia Arduino: wirtualny zegar, piny, port szeregowy
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include "sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+static uint64_t simMicros = 0;
+static int pinLevels[70];
+static void (*pinIsr[8])() = {nullptr};
+static int pinIsrMode[8];
+static std::string serialInput;
+static FILE *serialOut = stdout;
+static int serialFd = -1;          // Port szeregowy podłączony do pseudoterminala (-1 - brak)
+static std::string serialPending;  // Bajty czekające na zapis do pseudoterminala
+static unsigned long serialBaud = 9600;
+static uint64_t sleptMicros = 0;           // Czas uśpienia procesora (w trybie power-down timer millis() stoi)
+static uint64_t wakeLimit = UINT64_MAX;    // Najpóźniejsze wybudzenie (zdarzenie scenariusza, koniec symulacji)
+static bool sleepEnabled = false;
+static uint8_t sleepMode = SLEEP_MODE_IDLE;
+static uint32_t sleepCount = 0;
+
+HardwareSerial Serial;
+
+// Symbole avr-libc opisujące pamięć RAM (koniec zmiennych statycznych, koniec sterty). Na komputerze zmienne
+// statyczne i stos leżą daleko od siebie, więc koniec "sterty" jest ustawiany SIM_STACK_SIZE bajtów poniżej
+// ramki stosu z czasu inicjalizacji programu: szkic maluje i mierzy wtedy nieużywany obszar stosu procesu.
+static const size_t SIM_STACK_SIZE = 32768;
+static char *simHeapEnd() { return (char *)__builtin_frame_address(0) - SIM_STACK_SIZE; }
+char __heap_start;
+char *__brkval = simHeapEnd();
+
+void simAdvanceMicros(uint64_t us) { simMicros += us; }
+uint64_t simNowMicros() { return simMicros; }
+
+unsigned long millis() { return (unsigned long)((simMicros - sleptMicros) / 1000ULL); }
+unsigned long micros() { return (unsigned long)(simMicros - sleptMicros); }
+void delay(unsigned long ms) { simMicros += (uint64_t)ms * 1000ULL; }
+void delayMicroseconds(unsigned int us) { simMicros += us; }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < 70 && mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+int digitalRead(uint8_t pin) { return pin < 70 ? pinLevels[pin] : LOW; }
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < 70) pinLevels[pin] = value;
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+  switch (pin) {
+    case 2: return 0;
+    case 3: return 1;
+    case 21: return 2;
+    case 20: return 3;
+    case 19: return 4;
+    case 18: return 5;
+  }
+  return -1;
+}
+
+static int interruptToPin(uint8_t num) {
+  static const int pins[] = {2, 3, 21, 20, 19, 18};
+  return num < 6 ? pins[num] : -1;
+}
+
+void attachInterrupt(uint8_t num, void (*isr)(), int mode) {
+  if (num < 8) {
+    pinIsr[num] = isr;
+    pinIsrMode[num] = mode;
+  }
+}
+void detachInterrupt(uint8_t num) {
+  if (num < 8) pinIsr[num] = nullptr;
+}
+
+void simSetPin(uint8_t pin, int level) {
+  if (pin >= 70) return;
+  int old = pinLevels[pin];
+  pinLevels[pin] = level;
+  int num = digitalPinToInterrupt(pin);
+  if (num < 0 || !pinIsr[num] || old == level) return;
+  int mode = pinIsrMode[num];
+  if (mode == CHANGE || (mode == FALLING && level == LOW) || (mode == RISING && level == HIGH) ||
+      (mode == LOW && level == LOW)) {
+    pinIsr[num]();
+  }
+  (void)interruptToPin;
+}
+
+// Usypianie: w trybie power-down procesor stoi do przerwania zewnętrznego (licznik zegara PCF8563) albo do
+// zdarzenia scenariusza (np. naciśnięcia przycisku) - wirtualny czas przeskakuje do wcześniejszego z nich.
+// W trybie idle timer millis() pracuje i budzi procesor co 1 ms.
+void set_sleep_mode(uint8_t mode) { sleepMode = mode; }
+void sleep_enable() { sleepEnabled = true; }
+void sleep_disable() { sleepEnabled = false; }
+void sleep_cpu() {
+  if (!sleepEnabled) return;
+  sleepCount++;
+  uint64_t wake = std::min(wakeLimit, simRtcTimerDue());
+  if (sleepMode == SLEEP_MODE_IDLE) wake = std::min<uint64_t>(wake, simMicros + 1024);
+  if (wake > simMicros) {
+    if (sleepMode != SLEEP_MODE_IDLE) sleptMicros += wake - simMicros;
+    simMicros = wake;
+  }
+  simRtcPoll();  // Licznik zegara doliczył do zera - wyjście INT przechodzi w stan niski
+}
+void simSetWakeLimit(uint64_t at) { wakeLimit = at; }
+uint64_t simSleptMicros() { return sleptMicros; }
+uint32_t simSleepCount() { return sleepCount; }
+
+void simSerialInput(const char *text) { serialInput += text; }
+void simSerialOutput(FILE *out) { serialOut = out; }
+
+// Wysłanie zebranych bajtów do pseudoterminala. Zapis czeka, aż odbiornik zrobi miejsce w buforze, ale jeśli
+// nikt nie czyta portu, bajty przepadają jak na niepodłączonym porcie (symulacja nie zatrzymuje się).
+static void serialFlushPort() {
+  size_t done = 0;
+  while (done < serialPending.size()) {
+    ssize_t n = write(serialFd, serialPending.data() + done, serialPending.size() - done);
+    if (n > 0) {
+      done += (size_t)n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    struct pollfd p = {serialFd, POLLOUT, 0};
+    if (n < 0 && errno == EAGAIN && poll(&p, 1, 200) > 0) continue;
+    break;
+  }
+  serialPending.clear();
+}
+
+// Odczyt bajtów, które odbiornik wysłał przez pseudoterminal (bez czekania)
+static void serialPollPort() {
+  serialFlushPort();
+  struct pollfd p = {serialFd, POLLIN, 0};
+  char buf[256];
+  while (poll(&p, 1, 0) > 0 && (p.revents & POLLIN)) {
+    ssize_t n = read(serialFd, buf, sizeof(buf));
+    if (n <= 0) break;
+    serialInput.append(buf, (size_t)n);
+  }
+}
+
+void simSerialPort(int fd) {
+  if (serialFd >= 0) serialFlushPort();  // Dokończ nadawanie do poprzedniego portu
+  serialFd = fd;
+  if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void HardwareSerial::begin(unsigned long baud) { serialBaud = baud ? baud : 9600; }
+int HardwareSerial::available() {
+  if (serialFd >= 0) serialPollPort();
+  return (int)serialInput.size();
+}
+int HardwareSerial::read() {
+  if (serialInput.empty()) return -1;
+  int c = (unsigned char)serialInput[0];
+  serialInput.erase(0, 1);
+  return c;
+}
+int HardwareSerial::peek() { return serialInput.empty() ? -1 : (unsigned char)serialInput[0]; }
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialFd >= 0) {
+    // Pseudoterminal: bajt trwa 10 bitów (start, 8 bitów danych, stop) przy prędkości z Serial.begin()
+    serialPending += (char)c;
+    if (serialPending.size() >= 4096) serialFlushPort();
+    simAdvanceMicros(10000000ULL / serialBaud);
+    return 1;
+  }
+  if (serialOut) fputc(c, serialOut);
+  return 1;
+}
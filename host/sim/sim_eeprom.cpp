@@ -0,0 +1,55 @@
+// Symulacja pamięci EEPROM: 4 KB w pamięci komputera, opcjonalnie wczytywane z pliku i zapisywane do niego
+// (zawartość przetrwa "reset" stacji między kolejnymi uruchomieniami symulacji)
+#include <EEPROM.h>
+#include "sim.h"
+
+EEPROMClass EEPROM;
+
+// Model czasu: zapis bajtu (kasowanie i programowanie komórki) trwa ok. 3,3 ms, a procesor czeka na koniec
+// poprzedniego zapisu; odczyt jest praktycznie natychmiastowy
+static const uint64_t EEPROM_WRITE_US = 3400;
+static uint8_t cells[E2END + 1];
+static bool cellsErased = false;
+static uint32_t bytesWritten = 0;
+
+// Nowa pamięć EEPROM ma wszystkie komórki skasowane (0xFF)
+static void eraseOnce() {
+  if (cellsErased) return;
+  memset(cells, 0xFF, sizeof(cells));
+  cellsErased = true;
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  eraseOnce();
+  return idx >= 0 && idx <= E2END ? cells[idx] : 0xFF;
+}
+void EEPROMClass::write(int idx, uint8_t value) {
+  eraseOnce();
+  if (idx < 0 || idx > E2END) return;
+  cells[idx] = value;
+  bytesWritten++;
+  simAdvanceMicros(EEPROM_WRITE_US);
+}
+void EEPROMClass::update(int idx, uint8_t value) {
+  if (read(idx) != value) write(idx, value);
+}
+
+bool simEepromLoad(const char *path) {
+  eraseOnce();
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  bool ok = fread(cells, 1, sizeof(cells), f) == sizeof(cells);
+  fclose(f);
+  return ok;
+}
+
+bool simEepromSave(const char *path) {
+  eraseOnce();
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  bool ok = fwrite(cells, 1, sizeof(cells), f) == sizeof(cells);
+  fclose(f);
+  return ok;
+}
+
+uint32_t simEepromBytesWritten() { return bytesWritten; }
@@ -0,0 +1,242 @@
+// Program uruchamiający szkic Main_project.cpp na komputerze w wirtualnym czasie
+//
+// Użycie: stacja [opcje]
+//   -r KATALOG   katalog udający kartę SD (domyślnie sdcard)
+//   -s "RRRR-MM-DD GG:MM:SS"  czas zegara RTC przy starcie (domyślnie 2026-01-01 00:00:00)
+//   -d SEKUNDY   czas symulacji (domyślnie 60)
+//   -p MS        krok wirtualnego czasu między przebiegami loop() (domyślnie 1000 ms)
+//   -T PLIK      przebieg czujnika do odtworzenia: linie "czas_unix,temperatura,wilgotność,ciśnienie_hPa"
+//   -x PLIK      scenariusz zdarzeń: linie "SEKUNDA polecenie argumenty" (polecenia poniżej)
+//   -f PLIK.ppm  zapis końcowej zawartości wyświetlacza
+//   -e PLIK      zawartość pamięci EEPROM: wczytywana przy starcie (jeśli plik istnieje) i zapisywana na końcu
+//   -q           bez wydruku portu szeregowego
+//   -t ŁĄCZE     port szeregowy przez pseudoterminal zamiast wydruku: ŁĄCZE staje się dowiązaniem do /dev/pts/N,
+//                które program odbiornik (lub np. screen) otwiera jak port stacji. Czas wirtualny biegnie wtedy nie
+//                szybciej niż rzeczywisty, każdy bajt portu trwa tyle co przy prędkości z Serial.begin(),
+//                a domyślny krok wirtualnego czasu to 1 ms
+//
+// Polecenia scenariusza (SEKUNDA liczona od startu symulacji):
+//   press PIN [MS]               naciśnięcie przycisku na 100 ms (lub MS ms - przytrzymanie)
+//   serial TEKST                 tekst wpisany w monitorze szeregowym (z końcem linii)
+//   clock RRRR-MM-DD GG:MM:SS    przestawienie zegara RTC
+//   sensor T H P                 stałe wartości czujnika
+//   card 0|1                     wyjęcie / włożenie karty SD (w sekundzie 0 - stan karty już przy starcie)
+//   frame PLIK.ppm               zapis bieżącej zawartości wyświetlacza
+#include <Arduino.h>
+#include <RTClib.h>
+#include <Adafruit_ST7735.h>
+#include "sim.h"
+
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern Adafruit_ST7735 tft;
+
+struct ScriptEvent {
+  uint64_t at;          // Czas zdarzenia w mikrosekundach od startu
+  std::string command;  // Polecenie
+  std::string args;     // Argumenty polecenia
+};
+
+static const uint64_t PRESS_US = 100000;  // Czas trzymania przycisku
+
+static bool parseDateTime(const char *text, DateTime &out) {
+  int y, mo, d, h = 0, mi = 0, s = 0;
+  if (sscanf(text, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s) < 3) return false;
+  out = DateTime(y, mo, d, h, mi, s);
+  return out.isValid();
+}
+
+static bool loadScript(const char *path, std::vector<ScriptEvent> &events) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0') continue;
+    double at;
+    char command[32];
+    int used = 0;
+    if (sscanf(line, "%lf %31s %n", &at, command, &used) < 2) continue;
+    events.push_back({(uint64_t)(at * 1e6), command, used ? line + used : ""});
+  }
+  fclose(f);
+  std::stable_sort(events.begin(), events.end(),
+                   [](const ScriptEvent &a, const ScriptEvent &b) { return a.at < b.at; });
+  return true;
+}
+
+static void runEvent(const ScriptEvent &e, std::vector<std::pair<uint64_t, int>> &releases, uint64_t now) {
+  if (e.command == "press") {
+    int pin = 0, ms = 0;
+    sscanf(e.args.c_str(), "%d %d", &pin, &ms);
+    simSetPin(pin, LOW);
+    releases.push_back({now + (ms > 0 ? (uint64_t)ms * 1000 : PRESS_US), pin});
+  } else if (e.command == "serial") {
+    simSerialInput((e.args + "\n").c_str());
+  } else if (e.command == "clock") {
+    DateTime dt;
+    if (parseDateTime(e.args.c_str(), dt)) simSetClock(dt);
+  } else if (e.command == "sensor") {
+    float t, h, p;
+    if (sscanf(e.args.c_str(), "%f %f %f", &t, &h, &p) == 3) simSetSensorConstant(t, h, p);
+  } else if (e.command == "card") {
+    simSetCardPresent(atoi(e.args.c_str()) != 0);
+  } else if (e.command == "frame") {
+    tft.dumpPPM(e.args.c_str());
+  } else {
+    fprintf(stderr, "Nieznane polecenie scenariusza: %s\n", e.command.c_str());
+  }
+}
+
+// Utworzenie pseudoterminala udającego port szeregowy stacji; zwraca fd strony nadrzędnej albo -1
+static int openSerialPty(const char *link, int &slave) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+  const char *name = ptsname(master);
+  // Strona podrzędna otwarta przez cały czas: bez echa i edycji linii (ramki binarne), a zamknięcie portu przez
+  // odbiornik nie zamyka pseudoterminala
+  slave = open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0) return -1;
+  struct termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  unlink(link);
+  if (symlink(name, link) != 0) return -1;
+  fprintf(stderr, "Port szeregowy: %s (%s)\n", link, name);
+  return master;
+}
+
+static double realSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  const char *root = "sdcard", *trace = nullptr, *script = nullptr, *frame = nullptr, *ptyLink = nullptr;
+  const char *eeprom = nullptr;
+  DateTime start(2026, 1, 1, 0, 0, 0);
+  double seconds = 60;
+  uint64_t stepUs = 0;
+  bool quiet = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:s:d:p:T:x:f:e:qt:")) != -1) {
+    switch (opt) {
+      case 'r': root = optarg; break;
+      case 's':
+        if (!parseDateTime(optarg, start)) {
+          fprintf(stderr, "Niepoprawny czas startu: %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'd': seconds = atof(optarg); break;
+      case 'p': stepUs = (uint64_t)(atof(optarg) * 1000); break;
+      case 'T': trace = optarg; break;
+      case 'x': script = optarg; break;
+      case 'f': frame = optarg; break;
+      case 'e': eeprom = optarg; break;
+      case 'q': quiet = true; break;
+      case 't': ptyLink = optarg; break;
+      default:
+        fprintf(stderr, "Użycie: %s [-r katalog] [-s czas] [-d sekundy] [-p krok_ms] [-T przebieg] [-x scenariusz] "
+                        "[-f ramka.ppm] [-e eeprom.bin] [-q] [-t łącze_portu]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (stepUs == 0) stepUs = ptyLink ? 1000 : 1000000;
+
+  std::vector<ScriptEvent> events;
+  if (script && !loadScript(script, events)) {
+    fprintf(stderr, "Nie można wczytać scenariusza %s\n", script);
+    return 1;
+  }
+  if (trace && !simLoadSensorTrace(trace)) {
+    fprintf(stderr, "Nie można wczytać przebiegu czujnika %s\n", trace);
+    return 1;
+  }
+  FILE *devnull = quiet ? fopen("/dev/null", "w") : nullptr;
+  if (quiet) simSerialOutput(devnull);
+  int ptySlave = -1;
+  if (ptyLink) {
+    int master = openSerialPty(ptyLink, ptySlave);
+    if (master < 0) {
+      fprintf(stderr, "Nie można utworzyć pseudoterminala %s\n", ptyLink);
+      return 1;
+    }
+    simSerialPort(master);
+  }
+  if (eeprom) simEepromLoad(eeprom);
+  simSetRootDir(root);
+  simSetClock(start);
+  for (const ScriptEvent &e : events) {
+    if (e.at == 0 && e.command == "card") simSetCardPresent(atoi(e.args.c_str()) != 0); // Start bez karty
+  }
+
+  setup();
+
+  // Pętla wirtualnego czasu: loop(), potem przesunięcie zegara o krok (krótszy w pobliżu zdarzeń i przy
+  // wciśniętym przycisku, aby programowa obsługa drgań styków widziała kolejne stany)
+  uint64_t t0 = simNowMicros(), end = t0 + (uint64_t)(seconds * 1e6), loops = 0;
+  double real0 = realSeconds();
+  size_t next = 0;
+  std::vector<std::pair<uint64_t, int>> releases;
+  while (simNowMicros() < end) {
+    uint64_t now = simNowMicros() - t0;
+    while (next < events.size() && events[next].at <= now) runEvent(events[next++], releases, now);
+    for (size_t i = 0; i < releases.size();) {
+      if (releases[i].first <= now) {
+        simSetPin(releases[i].second, HIGH);
+        releases.erase(releases.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    // Uśpiony procesor budzi się najpóźniej na następne zdarzenie scenariusza (przycisk, port, zegar)
+    uint64_t wake = end;
+    if (next < events.size()) wake = std::min(wake, t0 + events[next].at);
+    for (const auto &r : releases) wake = std::min(wake, t0 + r.first);
+    simSetWakeLimit(wake);
+    loop();
+    loops++;
+
+    uint64_t step = stepUs;
+    if (!releases.empty() || now < PRESS_US * 2 + (next > 0 ? events[next - 1].at : 0)) step = std::min<uint64_t>(step, 1000);
+    if (next < events.size() && events[next].at > now) step = std::min<uint64_t>(step, events[next].at - now);
+    simAdvanceMicros(step);
+    simRtcPoll();
+
+    if (ptyLink) { // Z odbiornikiem po drugiej stronie czas wirtualny nie może wyprzedzać rzeczywistego
+      double ahead = (simNowMicros() - t0) / 1e6 - (realSeconds() - real0);
+      if (ahead > 0.001) usleep((useconds_t)(ahead * 1e6));
+    }
+  }
+
+  if (frame) tft.dumpPPM(frame);
+  if (eeprom && !simEepromSave(eeprom)) fprintf(stderr, "Nie można zapisać pamięci EEPROM do %s\n", eeprom);
+  fprintf(stderr, "Symulacja: %.0f s, przebiegów loop(): %llu, SD odczyt/zapis: %llu/%llu B, SPI TFT: %u B, I2C: %u\n",
+          (simNowMicros() - t0) / 1e6, (unsigned long long)loops, (unsigned long long)simSdBytesRead(),
+          (unsigned long long)simSdBytesWritten(), tft.spiBytes(), simI2cTransactions());
+  if (simEepromBytesWritten() > 0) fprintf(stderr, "EEPROM: zapisanych bajtów: %u\n", simEepromBytesWritten());
+  if (simSleepCount() > 0) {
+    fprintf(stderr, "Uśpienia procesora: %u, czas uśpienia: %.0f s (%.1f%%)\n", simSleepCount(), simSleptMicros() / 1e6,
+            100.0 * simSleptMicros() / (simNowMicros() - t0));
+  }
+  if (devnull) fclose(devnull);
+  if (ptyLink) {
+    simSerialPort(-1);  // Wyślij bajty czekające w buforze
+    unlink(ptyLink);
+    close(ptySlave);
+  }
+  return 0;
+}
@@ -0,0 +1,134 @@
+// Symulacja RTC PCF8563 i klas czasu z RTClib
+#include <RTClib.h>
+#include "sim.h"
+
+static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
+  if (y >= 2000U) y -= 2000U;
+  uint16_t days = d;
+  for (uint8_t i = 1; i < m; ++i) days += daysInMonth[i - 1];
+  if (m > 2 && y % 4 == 0) ++days;
+  return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+DateTime::DateTime(uint32_t t) {
+  t -= SECONDS_FROM_1970_TO_2000;
+  ss = t % 60;
+  t /= 60;
+  mm = t % 60;
+  t /= 60;
+  hh = t % 24;
+  uint16_t days = t / 24;
+  uint8_t leap;
+  for (yOff = 0;; ++yOff) {
+    leap = yOff % 4 == 0;
+    if (days < 365U + leap) break;
+    days -= 365 + leap;
+  }
+  for (m = 1; m < 12; ++m) {
+    uint8_t daysPerMonth = daysInMonth[m - 1];
+    if (leap && m == 2) ++daysPerMonth;
+    if (days < daysPerMonth) break;
+    days -= daysPerMonth;
+  }
+  d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec) {
+  if (year >= 2000U) year -= 2000U;
+  yOff = year;
+  m = month;
+  d = day;
+  hh = hour;
+  mm = min;
+  ss = sec;
+}
+
+bool DateTime::isValid() const {
+  if (yOff >= 100 || m < 1 || m > 12 || d < 1) return false;
+  uint8_t dim = daysInMonth[m - 1] + (m == 2 && yOff % 4 == 0);
+  return d <= dim && hh < 24 && mm < 60 && ss < 60;
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+  uint16_t day = date2days(yOff, m, d);
+  return (day + 6) % 7;
+}
+
+uint32_t DateTime::secondstime() const {
+  uint16_t days = date2days(yOff, m, d);
+  return ((days * 24UL + hh) * 60 + mm) * 60 + ss;
+}
+
+uint32_t DateTime::unixtime() const { return secondstime() + SECONDS_FROM_1970_TO_2000; }
+
+// Zegar symulowany: czas bazowy plus upływ wirtualnego czasu rdzenia
+static uint32_t clockBase = DateTime(2026, 1, 1, 0, 0, 0).unixtime();
+static uint64_t clockBaseMicros = 0;
+static uint32_t clockReads = 0;
+static Pcf8563SqwPinMode sqwMode = PCF8563_SquareWaveOFF;
+
+void simSetClock(const DateTime &dt) {
+  clockBase = dt.unixtime();
+  clockBaseMicros = simNowMicros();
+}
+uint32_t simClockReads() { return clockReads; }
+
+bool RTC_PCF8563::begin() { return true; }
+void RTC_PCF8563::adjust(const DateTime &dt) { simSetClock(dt); }
+bool RTC_PCF8563::lostPower() { return false; }
+bool RTC_PCF8563::isrunning() { return true; }
+void RTC_PCF8563::start() {}
+void RTC_PCF8563::stop() {}
+DateTime RTC_PCF8563::now() {
+  clockReads++;
+  simAdvanceMicros(250);  // Odczyt 7 bajtów po I2C przy 100 kHz
+  return DateTime(clockBase + (uint32_t)((simNowMicros() - clockBaseMicros) / 1000000ULL));
+}
+Pcf8563SqwPinMode RTC_PCF8563::readSqwPinMode() { return sqwMode; }
+void RTC_PCF8563::writeSqwPinMode(Pcf8563SqwPinMode mode) { sqwMode = mode; }
+
+// Licznik czasu PCF8563 (rejestry 0x01, 0x0E, 0x0F) z wyjściem INT podłączonym do pinu 19 stacji
+static const uint8_t RTC_INT_PIN = 19;
+static const uint8_t CTRL2_TIE = 0x01, CTRL2_TF = 0x04, TIMER_TE = 0x80;
+static const uint64_t TIMER_PERIOD_US[4] = {244, 15625, 1000000, 60000000};  // Źródła 4096 Hz, 64 Hz, 1 Hz, 1/60 Hz
+static uint8_t ctrl2 = 0, timerCtrl = 0x03, timerValue = 0;
+static uint64_t timerDue = UINT64_MAX;
+
+static void updateIntPin() { simSetPin(RTC_INT_PIN, (ctrl2 & CTRL2_TIE) && (ctrl2 & CTRL2_TF) ? LOW : HIGH); }
+
+static void restartTimer() {
+  timerDue = (timerCtrl & TIMER_TE) && timerValue > 0
+                 ? simNowMicros() + timerValue * TIMER_PERIOD_US[timerCtrl & 0x03]
+                 : UINT64_MAX;
+}
+
+void simRtcWriteRegister(uint8_t reg, uint8_t value) {
+  if (reg == 0x01) {
+    ctrl2 = (value & 0x13) | (ctrl2 & value & 0x0C);  // Flagi TF i AF można tylko wyzerować (zapis 1 ich nie zmienia)
+    updateIntPin();
+  } else if (reg == 0x0E) {
+    timerCtrl = value & 0x83;
+    restartTimer();
+  } else if (reg == 0x0F) {
+    timerValue = value;
+    restartTimer();
+  }
+}
+
+uint8_t simRtcReadRegister(uint8_t reg) {
+  if (reg == 0x01) return ctrl2;
+  if (reg == 0x0E) return timerCtrl;
+  if (reg == 0x0F) return timerValue;
+  return 0;
+}
+
+uint64_t simRtcTimerDue() { return timerDue; }
+
+void simRtcPoll() {
+  if (simNowMicros() < timerDue) return;
+  ctrl2 |= CTRL2_TF;
+  timerDue += timerValue * TIMER_PERIOD_US[timerCtrl & 0x03];  // Licznik zaczyna odliczanie od nowa
+  updateIntPin();
+}
@@ -0,0 +1,226 @@
+// Symulacja karty SD: każdy plik na karcie to plik w katalogu głównym symulacji
+#include <SD.h>
+#include "sim.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+SDClass SD;
+
+static std::string rootDir = "sdcard";
+static bool cardPresent = true;
+static bool cardStarted = false;
+static uint64_t bytesRead = 0;
+static uint64_t bytesWritten = 0;
+static uint64_t blockReads = 0;
+
+// Model czasu karty: biblioteka SD trzyma w pamięci jeden blok 512 B, więc główny koszt ponosi się przy każdym
+// wczytaniu nowego bloku (komenda + 512 B przez SPI przy 8 MHz); każde wywołanie read() kosztuje dodatkowo
+// kilka mikrosekund obsługi warstwy plików na 16 MHz AVR, niezależnie od liczby bajtów. Odszukanie pliku
+// (open, exists) wczytuje po jednym bloku katalogu na każdy człon ścieżki.
+static const uint32_t SD_BLOCK = 512;
+static const uint64_t SD_BLOCK_US = 700;
+static const uint64_t SD_CALL_US = 3;
+static const SimFileState *cachedFile = nullptr;
+static uint32_t cachedBlock = 0xFFFFFFFF;
+
+void simSetRootDir(const char *dir) { rootDir = dir; }
+void simSetCardPresent(bool present) {
+  cardPresent = present;
+  if (!present) cardStarted = false;
+}
+uint64_t simSdBytesRead() { return bytesRead; }
+uint64_t simSdBytesWritten() { return bytesWritten; }
+uint64_t simSdBlockReads() { return blockReads; }
+void simResetSdCounters() { bytesRead = bytesWritten = blockReads = 0; }
+
+struct SimFileState {
+  int refs = 1;
+  FILE *fp = nullptr;
+  std::string path;
+  std::string name;
+  uint8_t mode = 0;
+  bool isDir = false;
+  std::vector<std::string> entries;
+  size_t dirPos = 0;
+};
+
+static std::string hostPath(const char *path) {
+  std::string p = path ? path : "";
+  while (!p.empty() && p[0] == '/') p.erase(0, 1);
+  return p.empty() ? rootDir : rootDir + "/" + p;
+}
+
+static void chargeLookup(const char *path) {
+  for (const char *c = path ? path : ""; *c; c++) {
+    if (*c == '/' || (c != path && c[-1] != '/')) continue;  // Tylko pierwszy znak każdego członu
+    blockReads++;
+    simAdvanceMicros(SD_BLOCK_US);
+  }
+  cachedFile = nullptr;  // W pamięci podręcznej jest teraz blok katalogu
+}
+
+static std::string baseName(const std::string &p) {
+  size_t s = p.find_last_of('/');
+  return s == std::string::npos ? p : p.substr(s + 1);
+}
+
+File::File() : state_(nullptr) {}
+File::File(SimFileState *state) : state_(state) {}
+File::File(const File &other) : state_(other.state_) {
+  if (state_) state_->refs++;
+}
+File &File::operator=(const File &other) {
+  if (this != &other) {
+    if (other.state_) other.state_->refs++;
+    this->~File();
+    state_ = other.state_;
+  }
+  return *this;
+}
+File::~File() {
+  if (state_ && --state_->refs == 0) {
+    if (cachedFile == state_) cachedFile = nullptr;
+    if (state_->fp) fclose(state_->fp);
+    delete state_;
+  }
+  state_ = nullptr;
+}
+
+File::operator bool() const { return state_ && (state_->fp || state_->isDir) && cardPresent; }
+const char *File::name() const { return state_ ? state_->name.c_str() : ""; }
+bool File::isDirectory() { return state_ && state_->isDir; }
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+size_t File::write(const uint8_t *buf, size_t n) {
+  if (!*this || !(state_->mode & O_WRITE)) return 0;
+  if (state_->mode & O_APPEND) fseek(state_->fp, 0, SEEK_END);
+  size_t w = fwrite(buf, 1, n, state_->fp);
+  bytesWritten += w;
+  return w;
+}
+int File::available() {
+  if (!*this || state_->isDir) return 0;
+  uint32_t s = size(), p = position();
+  return s > p ? (int)std::min<uint32_t>(s - p, 0x7FFF) : 0;
+}
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+int File::peek() {
+  if (!*this || state_->isDir) return -1;
+  int c = fgetc(state_->fp);
+  if (c != EOF) ungetc(c, state_->fp);
+  return c == EOF ? -1 : c;
+}
+int File::read(void *buf, uint16_t n) {
+  if (!*this || state_->isDir) return -1;
+  uint32_t pos = position();
+  size_t r = fread(buf, 1, n, state_->fp);
+  bytesRead += r;
+  simAdvanceMicros(SD_CALL_US);
+  for (uint32_t b = pos / SD_BLOCK; r > 0 && b <= (pos + r - 1) / SD_BLOCK; b++) {
+    if (cachedFile == state_ && cachedBlock == b) continue;  // Blok już w pamięci podręcznej
+    cachedFile = state_;
+    cachedBlock = b;
+    blockReads++;
+    simAdvanceMicros(SD_BLOCK_US);
+  }
+  return (int)r;
+}
+void File::flush() {
+  if (*this && state_->fp) fflush(state_->fp);
+}
+bool File::seek(uint32_t pos) {
+  if (!*this || state_->isDir || pos > size()) return false;
+  return fseek(state_->fp, pos, SEEK_SET) == 0;
+}
+uint32_t File::position() { return *this && state_->fp ? (uint32_t)ftell(state_->fp) : 0; }
+uint32_t File::size() {
+  if (!*this || !state_->fp) return 0;
+  fflush(state_->fp);
+  struct stat st;
+  return fstat(fileno(state_->fp), &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+void File::close() {
+  if (state_ && state_->fp) {
+    fclose(state_->fp);
+    state_->fp = nullptr;
+  }
+  if (state_) state_->isDir = false;
+}
+
+File File::openNextFile(uint8_t) {
+  if (!state_ || !state_->isDir || state_->dirPos >= state_->entries.size()) return File();
+  std::string child = state_->path + "/" + state_->entries[state_->dirPos++];
+  return SD.open(child.c_str(), O_READ);
+}
+void File::rewindDirectory() {
+  if (state_) state_->dirPos = 0;
+}
+
+bool SDClass::begin(uint8_t) {
+  if (!cardPresent) return false;
+  ::mkdir(rootDir.c_str(), 0755);
+  cardStarted = true;
+  return true;
+}
+void SDClass::end() { cardStarted = false; }
+
+File SDClass::open(const char *path, uint8_t mode) {
+  if (!cardStarted || !cardPresent) return File();
+  chargeLookup(path);
+  std::string hp = hostPath(path);
+  struct stat st;
+  bool exists = ::stat(hp.c_str(), &st) == 0;
+  SimFileState *s = new SimFileState();
+  s->path = path ? path : "/";
+  s->name = baseName(s->path);
+  s->mode = mode;
+  if (exists && S_ISDIR(st.st_mode)) {
+    s->isDir = true;
+    if (DIR *d = opendir(hp.c_str())) {
+      while (dirent *e = readdir(d)) {
+        if (e->d_name[0] != '.') s->entries.push_back(e->d_name);
+      }
+      closedir(d);
+    }
+    std::sort(s->entries.begin(), s->entries.end());
+    return File(s);
+  }
+  if (!exists && !(mode & O_CREAT)) {
+    delete s;
+    return File();
+  }
+  const char *fmode = "rb";
+  if (mode & O_WRITE) fmode = exists && !(mode & O_TRUNC) ? "r+b" : "w+b";
+  s->fp = fopen(hp.c_str(), fmode);
+  if (!s->fp) {
+    delete s;
+    return File();
+  }
+  if (mode & O_APPEND) fseek(s->fp, 0, SEEK_END);
+  return File(s);
+}
+
+bool SDClass::exists(const char *path) {
+  struct stat st;
+  if (cardStarted && cardPresent) chargeLookup(path);
+  return cardStarted && cardPresent && ::stat(hostPath(path).c_str(), &st) == 0;
+}
+bool SDClass::remove(const char *path) { return cardStarted && ::unlink(hostPath(path).c_str()) == 0; }
+bool SDClass::mkdir(const char *path) {
+  if (!cardStarted) return false;
+  std::string hp = hostPath(path);
+  for (size_t i = rootDir.size() + 1; i <= hp.size(); i++) {
+    if (i == hp.size() || hp[i] == '/') ::mkdir(hp.substr(0, i).c_str(), 0755);
+  }
+  return true;
+}
+bool SDClass::rmdir(const char *path) { return cardStarted && ::rmdir(hostPath(path).c_str()) == 0; }
@@ -0,0 +1,189 @@
+// Symulacja Adafruit_GFX i wyświetlacza ST7735 z licznikami transferów SPI
+#include <Adafruit_ST7735.h>
+#include "sim.h"
+#include "sim_font.h"
+
+// Koszt ustawienia okna adresowego (CASET + RASET + RAMWR) w bajtach SPI
+static const uint32_t WINDOW_BYTES = 11;
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h)
+    : WIDTH(w), HEIGHT(h), _width(w), _height(h), cursor_x(0), cursor_y(0), textcolor(0xFFFF),
+      textbgcolor(0xFFFF), textsize(1), rotation(0), wrap(true) {}
+
+void Adafruit_GFX::setRotation(uint8_t r) {
+  rotation = r & 3;
+  _width = (rotation & 1) ? HEIGHT : WIDTH;
+  _height = (rotation & 1) ? WIDTH : HEIGHT;
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t i = x; i < x + w; i++)
+    for (int16_t j = y; j < y + h; j++) drawPixel(i, j, color);
+}
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+void Adafruit_GFX::fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  if (x0 == x1) {
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    drawFastVLine(x0, y0, y1 - y0 + 1, color);
+    return;
+  }
+  if (y0 == y1) {
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+    drawFastHLine(x0, y0, x1 - x0 + 1, color);
+    return;
+  }
+  int16_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int16_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int16_t err = dx + dy;
+  for (;;) {
+    drawPixel(x0, y0, color);
+    if (x0 == x1 && y0 == y1) break;
+    int16_t e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size) {
+  const uint8_t *glyph = (c >= 0x20 && c <= 0x7E) ? simFont5x7[c - 0x20] : simFont5x7[0];
+  for (int8_t i = 0; i < 5; i++) {
+    uint8_t line = glyph[i];
+    for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      if (line & 1) {
+        if (size == 1) drawPixel(x + i, y + j, color);
+        else fillRect(x + i * size, y + j * size, size, size, color);
+      } else if (bg != color) {
+        if (size == 1) drawPixel(x + i, y + j, bg);
+        else fillRect(x + i * size, y + j * size, size, size, bg);
+      }
+    }
+  }
+  if (bg != color) {
+    if (size == 1) drawFastVLine(x + 5, y, 8, bg);
+    else fillRect(x + 5 * size, y, size, 8 * size, bg);
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += textsize * 8;
+  } else if (c != '\r') {
+    if (wrap && (cursor_x + textsize * 6) > _width) {
+      cursor_x = 0;
+      cursor_y += textsize * 8;
+    }
+    drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+    cursor_x += textsize * 6;
+  }
+  return 1;
+}
+
+void Adafruit_GFX::getTextBounds(const char *str, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w,
+                                 uint16_t *h) {
+  size_t len = strlen(str);
+  *x1 = x;
+  *y1 = y;
+  *w = len ? (uint16_t)(len * 6 * textsize) : 0;
+  *h = len ? (uint16_t)(8 * textsize) : 0;
+}
+void Adafruit_GFX::getTextBounds(const __FlashStringHelper *s, int16_t x, int16_t y, int16_t *x1, int16_t *y1,
+                                 uint16_t *w, uint16_t *h) {
+  getTextBounds(reinterpret_cast<const char *>(s), x, y, x1, y1, w, h);
+}
+
+Adafruit_ST7735::Adafruit_ST7735(int8_t, int8_t, int8_t)
+    : Adafruit_GFX(128, 160), spiBytes_(0), spiTransactions_(0), displayOn_(true) {
+  memset(fb_, 0, sizeof(fb_));
+}
+
+void Adafruit_ST7735::initR(uint8_t) {
+  spiBytes_ += 60;
+  spiTransactions_++;
+}
+
+void Adafruit_ST7735::setRotation(uint8_t r) {
+  Adafruit_GFX::setRotation(r);
+  spiBytes_ += 2;
+  spiTransactions_++;
+}
+
+void Adafruit_ST7735::setWindowToPhysical(int16_t x, int16_t y, int16_t &px, int16_t &py) const {
+  switch (rotation) {
+    case 0: px = x; py = y; break;
+    case 1: px = WIDTH - 1 - y; py = x; break;
+    case 2: px = WIDTH - 1 - x; py = HEIGHT - 1 - y; break;
+    default: px = y; py = HEIGHT - 1 - x; break;
+  }
+}
+
+void Adafruit_ST7735::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+  int16_t px, py;
+  setWindowToPhysical(x, y, px, py);
+  fb_[py * WIDTH + px] = color;
+  spiBytes_ += WINDOW_BYTES + 2;
+  spiTransactions_++;
+  simAdvanceMicros((WINDOW_BYTES + 2) / 2);
+}
+
+void Adafruit_ST7735::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width) w = _width - x;
+  if (y + h > _height) h = _height - y;
+  if (w <= 0 || h <= 0) return;
+  for (int16_t i = x; i < x + w; i++) {
+    for (int16_t j = y; j < y + h; j++) {
+      int16_t px, py;
+      setWindowToPhysical(i, j, px, py);
+      fb_[py * WIDTH + px] = color;
+    }
+  }
+  uint32_t bytes = WINDOW_BYTES + 2UL * w * h;
+  spiBytes_ += bytes;
+  spiTransactions_++;
+  simAdvanceMicros(bytes / 2);  // SPI 8 MHz: 1 bajt = 1 us, licząc narzut pętli wysyłania około połowy
+}
+
+void Adafruit_ST7735::enableDisplay(bool enable) {
+  displayOn_ = enable;
+  spiBytes_ += 1;
+  spiTransactions_++;
+}
+void Adafruit_ST7735::enableSleep(bool enable) {
+  (void)enable;
+  spiBytes_ += 1;
+  spiTransactions_++;
+}
+
+uint16_t Adafruit_ST7735::pixelAt(int16_t x, int16_t y) const {
+  if (x < 0 || y < 0 || x >= _width || y >= _height) return 0;
+  int16_t px, py;
+  setWindowToPhysical(x, y, px, py);
+  return fb_[py * WIDTH + px];
+}
+
+bool Adafruit_ST7735::dumpPPM(const char *path) const {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  fprintf(f, "P6\n%d %d\n255\n", _width, _height);
+  for (int16_t y = 0; y < _height; y++) {
+    for (int16_t x = 0; x < _width; x++) {
+      uint16_t c = displayOn_ ? pixelAt(x, y) : 0;
+      uint8_t rgb[3] = {(uint8_t)((c >> 11) << 3), (uint8_t)(((c >> 5) & 0x3F) << 2), (uint8_t)((c & 0x1F) << 3)};
+      fwrite(rgb, 1, 3, f);
+    }
+  }
+  fclose(f);
+  return true;
+}